@@ -20,6 +20,31 @@
 #OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 #SOFTWARE.
 
+# Must match the bank lists used with create_xo.sh
+BSW_BANKS=${BSW_BANKS:-"0 1 2 3"}
+GACTX_BANKS=${GACTX_BANKS:-"3"}
+
+KERNEL_LINK_ARGS=""
+KERNEL_XO_FILES=""
+for i in $BSW_BANKS;
+do
+    KERNEL_LINK_ARGS="$KERNEL_LINK_ARGS --nk BSW_bank$i:1"
+    for m in 00 01 02 03;
+    do
+        KERNEL_LINK_ARGS="$KERNEL_LINK_ARGS --sp BSW_bank${i}_1.m${m}_axi:bank$i"
+    done
+    KERNEL_XO_FILES="$KERNEL_XO_FILES xclbin/BSW_bank$i.xo"
+done
+for i in $GACTX_BANKS;
+do
+    KERNEL_LINK_ARGS="$KERNEL_LINK_ARGS --nk GACTX_bank$i:1"
+    for m in 00 01;
+    do
+        KERNEL_LINK_ARGS="$KERNEL_LINK_ARGS --sp GACTX_bank${i}_1.m${m}_axi:bank$i"
+    done
+    KERNEL_XO_FILES="$KERNEL_XO_FILES xclbin/GACTX_bank$i.xo"
+done
+
 curr_dir=$PWD
 
 rm -rf test_WGA_hw_emu
@@ -27,30 +52,8 @@ cp -r ./src/host/WGA ./test_WGA_hw_emu
 cp ./src/host/common/* ./test_WGA_hw_emu/
 
 xocc -g --target hw_emu --platform $AWS_PLATFORM --link \
-    --nk BSW_bank0:1 \
-    --sp BSW_bank0_1.m00_axi:bank0 \
-    --sp BSW_bank0_1.m01_axi:bank0 \
-    --sp BSW_bank0_1.m02_axi:bank0 \
-    --sp BSW_bank0_1.m03_axi:bank0 \
-    --nk BSW_bank1:1 \
-    --sp BSW_bank1_1.m00_axi:bank1 \
-    --sp BSW_bank1_1.m01_axi:bank1 \
-    --sp BSW_bank1_1.m02_axi:bank1 \
-    --sp BSW_bank1_1.m03_axi:bank1 \
-    --nk BSW_bank2:1 \
-    --sp BSW_bank2_1.m00_axi:bank2 \
-    --sp BSW_bank2_1.m01_axi:bank2 \
-    --sp BSW_bank2_1.m02_axi:bank2 \
-    --sp BSW_bank2_1.m03_axi:bank2 \
-    --nk BSW_bank3:1 \
-    --sp BSW_bank3_1.m00_axi:bank3 \
-    --sp BSW_bank3_1.m01_axi:bank3 \
-    --sp BSW_bank3_1.m02_axi:bank3 \
-    --sp BSW_bank3_1.m03_axi:bank3 \
-    --nk GACTX_bank3:1 \
-    --sp GACTX_bank3_1.m00_axi:bank3 \
-    --sp GACTX_bank3_1.m01_axi:bank3 \
-    --output test_WGA_hw_emu/WGA.hw_emu.xclbin xclbin/BSW_bank0.xo xclbin/BSW_bank1.xo xclbin/BSW_bank2.xo xclbin/BSW_bank3.xo xclbin/GACTX_bank3.xo
+    $KERNEL_LINK_ARGS \
+    --output test_WGA_hw_emu/WGA.hw_emu.xclbin $KERNEL_XO_FILES
 rm -rf *.dir *.cf *.dat
 
 cd $curr_dir
@@ -20,24 +20,47 @@
 #OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 #SOFTWARE.
 
+# Kernel layout: one BSW/GACT-X instance is packaged per listed DDR bank. The
+# host enumerates whatever BSW_bank* and GACTX_bank* kernels end up in the
+# xclbin, so the same lists must be passed to create_WGA.hw*.sh.
+BSW_BANKS=${BSW_BANKS:-"0 1 2 3"}
+GACTX_BANKS=${GACTX_BANKS:-"3"}
+
 curr_dir=$PWD
 
 rm -rf xclbin
 mkdir xclbin
 
-/opt/Xilinx/Vivado/2017.4.op/bin/vivado -mode batch -source ./scripts/gen_xo.tcl -tclargs xclbin/GACTX_bank3.xo GACTX $AWS_PLATFORM bank3 2
-/opt/Xilinx/Vivado/2017.4.op/bin/vivado -mode batch -source ./scripts/gen_xo.tcl -tclargs xclbin/BSW_bank0.xo BSW $AWS_PLATFORM bank0 4;
+for i in $GACTX_BANKS;
+do
+    if [ "$i" != "3" ]; then
+        cd ./src/hdl/GACTX/top_modules/
+        cp GACTX_bank3.v   GACTX_bank$i.v
+        cp GACTX_bank3.xml GACTX_bank$i.xml
+        sed -i "s/bank3/bank$i/g" GACTX_bank$i.v
+        sed -i "s/bank3/bank$i/g" GACTX_bank$i.xml
+        cd $curr_dir
+    fi
+    /opt/Xilinx/Vivado/2017.4.op/bin/vivado -mode batch -source ./scripts/gen_xo.tcl -tclargs xclbin/GACTX_bank$i.xo GACTX $AWS_PLATFORM bank$i 2
+    if [ "$i" != "3" ]; then
+        rm ./src/hdl/GACTX/top_modules/GACTX_bank$i.v ./src/hdl/GACTX/top_modules/GACTX_bank$i.xml
+    fi
+done
 
-for i in `seq 1 3`;
+for i in $BSW_BANKS;
 do
-    cd ./src/hdl/BSW/top_modules/
-    cp BSW_bank0.v   BSW_bank$i.v
-    cp BSW_bank0.xml BSW_bank$i.xml
-    sed -i "s/bank0/bank$i/g" BSW_bank$i.v
-    sed -i "s/bank0/bank$i/g" BSW_bank$i.xml
-    cd $curr_dir
+    if [ "$i" != "0" ]; then
+        cd ./src/hdl/BSW/top_modules/
+        cp BSW_bank0.v   BSW_bank$i.v
+        cp BSW_bank0.xml BSW_bank$i.xml
+        sed -i "s/bank0/bank$i/g" BSW_bank$i.v
+        sed -i "s/bank0/bank$i/g" BSW_bank$i.xml
+        cd $curr_dir
+    fi
     /opt/Xilinx/Vivado/2017.4.op/bin/vivado -mode batch -source ./scripts/gen_xo.tcl -tclargs xclbin/BSW_bank$i.xo BSW $AWS_PLATFORM bank$i 4;
-    rm ./src/hdl/BSW/top_modules/BSW_bank$i.v ./src/hdl/BSW/top_modules/BSW_bank$i.xml
+    if [ "$i" != "0" ]; then
+        rm ./src/hdl/BSW/top_modules/BSW_bank$i.v ./src/hdl/BSW/top_modules/BSW_bank$i.xml
+    fi
 done
 
 rm -rf packaged_kernel* tmp_kernel_pack* *.jou *.log *.wdb *.wcfg .Xil
@@ -0,0 +1,64 @@
+#MIT License
+#
+#Copyright (c) 2019 Sneha D. Goenka, Yatish Turakhia, Gill Bejerano and William Dally
+#
+#Permission is hereby granted, free of charge, to any person obtaining a copy
+#of this software and associated documentation files (the "Software"), to deal
+#in the Software without restriction, including without limitation the rights
+#to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#copies of the Software, and to permit persons to whom the Software is
+#furnished to do so, subject to the following conditions:
+#
+#The above copyright notice and this permission notice shall be included in all
+#copies or substantial portions of the Software.
+#
+#THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+#SOFTWARE.
+
+
+# Builds array_bench for every NUM_PE x BLOCK_WIDTH pair and runs it on the
+# same tiles, e.g. a tile trace written by the simulated device:
+#   TRACE=tiles.txt ./scripts/sweep_arrays.sh
+# Without TRACE, synthetic BSW and GACT-X tiles are used. Each build goes to
+# array_<NUM_PE>_<BLOCK_WIDTH>/ and the reports to array_sweep.txt. The
+# configurations whose arrays disagree with the scalar CPU engine are listed
+# at the end and make the script fail.
+NUM_PES=${NUM_PES:-"16 32 64"}
+BLOCK_WIDTHS=${BLOCK_WIDTHS:-"2 3 4"}
+
+curr_dir=$PWD
+rm -f array_sweep.txt
+failed=""
+
+for pe in $NUM_PES;
+do
+    for bw in $BLOCK_WIDTHS;
+    do
+        build_dir=$curr_dir/array_${pe}_${bw}
+        mkdir -p $build_dir
+        cd $build_dir
+        cmake -DWITH_OPENCL=OFF -DWITH_VERILATOR=ON -DARRAY_NUM_PE=$pe -DARRAY_BLOCK_WIDTH=$bw $curr_dir/src/host/WGA || exit 1
+        make array_bench || exit 1
+        cp $curr_dir/src/host/WGA/params.cfg .
+        if [ -n "$TRACE" ]; then
+            ./array_bench trace $TRACE | tee -a $curr_dir/array_sweep.txt
+            [ ${PIPESTATUS[0]} -eq 0 ] || failed="$failed ${pe}x${bw}"
+        else
+            ./array_bench bsw | tee -a $curr_dir/array_sweep.txt
+            [ ${PIPESTATUS[0]} -eq 0 ] || failed="$failed ${pe}x${bw}(bsw)"
+            ./array_bench gactx | tee -a $curr_dir/array_sweep.txt
+            [ ${PIPESTATUS[0]} -eq 0 ] || failed="$failed ${pe}x${bw}(gactx)"
+        fi
+        cd $curr_dir
+    done
+done
+
+if [ -n "$failed" ]; then
+    echo "mismatches against the scalar CPU engine in:$failed" | tee -a array_sweep.txt
+    exit 1
+fi
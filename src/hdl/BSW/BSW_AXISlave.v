@@ -54,7 +54,12 @@ module BSW_AXISlave #(
   output wire [64-1:0]             query_seq         ,
   output wire [64-1:0]             batch_id          ,
   output wire [64-1:0]             batch_params      ,
-  output wire [64-1:0]             batch_tile_output 
+  output wire [64-1:0]             batch_tile_output ,
+  output wire [32-1:0]             score_threshold   ,
+  output wire [32-1:0]             tile_window       ,
+  output wire [32-1:0]             query_length      ,
+  output wire [32-1:0]             num_chrs          ,
+  output wire [64-1:0]             chr_ends          
 );
 
 //------------------------Address Info-------------------
@@ -140,6 +145,22 @@ module BSW_AXISlave #(
 //         bit 31~0 - batch_tile_output[31:0] (Read/Write)
 // 0x0b4 : Data signal of batch_tile_output
 //         bit 31~0 - batch_tile_output[63:32] (Read/Write)
+// 0x0b8 : Data signal of score_threshold
+//         bit 31~0 - score_threshold[31:0] (Read/Write)
+// 0x0bc : reserved
+// 0x0c0 : Data signal of tile_window
+//         bit 31~0 - tile_window[31:0] (Read/Write)
+// 0x0c4 : reserved
+// 0x0c8 : Data signal of query_length
+//         bit 31~0 - query_length[31:0] (Read/Write)
+// 0x0cc : reserved
+// 0x0d0 : Data signal of num_chrs
+//         bit 31~0 - num_chrs[31:0] (Read/Write)
+// 0x0d4 : reserved
+// 0x0d8 : Data signal of chr_ends
+//         bit 31~0 - chr_ends[31:0] (Read/Write)
+// 0x0dc : Data signal of chr_ends
+//         bit 31~0 - chr_ends[63:32] (Read/Write)
 // (SC = Self Clear, COR = Clear on Read, TOW = Toggle on Write, COH = Clear on Handshake)
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -175,6 +196,12 @@ localparam [C_ADDR_WIDTH-1:0]       LP_ADDR_batch_params_0         = 12'h0a8;
 localparam [C_ADDR_WIDTH-1:0]       LP_ADDR_batch_params_1         = 12'h0ac;
 localparam [C_ADDR_WIDTH-1:0]       LP_ADDR_batch_tile_output_0    = 12'h0b0;
 localparam [C_ADDR_WIDTH-1:0]       LP_ADDR_batch_tile_output_1    = 12'h0b4;
+localparam [C_ADDR_WIDTH-1:0]       LP_ADDR_SCORE_THRESHOLD_0      = 12'h0b8;
+localparam [C_ADDR_WIDTH-1:0]       LP_ADDR_TILE_WINDOW_0          = 12'h0c0;
+localparam [C_ADDR_WIDTH-1:0]       LP_ADDR_QUERY_LENGTH_0         = 12'h0c8;
+localparam [C_ADDR_WIDTH-1:0]       LP_ADDR_NUM_CHRS_0             = 12'h0d0;
+localparam [C_ADDR_WIDTH-1:0]       LP_ADDR_chr_ends_0             = 12'h0d8;
+localparam [C_ADDR_WIDTH-1:0]       LP_ADDR_chr_ends_1             = 12'h0dc;
 localparam integer                  LP_SM_WIDTH                    = 2;
 localparam [LP_SM_WIDTH-1:0]        SM_WRIDLE                      = 2'd0;
 localparam [LP_SM_WIDTH-1:0]        SM_WRDATA                      = 2'd1;
@@ -225,6 +252,11 @@ reg  [64-1:0]                       int_query_seq                  = 64'd0;
 reg  [64-1:0]                       int_batch_id                   = 64'd0;
 reg  [64-1:0]                       int_batch_params               = 64'd0;
 reg  [64-1:0]                       int_batch_tile_output          = 64'd0;
+reg  [32-1:0]                       int_score_threshold            = 32'd0;
+reg  [32-1:0]                       int_tile_window                = 32'd0;
+reg  [32-1:0]                       int_query_length               = 32'd0;
+reg  [32-1:0]                       int_num_chrs                   = 32'd0;
+reg  [64-1:0]                       int_chr_ends                   = 64'd0;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Begin RTL
@@ -414,6 +446,24 @@ always @(posedge aclk) begin
         LP_ADDR_batch_tile_output_1: begin
           rdata_r <= int_batch_tile_output[32+:32];
         end
+        LP_ADDR_SCORE_THRESHOLD_0: begin
+          rdata_r <= int_score_threshold[0+:32];
+        end
+        LP_ADDR_TILE_WINDOW_0: begin
+          rdata_r <= int_tile_window[0+:32];
+        end
+        LP_ADDR_QUERY_LENGTH_0: begin
+          rdata_r <= int_query_length[0+:32];
+        end
+        LP_ADDR_NUM_CHRS_0: begin
+          rdata_r <= int_num_chrs[0+:32];
+        end
+        LP_ADDR_chr_ends_0: begin
+          rdata_r <= int_chr_ends[0+:32];
+        end
+        LP_ADDR_chr_ends_1: begin
+          rdata_r <= int_chr_ends[32+:32];
+        end
 
         default: begin
           rdata_r <= {C_DATA_WIDTH{1'b0}};
@@ -448,6 +498,11 @@ assign query_seq = int_query_seq;
 assign batch_id = int_batch_id;
 assign batch_params = int_batch_params;
 assign batch_tile_output = int_batch_tile_output;
+assign score_threshold = int_score_threshold;
+assign tile_window = int_tile_window;
+assign query_length = int_query_length;
+assign num_chrs = int_num_chrs;
+assign chr_ends = int_chr_ends;
 
 // int_ap_start
 always @(posedge aclk) begin
@@ -766,6 +821,66 @@ always @(posedge aclk) begin
   end
 end
 
+// int_score_threshold[32-1:0]
+always @(posedge aclk) begin
+  if (areset)
+    int_score_threshold[0+:32] <= 32'd0;
+  else if (aclk_en) begin
+    if (w_hs && waddr == LP_ADDR_SCORE_THRESHOLD_0)
+      int_score_threshold[0+:32] <= (wdata[0+:32] & wmask[0+:32]) | (int_score_threshold[0+:32] & ~wmask[0+:32]);
+  end
+end
+
+// int_tile_window[32-1:0]
+always @(posedge aclk) begin
+  if (areset)
+    int_tile_window[0+:32] <= 32'd0;
+  else if (aclk_en) begin
+    if (w_hs && waddr == LP_ADDR_TILE_WINDOW_0)
+      int_tile_window[0+:32] <= (wdata[0+:32] & wmask[0+:32]) | (int_tile_window[0+:32] & ~wmask[0+:32]);
+  end
+end
+
+// int_query_length[32-1:0]
+always @(posedge aclk) begin
+  if (areset)
+    int_query_length[0+:32] <= 32'd0;
+  else if (aclk_en) begin
+    if (w_hs && waddr == LP_ADDR_QUERY_LENGTH_0)
+      int_query_length[0+:32] <= (wdata[0+:32] & wmask[0+:32]) | (int_query_length[0+:32] & ~wmask[0+:32]);
+  end
+end
+
+// int_num_chrs[32-1:0]
+always @(posedge aclk) begin
+  if (areset)
+    int_num_chrs[0+:32] <= 32'd0;
+  else if (aclk_en) begin
+    if (w_hs && waddr == LP_ADDR_NUM_CHRS_0)
+      int_num_chrs[0+:32] <= (wdata[0+:32] & wmask[0+:32]) | (int_num_chrs[0+:32] & ~wmask[0+:32]);
+  end
+end
+
+// int_chr_ends[32-1:0]
+always @(posedge aclk) begin
+  if (areset)
+    int_chr_ends[0+:32] <= 32'd0;
+  else if (aclk_en) begin
+    if (w_hs && waddr == LP_ADDR_chr_ends_0)
+      int_chr_ends[0+:32] <= (wdata[0+:32] & wmask[0+:32]) | (int_chr_ends[0+:32] & ~wmask[0+:32]);
+  end
+end
+
+// int_chr_ends[32-1:0]
+always @(posedge aclk) begin
+  if (areset)
+    int_chr_ends[32+:32] <= 32'd0;
+  else if (aclk_en) begin
+    if (w_hs && waddr == LP_ADDR_chr_ends_1)
+      int_chr_ends[32+:32] <= (wdata[0+:32] & wmask[0+:32]) | (int_chr_ends[32+:32] & ~wmask[0+:32]);
+  end
+end
+
 
 endmodule
 
@@ -135,7 +135,12 @@ module BSW_Kernel #(
   input  wire [64-1:0]                     query_seq         ,
   input  wire [64-1:0]                     batch_id          ,
   input  wire [64-1:0]                     batch_params      ,
-  input  wire [64-1:0]                     batch_tile_output 
+  input  wire [64-1:0]                     batch_tile_output ,
+  input  wire [32-1:0]                     score_threshold   ,
+  input  wire [32-1:0]                     tile_window       ,
+  input  wire [32-1:0]                     query_length      ,
+  input  wire [32-1:0]                     num_chrs          ,
+  input  wire [64-1:0]                     chr_ends          
 );
 
 
@@ -399,6 +404,11 @@ inst_kernel_control  (
   .batch_id                ( batch_id                       ),
   .batch_params            ( batch_params                   ),
   .batch_tile_output       ( batch_tile_output              ),
+  .score_threshold         ( score_threshold                ),
+  .tile_window             ( tile_window                    ),
+  .query_length            ( query_length                   ),
+  .num_chrs                ( num_chrs                       ),
+  .chr_ends                ( chr_ends                       ),
   .s_axis_tvalid           ( rd_tvalid                      ),
   .s_axis_tready           ( rd_tready                      ),
   .s_axis_tdata            ( rd_tdata                       ),
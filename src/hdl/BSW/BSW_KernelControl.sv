@@ -79,7 +79,12 @@ module BSW_KernelControl #(
     input  wire [64-1:0]                   query_seq,
     input  wire [64-1:0]                   batch_id,
     input  wire [64-1:0]                   batch_params,
-    input  wire [64-1:0]                   batch_tile_output
+    input  wire [64-1:0]                   batch_tile_output,
+    input  wire [32-1:0]                   score_threshold,
+    input  wire [32-1:0]                   tile_window,
+    input  wire [32-1:0]                   query_length,
+    input  wire [32-1:0]                   num_chrs,
+    input  wire [64-1:0]                   chr_ends
 );
 
 localparam integer BLOCK_WIDTH = 3;
@@ -98,6 +103,11 @@ localparam integer MAX_TILE_SIZE = 512;
 localparam integer WORD_4 = 128; 
 localparam integer FIFO_ADDR_WIDTH = 4; 
 localparam integer LOG_MAX_TILE_SIZE = $clog2(MAX_TILE_SIZE); 
+localparam integer OUT_RECORD_WIDTH = 128;
+localparam integer NUM_OUT_RECORDS = C_AXIS_TDATA_WIDTH/OUT_RECORD_WIDTH;
+localparam integer CHRS_PER_BEAT = C_AXIS_TDATA_WIDTH/32;
+localparam integer LOG_MAX_CHR_BEATS = 8;
+localparam integer REVERSE_QUERY_BIT = 2;
 
 /////////////////////////////////////////////////////////////////////////////
 // Variables
@@ -126,6 +136,28 @@ logic   [32-1:0]	            	 available_axi;
 logic   [32-1:0]	            	 available_axi_params;
 logic   [32-1:0]	            	 available_axi_data;
 
+// Hit mode (tile_window > 0): batch_params holds one {ref_hit, query_hit}
+// pair per tile and chr_ends holds the ascending chromosome end positions
+// of the reference, ending with a sentinel; batch_id is not read. Each AXI
+// loads the table into its own BRAM at the start of a batch and turns its
+// hits into tile windows.
+logic                                hit_mode;
+logic   [32-1:0]	            	 num_chr_beats;
+logic   [LOG_MAX_CHR_BEATS-1:0]	     chr_addr[NUM_AXI-1:0];
+logic   [NUM_AXI-1:0]	           	 chr_wr_en = {NUM_AXI{1'b0}};
+logic   [C_AXIS_TDATA_WIDTH-1:0] 	 chr_data_in[NUM_AXI-1:0];
+logic   [C_AXIS_TDATA_WIDTH-1:0] 	 chr_data_out[NUM_AXI-1:0];
+logic   [LOG_MAX_CHR_BEATS:0]	     chr_load_beat[NUM_AXI-1:0];
+logic   [LOG_MAX_CHR_BEATS:0]	     chr_lo[NUM_AXI-1:0];
+logic   [LOG_MAX_CHR_BEATS:0]	     chr_hi[NUM_AXI-1:0];
+logic   [32-1:0]	            	 chr_end[NUM_AXI-1:0];
+logic   [32-1:0]	            	 hit_ref[NUM_AXI-1:0];
+logic   [32-1:0]	            	 hit_query[NUM_AXI-1:0];
+logic   [32-1:0]	            	 hit_ref_start[NUM_AXI-1:0];
+logic   [32-1:0]	            	 hit_query_start[NUM_AXI-1:0];
+logic   [32-1:0]	            	 hit_tile_base[NUM_AXI-1:0];
+logic   [2:0]	                	 lookup_tile[NUM_AXI-1:0];
+
 logic   [C_XFER_SIZE_WIDTH-1:0]  	 read_byte_length_logic[NUM_AXI-1:0];
 logic   [64-1:0]  	        	 	 read_addr_offset_reg[NUM_AXI-1:0]; 
 logic   [NUM_AXI-1:0]	           	 read_start_reg = {NUM_AXI{1'b0}};
@@ -204,6 +236,9 @@ logic   [32-1:0]	            	 total_char[NUM_AXI-1:0];
 
 logic   [32-1:0]	            	 num_tiles_done = 32'd0;
 logic   [32-1:0]	            	 num_inner_tiles_done = 32'd0;
+logic   [32-1:0]	            	 num_tiles_passed = 32'd0;
+logic   [32-1:0]	            	 num_out_records = 32'd0;
+logic   [32-1:0]	            	 num_out_beats = 32'd0;
 logic   [32-1:0]	            	 num_in_tiles = 32'd0;
 logic   [C_AXIS_TDATA_WIDTH-1:0] 	 data_out[NUM_AXI-1:0];
 logic   [NUM_AXI-1:0]	         	 m_axis_tvalid_reg = {NUM_AXI{1'b0}};
@@ -213,7 +248,7 @@ logic   [NUM_AXI-1:0]		       	 write_start_reg = {NUM_AXI{1'b0}};
 
 logic rst;
 
-typedef enum logic[3:0] {IDLE_PARAMS, WAIT_PARAMS, BLOCK, SEND_BATCH_ID_ADDR, READ_BATCH_ID, BLOCK1, SEND_BATCH_PARAMS_ADDR, READ_BATCH_PARAMS, DONE_PARAMS} state_params;
+typedef enum logic[4:0] {IDLE_PARAMS, WAIT_PARAMS, BLOCK, SEND_BATCH_ID_ADDR, READ_BATCH_ID, BLOCK1, SEND_BATCH_PARAMS_ADDR, READ_BATCH_PARAMS, DONE_PARAMS, LOAD_CHR, SEND_CHR_ADDR, READ_CHR, LOOKUP_START, LOOKUP_READ, LOOKUP_WAIT, LOOKUP_CMP, LOOKUP_WINDOW} state_params;
 state_params state_read_params [NUM_AXI-1:0];
 typedef enum logic[2:0] {IDLE_REQ, START_REQ, ISSUE_REQ, BLOCK_REQ, BLOCK_REQ1, DONE_REQ} state_request;
 state_request state_issue_reqs;
@@ -223,7 +258,7 @@ typedef enum logic[2:0] {IDLE_GACT_REQ, ISSUE_GACT_REQ, BLOCK_GACT_REQ1, BLOCK_G
 state_gact_request state_issue_gact_reqs;
 typedef enum logic[4:0] {IDLE0, WAIT0, READ_REF, SEND_REF_BLOCK, IDLE1, READ_QUERY, SEND_QUERY_BLOCK, DONE0, DONE1, CREATE_REF, CREATE_QUERY, STORE_REF1, STORE_REF2, STORE_QUERY1, STORE_QUERY2, REF_BLOCK1, QUERY_BLOCK1, REF_BLOCK2, QUERY_BLOCK2, CREATE_REF1, CREATE_REF2, CREATE_QUERY1, CREATE_QUERY2} state_bram_fill;
 state_bram_fill state_ref_fill [NUM_AXI-1:0];
-typedef enum logic[3:0] {IDLE_OUT, CREATE_OUT, BLOCK_OUT1, START_OUT, BLOCK_OUT, SEND_OUTPUT_ADDR, SEND_OUTPUT, DONE_OUT, BLOCK_OUTPUT, WAIT_OUTPUT, SEND_OUTPUT_DONE} state_output;
+typedef enum logic[3:0] {IDLE_OUT, CREATE_OUT, BLOCK_OUT1, START_OUT, BLOCK_OUT, SEND_OUTPUT_ADDR, SEND_OUTPUT, DONE_OUT, WAIT_OUTPUT, SEND_OUTPUT_DONE, START_COUNT, SEND_COUNT_ADDR, SEND_COUNT, SEND_COUNT_DONE} state_output;
 state_output state_out;
 /////////////////////////////////////////////////////////////////////////////
 // Compute Logic
@@ -281,6 +316,24 @@ function [C_AXIS_TDATA_WIDTH-1:0] left_shift(input [C_AXIS_TDATA_WIDTH-1:0] inp,
     return outp;
 endfunction
 
+// smallest chromosome end in the beat that is greater than hit
+function [32-1:0] first_end_above(input [C_AXIS_TDATA_WIDTH-1:0] ends, input [32-1:0] hit);
+    logic  [32-1:0] outp;
+
+    outp = ends[C_AXIS_TDATA_WIDTH-1 -: 32];
+    for(inn = CHRS_PER_BEAT-1; inn >= 0; inn=inn-1) begin
+        if(ends[32*inn +: 32] > hit) begin
+            outp = ends[32*inn +: 32];
+        end
+    end
+
+    return outp;
+endfunction
+
+function [32-1:0] min_len(input [32-1:0] a, input [32-1:0] b);
+    return (a < b) ? a : b;
+endfunction
+
 genvar ft;
 generate
 for (ft = 0; ft < NUM_AXI; ft = ft+1)
@@ -312,6 +365,17 @@ FIFO#(
     .wr_en(query_fifo_wr_en[ft]),
     .rd_en(query_fifo_rd_en[ft])
 );
+
+BRAM#(
+    .ADDR_WIDTH(LOG_MAX_CHR_BEATS),
+    .DATA_WIDTH(C_AXIS_TDATA_WIDTH)
+) chr_table(
+    .clk(aclk), 
+    .addr(chr_addr[ft]),
+    .write_en(chr_wr_en[ft]),
+    .data_in(chr_data_in[ft]),
+    .data_out(chr_data_out[ft])
+);
 end
 endgenerate
 
@@ -913,6 +977,8 @@ always @(posedge aclk) begin
             read_byte_length_params[j] <= 32'd0;
             read_addr_offset_params[j] <= 0;
             tile_iter_params[j] <= 32'd0;
+            chr_wr_en[j] <= 0;
+            lookup_tile[j] <= 3'd0;
         end
         else begin
             case(state_read_params[j])
@@ -953,9 +1019,12 @@ always @(posedge aclk) begin
                 end
 
                 BLOCK1: begin
+                    chr_wr_en[j] <= 0;
                     read_start_params[j] <= 1;
                     read_byte_length_params[j] <= 32'd64;
                     read_addr_offset_params[j] <= batch_params + (j << 6) + (tile_iter << 8);
+                    hit_tile_base[j] <= (tile_iter << 4) + (j << 2);
+                    lookup_tile[j] <= 3'd0;
                 end
 
                 SEND_BATCH_PARAMS_ADDR: begin
@@ -981,6 +1050,75 @@ always @(posedge aclk) begin
                         tile_iter_params[j] <= tile_iter_params[j] + 32'd1;
                     end
                 end
+
+                LOAD_CHR: begin
+                    read_start_params[j] <= 1;
+                    read_byte_length_params[j] <= num_chr_beats << 6;
+                    read_addr_offset_params[j] <= chr_ends;
+                    chr_load_beat[j] <= 0;
+                end
+
+                SEND_CHR_ADDR: begin
+                    read_start_params[j] <= 0;
+                    read_byte_length_params[j] <= 32'd0;
+                    read_addr_offset_params[j] <= 0;
+                end
+
+                READ_CHR: begin
+                    chr_wr_en[j] <= s_axis_tvalid[j];
+                    chr_addr[j] <= chr_load_beat[j][LOG_MAX_CHR_BEATS-1:0];
+                    chr_data_in[j] <= s_axis_tdata[j];
+                    if(s_axis_tvalid[j]) begin
+                        chr_load_beat[j] <= chr_load_beat[j] + 1;
+                    end
+                end
+
+                LOOKUP_START: begin
+                    hit_ref[j] <= data_batch_params[(j << 2) + lookup_tile[j]][32-1:0];
+                    hit_query[j] <= data_batch_params[(j << 2) + lookup_tile[j]][64-1:32];
+                    chr_lo[j] <= 0;
+                    chr_hi[j] <= num_chr_beats - 1;
+                end
+
+                // binary search for the first beat whose last end is above
+                // the hit; the sentinel guarantees there is one
+                LOOKUP_READ: begin
+                    chr_addr[j] <= (chr_lo[j] + chr_hi[j]) >> 1;
+                end
+
+                LOOKUP_WAIT: begin
+                end
+
+                LOOKUP_CMP: begin
+                    if(chr_lo[j] == chr_hi[j]) begin
+                        chr_end[j] <= first_end_above(chr_data_out[j], hit_ref[j]);
+                        hit_ref_start[j] <= (hit_ref[j] < (tile_window >> 1)) ? 32'd0 : hit_ref[j] - (tile_window >> 1);
+                        hit_query_start[j] <= (hit_query[j] < (tile_window >> 1)) ? 32'd0 : hit_query[j] - (tile_window >> 1);
+                    end
+                    else if(chr_data_out[j][C_AXIS_TDATA_WIDTH-1 -: 32] > hit_ref[j]) begin
+                        chr_hi[j] <= chr_addr[j];
+                    end
+                    else begin
+                        chr_lo[j] <= chr_addr[j] + 1;
+                    end
+                end
+
+                // same window as HitTile() on the host: first_tile_size
+                // centred on the hit, clipped to the reference chromosome
+                // and query ends
+                LOOKUP_WINDOW: begin
+                    data_batch_id[(j << 2) + lookup_tile[j]] <= {96'd0, hit_tile_base[j] + lookup_tile[j]};
+                    data_batch_params[(j << 2) + lookup_tile[j]][32-1:0] <= hit_ref_start[j];
+                    data_batch_params[(j << 2) + lookup_tile[j]][96-1:64] <= min_len(tile_window, chr_end[j] - hit_ref_start[j]);
+                    data_batch_params[(j << 2) + lookup_tile[j]][128-1:96] <= min_len(tile_window, query_length - hit_query_start[j]);
+                    if(batch_align_fields[REVERSE_QUERY_BIT]) begin
+                        data_batch_params[(j << 2) + lookup_tile[j]][64-1:32] <= query_length - (hit_query_start[j] + min_len(tile_window, query_length - hit_query_start[j]));
+                    end
+                    else begin
+                        data_batch_params[(j << 2) + lookup_tile[j]][64-1:32] <= hit_query_start[j];
+                    end
+                    lookup_tile[j] <= lookup_tile[j] + 3'd1;
+                end
             endcase
         end
     end
@@ -998,13 +1136,13 @@ always @(posedge aclk) begin
                         state_read_params[j] <= WAIT_PARAMS; 
                     end
                     else if(ap_start) begin
-                        state_read_params[j] <= BLOCK; 
+                        state_read_params[j] <= (hit_mode) ? LOAD_CHR : BLOCK; 
                     end
                 end
 
                 WAIT_PARAMS: begin
                     if(axi_ready[j]) begin
-                        state_read_params[j] <= BLOCK; 
+                        state_read_params[j] <= (hit_mode) ? BLOCK1 : BLOCK; 
                     end
                 end
 
@@ -1032,7 +1170,7 @@ always @(posedge aclk) begin
 
                 READ_BATCH_PARAMS: begin
                     if(s_axis_tvalid[j] && s_axis_tlast[j]) begin
-                        state_read_params[j] <= DONE_PARAMS; 
+                        state_read_params[j] <= (hit_mode) ? LOOKUP_START : DONE_PARAMS; 
                     end
                 end
 
@@ -1041,6 +1179,50 @@ always @(posedge aclk) begin
                         state_read_params[j] <= IDLE_PARAMS;
                     end
                 end
+
+                LOAD_CHR: begin
+                    state_read_params[j] <= SEND_CHR_ADDR;
+                end
+
+                SEND_CHR_ADDR: begin
+                    state_read_params[j] <= READ_CHR;
+                end
+
+                READ_CHR: begin
+                    if(s_axis_tvalid[j] && s_axis_tlast[j]) begin
+                        state_read_params[j] <= BLOCK1; 
+                    end
+                end
+
+                LOOKUP_START: begin
+                    state_read_params[j] <= LOOKUP_READ;
+                end
+
+                LOOKUP_READ: begin
+                    state_read_params[j] <= LOOKUP_WAIT;
+                end
+
+                LOOKUP_WAIT: begin
+                    state_read_params[j] <= LOOKUP_CMP;
+                end
+
+                LOOKUP_CMP: begin
+                    if(chr_lo[j] == chr_hi[j]) begin
+                        state_read_params[j] <= LOOKUP_WINDOW;
+                    end
+                    else begin
+                        state_read_params[j] <= LOOKUP_READ;
+                    end
+                end
+
+                LOOKUP_WINDOW: begin
+                    if(lookup_tile[j] == NUM_TILES_PER_BATCH - 1) begin
+                        state_read_params[j] <= DONE_PARAMS;
+                    end
+                    else begin
+                        state_read_params[j] <= LOOKUP_START;
+                    end
+                end
             endcase
         end
     end
@@ -1231,10 +1413,20 @@ always @(posedge aclk) begin
     end
 end
 
+// Output stream: only the tiles scoring at least score_threshold are written
+// back. Each passing tile is packed into a 128-bit record
+// {query_max_pos, ref_max_pos, score, tile_id}, NUM_OUT_RECORDS records to a
+// beat, starting at the second beat of batch_tile_output. Once the whole
+// batch is done, the first beat is written with the number of passing tiles
+// in its lowest word. Beats are written as single-beat transfers since the
+// length of the stream is only known at the end of the batch.
 always @(posedge aclk) begin
     if(areset) begin
         num_tiles_done <= 32'd0;
         num_inner_tiles_done <= 32'd0;
+        num_tiles_passed <= 32'd0;
+        num_out_records <= 32'd0;
+        num_out_beats <= 32'd0;
         write_start_reg <= 4'b0000; 
         m_axis_tvalid_reg <= 4'b0000;
         write_byte_length_logic[0] <= 0;
@@ -1255,17 +1447,9 @@ always @(posedge aclk) begin
                 data_out[0] <= 512'd0;
                 num_tiles_done <= 32'd0;
                 num_inner_tiles_done <= 32'd0;
-            end
-
-            BLOCK_OUTPUT: begin
-                write_start_reg <= 4'b0001; 
-                write_byte_length_logic[0] <= batch_size << 6;
-                write_addr_offset_reg[0] <= batch_tile_output;
-            end
-
-            SEND_OUTPUT_ADDR: begin
-                write_start_reg <= 4'b0000; 
-                write_byte_length_logic[0] <= 32'd0;
+                num_tiles_passed <= 32'd0;
+                num_out_records <= 32'd0;
+                num_out_beats <= 32'd0;
             end
 
             WAIT_OUTPUT: begin
@@ -1275,7 +1459,11 @@ always @(posedge aclk) begin
             end
 
             CREATE_OUT: begin
-                data_out[0] <= tile_output[available_array_output];
+                if($signed(tile_output[available_array_output][95:64]) >= $signed(score_threshold)) begin
+                    data_out[0][num_out_records*OUT_RECORD_WIDTH +: OUT_RECORD_WIDTH] <= {tile_output[available_array_output][159:64], tile_output[available_array_output][31:0]};
+                    num_out_records <= num_out_records + 32'd1;
+                    num_tiles_passed <= num_tiles_passed + 32'd1;
+                end
                 clear_done[available_array_output] <= 1;          
                 num_tiles_done <= num_tiles_done + 32'd1;
                 num_inner_tiles_done <= num_inner_tiles_done + 32'd1;
@@ -1291,17 +1479,56 @@ always @(posedge aclk) begin
                 end
             end
 
+            START_OUT: begin
+                write_start_reg <= 4'b0001; 
+                write_byte_length_logic[0] <= DATA_WIDTH_BYTE;
+                write_addr_offset_reg[0] <= batch_tile_output + ((num_out_beats + 32'd1) * DATA_WIDTH_BYTE);
+            end
+
+            SEND_OUTPUT_ADDR: begin
+                write_start_reg <= 4'b0000; 
+                write_byte_length_logic[0] <= 32'd0;
+            end
+
             SEND_OUTPUT: begin
                 m_axis_tvalid_reg <= 4'b0001;
             end
 
             SEND_OUTPUT_DONE: begin
                 m_axis_tvalid_reg <= 4'b0000;
+                if(write_done[0] == 1) begin
+                    data_out[0] <= 512'd0;
+                    num_out_records <= 32'd0;
+                    num_out_beats <= num_out_beats + 32'd1;
+                end
+            end
+
+            START_COUNT: begin
+                write_start_reg <= 4'b0001; 
+                write_byte_length_logic[0] <= DATA_WIDTH_BYTE;
+                write_addr_offset_reg[0] <= batch_tile_output;
+                data_out[0] <= {{(C_AXIS_TDATA_WIDTH-32){1'b0}}, num_tiles_passed};
+            end
+
+            SEND_COUNT_ADDR: begin
+                write_start_reg <= 4'b0000; 
+                write_byte_length_logic[0] <= 32'd0;
+            end
+
+            SEND_COUNT: begin
+                m_axis_tvalid_reg <= 4'b0001;
+            end
+
+            SEND_COUNT_DONE: begin
+                m_axis_tvalid_reg <= 4'b0000;
             end
 
             DONE_OUT: begin
                 num_tiles_done <= 32'd0;
                 num_inner_tiles_done <= 32'd0;
+                num_tiles_passed <= 32'd0;
+                num_out_records <= 32'd0;
+                num_out_beats <= 32'd0;
                 write_start_reg <= 4'b0000; 
                 m_axis_tvalid_reg <= 4'b0000;
                 write_byte_length_logic[0] <= 0;
@@ -1319,18 +1546,10 @@ always @(posedge aclk) begin
         case(state_out)
             IDLE_OUT: begin
                 if(ap_start) begin
-                    state_out <= BLOCK_OUTPUT;
+                    state_out <= WAIT_OUTPUT;
                 end
             end
 
-            BLOCK_OUTPUT: begin
-                state_out <= SEND_OUTPUT_ADDR;
-            end
-
-            SEND_OUTPUT_ADDR: begin
-                state_out <= WAIT_OUTPUT;
-            end
-
             WAIT_OUTPUT: begin
                 if(done > {NUM_BANDED_ARRAYS{1'b0}}) begin
                     state_out <= CREATE_OUT; 
@@ -1346,29 +1565,58 @@ always @(posedge aclk) begin
             end
 
             BLOCK_OUT: begin
-                if(num_inner_tiles_done == 1) begin //NUM_TILES_PER_BATCH) begin
-                    state_out <= SEND_OUTPUT; 
+                if((num_out_records == NUM_OUT_RECORDS) || ((num_tiles_done == batch_size) && (num_out_records > 0))) begin
+                    state_out <= START_OUT; 
+                end
+                else if(num_tiles_done == batch_size) begin
+                    state_out <= START_COUNT;
                 end
                 else begin
                     state_out <= WAIT_OUTPUT;
                 end
             end
 
+            START_OUT: begin
+                state_out <= SEND_OUTPUT_ADDR;
+            end
+
+            SEND_OUTPUT_ADDR: begin
+                state_out <= SEND_OUTPUT;
+            end
+
             SEND_OUTPUT: begin
                 state_out <= SEND_OUTPUT_DONE;
             end
 
             SEND_OUTPUT_DONE: begin
-                if(num_tiles_done < batch_size) begin
-                    state_out <= WAIT_OUTPUT;
-                end
-                else begin
-                    if(write_done[0] == 1) begin
-                        state_out <= DONE_OUT;
+                if(write_done[0] == 1) begin
+                    if(num_tiles_done < batch_size) begin
+                        state_out <= WAIT_OUTPUT;
+                    end
+                    else begin
+                        state_out <= START_COUNT;
                     end
                 end
             end
 
+            START_COUNT: begin
+                state_out <= SEND_COUNT_ADDR;
+            end
+
+            SEND_COUNT_ADDR: begin
+                state_out <= SEND_COUNT;
+            end
+
+            SEND_COUNT: begin
+                state_out <= SEND_COUNT_DONE;
+            end
+
+            SEND_COUNT_DONE: begin
+                if(write_done[0] == 1) begin
+                    state_out <= DONE_OUT;
+                end
+            end
+
             DONE_OUT: begin
                 state_out <= IDLE_OUT;
             end
@@ -1391,6 +1639,8 @@ end
 endgenerate
 
 assign start_params = (tile_count == 32'd16);
+assign hit_mode = (tile_window != 32'd0);
+assign num_chr_beats = (num_chrs + CHRS_PER_BEAT - 1) / CHRS_PER_BEAT;
 assign axi_req_ready = axi_ready & ref_fifo_empty & query_fifo_empty & axi_ready_params;
 
 assign GACT_available = GACT_ready & ~GACT_issued;
@@ -196,6 +196,11 @@ wire [64-1:0]                       query_seq                     ;
 wire [64-1:0]                       batch_id                      ;
 wire [64-1:0]                       batch_params                  ;
 wire [64-1:0]                       batch_tile_output             ;
+wire [32-1:0]                       score_threshold               ;
+wire [32-1:0]                       tile_window                   ;
+wire [32-1:0]                       query_length                  ;
+wire [32-1:0]                       num_chrs                      ;
+wire [64-1:0]                       chr_ends                      ;
 
 // Register and invert reset signal.
 always @(posedge ap_clk) begin
@@ -255,7 +260,12 @@ inst_axi_slave (
   .query_seq          ( query_seq             ),
   .batch_id           ( batch_id              ),
   .batch_params       ( batch_params          ),
-  .batch_tile_output  ( batch_tile_output     )
+  .batch_tile_output  ( batch_tile_output     ),
+  .score_threshold    ( score_threshold       ),
+  .tile_window        ( tile_window           ),
+  .query_length       ( query_length          ),
+  .num_chrs           ( num_chrs              ),
+  .chr_ends           ( chr_ends              )
 );
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -368,7 +378,12 @@ inst_kernel (
   .query_seq          ( query_seq          ),
   .batch_id           ( batch_id           ),
   .batch_params       ( batch_params       ),
-  .batch_tile_output  ( batch_tile_output  )
+  .batch_tile_output  ( batch_tile_output  ),
+  .score_threshold    ( score_threshold    ),
+  .tile_window        ( tile_window        ),
+  .query_length       ( query_length       ),
+  .num_chrs           ( num_chrs           ),
+  .chr_ends           ( chr_ends           )
 );
 
 endmodule
@@ -108,6 +108,16 @@ module GACTX_Array #(
   reg [2*NUM_DIR_BLOCK-1:0] dir_data_in;
   wire [DIR_BRAM_ADDR_WIDTH-1:0] dir_wr_addr;
 
+  // align_fields[6] packs the traceback as 16-bit {dir, run length} tokens,
+  // NUM_RUN_BLOCK per word, instead of NUM_DIR_BLOCK 2-bit directions
+  localparam TB_RUN_WIDTH = 14;
+  localparam NUM_RUN_BLOCK = (2*NUM_DIR_BLOCK) / (TB_RUN_WIDTH + 2);
+  reg tb_rle;
+  wire [TB_RUN_WIDTH-1:0] dir_run;
+  wire [TB_RUN_WIDTH+1:0] dir_token;
+  wire [11:0] dir_shift;
+  wire [7:0] dir_last;
+
   wire array_done;
   reg rst_array;
 
@@ -165,6 +175,10 @@ module GACTX_Array #(
   reg query_reverse;
   reg start_last; // 1 - start traceback from bottom right, 0 - start from max score cell 
 
+  assign dir_token = tb_rle ? {dir, dir_run} : dir;
+  assign dir_shift = tb_rle ? ((TB_RUN_WIDTH + 2) * dir_count) : (2 * dir_count);
+  assign dir_last = tb_rle ? (NUM_RUN_BLOCK - 1) : (NUM_DIR_BLOCK - 1);
+
   integer i, j;
   always @(*) begin
       ref_array_in = 0;
@@ -198,7 +212,8 @@ module GACTX_Array #(
       .REF_LEN_WIDTH(LOG_MAX_TILE_SIZE),
       .QUERY_LEN_WIDTH(LOG_MAX_TILE_SIZE),
       .PE_WIDTH(PE_WIDTH),
-      .PARAM_ADDR_WIDTH(LOG_MAX_TILE_SIZE)
+      .PARAM_ADDR_WIDTH(LOG_MAX_TILE_SIZE),
+      .TB_RUN_WIDTH(TB_RUN_WIDTH)
   ) inst_array_top (
       .clk (clk),
       .rst (rst_array),
@@ -223,6 +238,7 @@ module GACTX_Array #(
       .query_bram_data_in (query_array_in),
 
       .start_last(start_last),
+      .tb_rle(tb_rle),
 
       .max_score(max_score),
       .H_offset(H_offset),
@@ -236,6 +252,7 @@ module GACTX_Array #(
       .query_max_score_pos(query_max_score_pos),
 
       .dir(dir),
+      .dir_run(dir_run),
       .dir_valid(dir_valid),
 
       .done(array_done)
@@ -267,6 +284,7 @@ module GACTX_Array #(
                   query_reverse <= align_fields[2];
                   query_complement <= align_fields[1];
                   start_last <= align_fields[0];
+                  tb_rle <= align_fields[6];
                   max_H_offset <= max_tb_steps;
                   max_V_offset <= max_tb_steps;
                   ref_length <= ref_len;
@@ -280,12 +298,12 @@ module GACTX_Array #(
               if (dir_valid) begin
                   // TODO
                   if (dir_count == 0) begin
-                      dir_data_in <= dir; 
+                      dir_data_in <= dir_token; 
                   end
                   else begin
-                      dir_data_in <= (dir << 2*dir_count) + dir_data_in;
+                      dir_data_in <= (dir_token << dir_shift) + dir_data_in;
                   end
-                  if (dir_count == NUM_DIR_BLOCK-1) begin
+                  if (dir_count == dir_last) begin
                       dir_wr_en <= 1;
                       dir_total_count <= dir_total_count + 1;
 //                      dir_count <= dir_count + 1;
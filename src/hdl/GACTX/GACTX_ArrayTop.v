@@ -31,7 +31,8 @@ module GACTX_ArrayTop #(
     parameter REF_LEN_WIDTH = 10,
     parameter QUERY_LEN_WIDTH = 10,
     parameter PE_WIDTH = 8,
-    parameter PARAM_ADDR_WIDTH = 10
+    parameter PARAM_ADDR_WIDTH = 10,
+    parameter TB_RUN_WIDTH = 14
 )(
     input  clk,         
     input  rst,        
@@ -54,6 +55,7 @@ module GACTX_ArrayTop #(
 
     input [PE_WIDTH-1:0] y_in, 
     input start_last,
+    input tb_rle,
 
     output reg [PE_WIDTH-1:0] max_score,
     output reg [REF_LEN_WIDTH-1:0] H_offset,
@@ -67,6 +69,7 @@ module GACTX_ArrayTop #(
     output reg [(REF_LEN_WIDTH + (QUERY_LEN_WIDTH - LOG_NUM_PE))+LOG_NUM_PE-1:0] num_tb_steps,
 
     output wire [1:0] dir,
+    output wire [TB_RUN_WIDTH-1:0] dir_run,
     output wire dir_valid,
 
     output done);
@@ -191,6 +194,7 @@ module GACTX_ArrayTop #(
     wire [LOG_NUM_PE-1:0] bt_logic_next_pe_diag;
     wire bt_logic_addr_valid;
     wire [1:0] bt_logic_dir_out;
+    wire [TB_RUN_WIDTH-1:0] bt_logic_dir_run;
     wire [REF_LEN_WIDTH-1:0] bt_logic_H_offset;
     wire [REF_LEN_WIDTH-1:0] bt_logic_V_offset;
     wire bt_logic_dir_valid;
@@ -315,6 +319,7 @@ module GACTX_ArrayTop #(
 
 
     assign dir = bt_logic_dir_out; 
+    assign dir_run = bt_logic_dir_run;
     assign dir_valid = bt_logic_dir_valid;
 
     assign param = (curr_query_len > query_length) ? 0 : param_out;
@@ -918,11 +923,13 @@ module GACTX_ArrayTop #(
   GACTX_BTLogic #(
       .ADDR_WIDTH(BT_BRAM_ADDR_WIDTH),
       .REF_LEN_WIDTH(REF_LEN_WIDTH),
-      .LOG_NUM_PE(LOG_NUM_PE)
+      .LOG_NUM_PE(LOG_NUM_PE),
+      .TB_RUN_WIDTH(TB_RUN_WIDTH)
   ) inst_bt_logic (
       .clk(clk),
       .rst(rst),
       .start(bt_logic_start),
+      .tb_rle(tb_rle),
 
       .ref_length(bt_ref_length),
       .max_score_addr(bt_logic_max_score_addr),
@@ -943,6 +950,7 @@ module GACTX_ArrayTop #(
       .next_pe_diag(bt_logic_next_pe_diag),
       .addr_valid(bt_logic_addr_valid),
       .dir(bt_logic_dir_out),
+      .dir_run(bt_logic_dir_run),
       .dir_valid(bt_logic_dir_valid),
       .H_offset(bt_logic_H_offset),
       .max_H_offset(max_H_offset),
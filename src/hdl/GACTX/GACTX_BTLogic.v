@@ -24,12 +24,14 @@ SOFTWARE.
 module GACTX_BTLogic #(
   parameter ADDR_WIDTH = 20,
   parameter REF_LEN_WIDTH = 12,
-  parameter LOG_NUM_PE = 6
+  parameter LOG_NUM_PE = 6,
+  parameter TB_RUN_WIDTH = 14
 )
 (
     input clk,
     input rst,
     input start,
+    input tb_rle,
 
     input [REF_LEN_WIDTH-1:0] ref_length,
     input [ADDR_WIDTH-1:0] max_score_mod_addr,
@@ -49,6 +51,7 @@ module GACTX_BTLogic #(
     output wire [LOG_NUM_PE-1:0] next_pe_diag,
     output wire addr_valid,
     output wire [1:0] dir,
+    output wire [TB_RUN_WIDTH-1:0] dir_run,
     output wire dir_valid,
     output wire [REF_LEN_WIDTH-1:0] start_pos_addr,
     output wire [REF_LEN_WIDTH-1:0] next_stop_pos_addr,
@@ -61,6 +64,7 @@ module GACTX_BTLogic #(
 );
 
   localparam MAX_PE = (2**LOG_NUM_PE) - 1;
+  localparam MAX_RUN = (2**TB_RUN_WIDTH) - 1;
 
   reg [REF_LEN_WIDTH-1:0] max_stripe;
   reg [ADDR_WIDTH-1:0] mod_count;
@@ -76,6 +80,14 @@ module GACTX_BTLogic #(
   reg [REF_LEN_WIDTH-1:0] curr_stop_pos;
   reg [REF_LEN_WIDTH-1:0] position_addr;
 
+  // with tb_rle, consecutive steps in the same direction are emitted as one
+  // {dir, dir_run} token when the direction changes and at the end of the
+  // traceback
+  reg [1:0] run_dir;
+  reg [TB_RUN_WIDTH-1:0] run_len;
+  wire [1:0] step_dir;
+  wire run_end;
+
   localparam WAIT=0, BLOCK0=1, BLOCK1=2, BLOCK2=3, CALC=4, DONE=5;
   localparam ZERO=0, M=3, V=1, H=2;
 
@@ -86,9 +98,13 @@ module GACTX_BTLogic #(
   wire [REF_LEN_WIDTH-1:0] next_H_offset;
 
   assign done = (state == DONE);
-  assign dir_valid = (state == CALC) && (dir != 0);
   assign addr_valid = (next_state == CALC);
-  assign dir = next_pe_state;
+  assign step_dir = next_pe_state;
+
+  assign run_end = (state == CALC) && (step_dir != 0) && (run_len > 0) && ((step_dir != run_dir) || (run_len == MAX_RUN));
+  assign dir = tb_rle ? run_dir : step_dir;
+  assign dir_run = run_len;
+  assign dir_valid = tb_rle ? (run_end || ((state == DONE) && (run_len > 0))) : ((state == CALC) && (step_dir != 0));
 
   assign start_pos_addr = position_addr;
   assign next_stop_pos_addr = position_addr;
@@ -124,6 +140,7 @@ module GACTX_BTLogic #(
                   H_offset <= 0;
                   V_offset <= 0;
                   num_tb_steps <= 0;
+                  run_len <= 0;
                   final_H <= 0;
                   final_V <= 0;
                   stripe_change <= 0;
@@ -144,7 +161,16 @@ module GACTX_BTLogic #(
               CALC: begin
                   H_offset <= next_H_offset;
                   V_offset <= next_V_offset;
-                  num_tb_steps <= num_tb_steps + (dir != 0);
+                  num_tb_steps <= num_tb_steps + (step_dir != 0);
+                  if (step_dir != 0) begin
+                      if (run_end || (run_len == 0)) begin
+                          run_dir <= step_dir;
+                          run_len <= 1;
+                      end
+                      else begin
+                          run_len <= run_len + 1;
+                      end
+                  end
 
                   //////////////////////////////////////////////////////////////////
                   if (next_pe_state == M) begin
@@ -269,6 +295,7 @@ module GACTX_BTLogic #(
                   end
               end
              DONE: begin
+                 run_len <= 0;
              end
          endcase
      end
@@ -0,0 +1,51 @@
+/*
+MIT License
+
+Copyright (c) 2018 Yatish Turakhia, Sneha D. Goenka, Gill Bejerano and William Dally
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// Converting packed 2-bit bases (A=0, C=1, G=2, T=3) with an N mask bit to
+// Nucleotide bases, with the same output encoding as Ascii2Nt. Not yet
+// instantiated: the kernels read ASCII sequences and the host rejects
+// packed_seq = 1 for the fpga and hybrid backends.
+module Packed2Nt (
+    input [1:0] code,
+    input n_mask,
+    input complement,
+    output reg [3:0] nt);
+
+    localparam A=1, C=2, G=3, T=4, N=0;
+
+    always @(*) begin
+        if (n_mask) begin
+            nt = N;
+        end
+        else begin
+            case (code)
+                2'b00 : nt = (complement) ? T : A;
+                2'b01 : nt = (complement) ? G : C;
+                2'b10 : nt = (complement) ? C : G;
+                2'b11 : nt = (complement) ? A : T;
+            endcase
+        end
+    end
+endmodule
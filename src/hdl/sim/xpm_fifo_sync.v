@@ -0,0 +1,119 @@
+/*
+MIT License
+
+Copyright (c) 2019 Sneha D. Goenka, Yatish Turakhia, Gill Bejerano and William J. Dally
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Behavioural stand-in for the Xilinx xpm_fifo_sync macro, used only when
+// the kernels are verilated (bsw_kernel_bench). It models the first-word
+// fall-through mode of the AXI masters: data_valid is set while the FIFO
+// holds a word, dout is that word and full is held during reset. The other
+// outputs are tied off and the remaining parameters are ignored.
+
+module xpm_fifo_sync #(
+    parameter FIFO_MEMORY_TYPE = "auto",
+    parameter ECC_MODE = "no_ecc",
+    parameter integer FIFO_WRITE_DEPTH = 16,
+    parameter integer WRITE_DATA_WIDTH = 32,
+    parameter integer WR_DATA_COUNT_WIDTH = 5,
+    parameter integer PROG_FULL_THRESH = 10,
+    parameter integer FULL_RESET_VALUE = 1,
+    parameter USE_ADV_FEATURES = "0707",
+    parameter READ_MODE = "fwft",
+    parameter integer FIFO_READ_LATENCY = 1,
+    parameter integer READ_DATA_WIDTH = 32,
+    parameter integer RD_DATA_COUNT_WIDTH = 5,
+    parameter integer PROG_EMPTY_THRESH = 10,
+    parameter DOUT_RESET_VALUE = "0",
+    parameter integer WAKEUP_TIME = 0
+)(
+    input sleep,
+    input rst,
+    input wr_clk,
+    input wr_en,
+    input [WRITE_DATA_WIDTH-1:0] din,
+    output full,
+    output overflow,
+    output prog_full,
+    output [WR_DATA_COUNT_WIDTH-1:0] wr_data_count,
+    output almost_full,
+    output wr_ack,
+    output wr_rst_busy,
+    input rd_en,
+    output [READ_DATA_WIDTH-1:0] dout,
+    output empty,
+    output prog_empty,
+    output [RD_DATA_COUNT_WIDTH-1:0] rd_data_count,
+    output almost_empty,
+    output data_valid,
+    output underflow,
+    output rd_rst_busy,
+    input injectsbiterr,
+    input injectdbiterr,
+    output sbiterr,
+    output dbiterr
+);
+localparam integer ADDR_WIDTH = $clog2(FIFO_WRITE_DEPTH);
+
+reg [WRITE_DATA_WIDTH-1:0] mem [0:FIFO_WRITE_DEPTH-1];
+reg [ADDR_WIDTH-1:0] head, tail;
+reg [ADDR_WIDTH:0] total;
+
+wire do_write = wr_en && !full;
+wire do_read = rd_en && !empty;
+
+assign full = rst ? (FULL_RESET_VALUE != 0) : (total == FIFO_WRITE_DEPTH);
+assign empty = (total == 0);
+assign data_valid = !empty;
+assign dout = mem[head];
+
+assign overflow = wr_en && full;
+assign underflow = rd_en && empty;
+assign prog_full = (total >= PROG_FULL_THRESH);
+assign prog_empty = (total <= PROG_EMPTY_THRESH);
+assign almost_full = (total >= FIFO_WRITE_DEPTH-1);
+assign almost_empty = (total <= 1);
+assign wr_data_count = total;
+assign rd_data_count = total;
+assign wr_ack = do_write;
+assign wr_rst_busy = rst;
+assign rd_rst_busy = rst;
+assign sbiterr = 1'b0;
+assign dbiterr = 1'b0;
+
+always @(posedge wr_clk) begin
+    if (rst) begin
+        head <= 0;
+        tail <= 0;
+        total <= 0;
+    end
+    else begin
+        if (do_write) begin
+            mem[tail] <= din;
+            tail <= tail + 1;
+        end
+        if (do_read) begin
+            head <= head + 1;
+        end
+        total <= total + do_write - do_read;
+    end
+end
+endmodule
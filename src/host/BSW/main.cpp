@@ -41,6 +41,8 @@ SOFTWARE.
 #include "Chameleon.h"
 #include <iostream>
 #include <fstream>
+#include <climits>
+#include <vector>
 
 ////////////////////////////////////////////////////////////////////////////////
 struct Configuration {
@@ -92,13 +94,16 @@ int load_file_to_memory(const char *filename, char **result){
 
 int main(int argc, char** argv){
 
-    if (argc != 3) {
-        printf("Usage: %s xclbin batch_size\n", argv[0]);
+    if ((argc != 3) && (argc != 4)) {
+        printf("Usage: %s xclbin batch_size [score_threshold]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
     char *xclbin = argv[1];
     int new_batch_size = std::atoi(argv[2]); 
+    // tiles scoring below the threshold are dropped by the kernel; by default
+    // all tiles are returned so that the output matches results.txt
+    int score_threshold = (argc == 4) ? std::atoi(argv[3]) : INT_MIN;
     int batch_size = new_batch_size;
 
     if(new_batch_size %16 != 0){
@@ -460,6 +465,14 @@ int main(int argc, char** argv){
     err |= clSetKernelArg(kernel, 18, sizeof(cl_mem), &batch_id);
     err |= clSetKernelArg(kernel, 19, sizeof(cl_mem), &batch_params);
     err |= clSetKernelArg(kernel, 20, sizeof(cl_mem), &batch_tile_output);
+    err |= clSetKernelArg(kernel, 21, sizeof(int),   &score_threshold);
+    // explicit tiles: no tile window, query length or chromosome table; the
+    // chromosome table argument is not read
+    uint tile_window = 0;
+    err |= clSetKernelArg(kernel, 22, sizeof(uint),  &tile_window);
+    err |= clSetKernelArg(kernel, 23, sizeof(uint),  &tile_window);
+    err |= clSetKernelArg(kernel, 24, sizeof(uint),  &tile_window);
+    err |= clSetKernelArg(kernel, 25, sizeof(cl_mem), &batch_id);
 
     if (err != CL_SUCCESS) {
         printf("Error: Failed to set kernel arguments! %d\n", err);
@@ -487,11 +500,25 @@ int main(int argc, char** argv){
 
     clWaitForEvents(1, &readevent);
 
-    for (uint i = 0; i < batch_size; i++) {
-        int tile_id = h_batch_tile_output[i*16];
-        int tile_score = h_batch_tile_output[i*16+2];
-        int tile_ref = h_batch_tile_output[i*16+3];
-        int tile_query = h_batch_tile_output[i*16+4];
+    // the first 16 words hold the number of passing tiles, followed by one
+    // 4-word record {tile_id, score, ref_max_pos, query_max_pos} per passing
+    // tile in completion order
+    int num_passed = h_batch_tile_output[0];
+    std::vector<int> record_idx;
+    for (int i = 0; i < num_passed; i++) {
+        if (h_batch_tile_output[16+4*i] < new_batch_size) {
+            record_idx.push_back(i);
+        }
+    }
+    std::sort(record_idx.begin(), record_idx.end(), [&](int a, int b) {
+        return h_batch_tile_output[16+4*a] < h_batch_tile_output[16+4*b];
+    });
+
+    for (int i: record_idx) {
+        int tile_id = h_batch_tile_output[16+4*i];
+        int tile_score = h_batch_tile_output[16+4*i+1];
+        int tile_ref = h_batch_tile_output[16+4*i+2];
+        int tile_query = h_batch_tile_output[16+4*i+3];
 
         printf("%d, %d, %d, %d\n", tile_id, tile_score, tile_ref, tile_query);
     }
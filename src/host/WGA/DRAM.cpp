@@ -1,9 +1,34 @@
 #include "DRAM.h"
+#include "seed_pos_table.h"
 #include <memory>
+#include <stdio.h>
+#include <sys/mman.h>
 
 #include "tbb/scalable_allocator.h"
 #include "tbb/tbb.h"
 
+#ifdef WIDE_COORD
+// Host memory only: the whole coordinate range is reserved for the reference
+// and the query slots, and pages are backed as they are written
+DRAM::DRAM()
+	: size(1ull << REF_COORD_BITS),
+	referenceSize(0),
+	bufferPosition(0)
+{
+
+	buffer = (char*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (buffer == MAP_FAILED) {
+		fprintf(stderr, "Could not reserve %lu bytes for the reference and queries\n", size);
+		exit(1);
+	}
+}
+
+
+DRAM::~DRAM()
+{
+    munmap(buffer, size);
+}
+#else
 DRAM::DRAM()
 	: size(4ull * 1024ull * 1024ull * 1024ull), // 4GB FPGA memory
 	referenceSize(0),
@@ -18,3 +43,4 @@ DRAM::~DRAM()
 {
     scalable_aligned_free(buffer);
 }
+#endif
@@ -1,19 +1,55 @@
 #include "Processor.h"
+#include <CL/opencl.h>
+#include <CL/cl_ext.h>
 #include "graph.h"
+#include "seq_pack.h"
+#include "cpu_align.h"
+#include "kernel_cost.h"
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <deque>
+#include <future>
 #include <cstring>
+#include <sstream>
 #include "tbb/scalable_allocator.h"
+#include "tbb/task_group.h"
 
-#define NUM_KERNELS 4
 #define NUM_BANKS 4
+#define NUM_SLOTS 4
 #define MAX_BANDED_TILE_SIZE 512
 #define MAX_GACTX_TILE_SIZE 2048
-#define MAX_GACTX_TB_BYTES MAX_GACTX_TILE_SIZE/2
-
-std::mutex fpga_lock[NUM_KERNELS];
-std::mutex gactx_lock;
-std::mutex rw_lock;
-std::atomic<int> num_executing[NUM_KERNELS];
+// a tile has up to 2*MAX_GACTX_TILE_SIZE traceback steps of 2 bits, or with
+// cfg.tb_rle at worst one 16-bit run-length token per step
+#define MAX_GACTX_TB_BYTES (4*MAX_GACTX_TILE_SIZE)
+#define NUM_GACTX_SLOTS 8
+#define MAX_KERNEL_ARGS 26
+#define NUM_QUERY_SLOTS 2
+
+// BSW result stream: a 16-int header beat holding the number of tiles that
+// passed the score threshold, then 4-int records, 4 to a 64-byte beat
+#define BSW_OUT_HEADER_INTS 16
+#define BSW_OUT_RECORDS_PER_BEAT 4
+
+// A BSW request is split into launches whose fitted fixed overhead is at most
+// this fraction of their predicted compute time
+#define BSW_MAX_OVERHEAD_FRACTION 0.1
+
+// Hit mode: the chromosome end table is held in chr_ends, 16 ends to a beat,
+// and each AXI of a BSW kernel keeps a copy of up to 256 beats in BRAM
+#define BSW_CHR_ENDS_PER_BEAT 16
+#define BSW_MAX_CHR_ENDS 4096
+
+// BSW kernel pool: callers are parked on pool_cv and served in ticket order
+std::mutex pool_lock;
+std::condition_variable pool_cv;
+uint64_t pool_next_ticket = 0;
+uint64_t pool_now_serving = 0;
+uint64_t pool_num_grants = 0;
+uint64_t pool_num_waits = 0;
+uint64_t pool_total_wait_us = 0;
+uint64_t pool_max_wait_us = 0;
 
 const char A_NT = 0;
 const char C_NT = 1;
@@ -24,17 +60,7 @@ const char N_NT = 4;
 int err;                            // error code returned from api calls
 int check_status = 0;
 
-int start_op[NUM_KERNELS];
-
 cl_platform_id platform_id;         // platform id
-cl_device_id device_id;             // compute device id
-cl_context context;                 // compute context
-cl_command_queue commands[NUM_KERNELS];          // compute command queue
-cl_program program;                 // compute programs
-cl_kernel kernel[NUM_KERNELS];                   // compute kernel
-
-cl_kernel gactx_kernel;
-cl_command_queue gactx_commands; 
 
 char cl_platform_vendor[1001];
 char target_device_name[1001] = TARGET_DEVICE;
@@ -47,14 +73,159 @@ uint num_ints_per_tile_out = 16;
 // Create structs to define memory bank mapping
 cl_mem_ext_ptr_t d_bank_ext[NUM_BANKS];
 
-cl_mem d_ref_seq[NUM_BANKS];
-cl_mem d_query_seq[NUM_BANKS];
-cl_mem d_batch_id[NUM_BANKS];
-cl_mem d_batch_params[NUM_BANKS];
-cl_mem d_batch_tile_output[NUM_BANKS][4];
-
-cl_mem d_gactx_tile_output;
-cl_mem d_gactx_tb_output;
+// One per card matching TARGET_DEVICE, each with its own context, kernels and
+// copy of the reference and query in every bank it has kernels on. The
+// kernels of all cards share the BSW kernel pool and the GACT-X submission
+// queue, so batches and tiles go to whichever card has a free kernel.
+//
+// Query buffers: each bank has NUM_QUERY_SLOTS of them. d_query_seq[b] is the
+// slot the kernels currently read, and the next query chromosome is uploaded
+// to another slot while the current one is still being aligned. A slot keeps
+// its device buffer and only grows it for a longer chromosome; a slot grown
+// since it was last active is marked in d_query_slot_grown.
+struct fpga_device {
+    int index;
+    cl_device_id id;
+    cl_context context;
+    cl_program program;
+    cl_command_queue bank_commands[NUM_BANKS];
+    bool bank_used[NUM_BANKS];
+    cl_mem d_ref_seq[NUM_BANKS];
+    cl_mem d_query_seq[NUM_BANKS];
+    cl_mem d_query_slot[NUM_BANKS][NUM_QUERY_SLOTS];
+    size_t d_query_slot_size[NUM_BANKS][NUM_QUERY_SLOTS];
+    bool d_query_slot_grown[NUM_BANKS][NUM_QUERY_SLOTS];
+    cl_event query_upload_event[NUM_BANKS];
+};
+
+std::vector<fpga_device*> fpga_devices;
+
+int query_active_slot = -1;
+bool query_upload_pending = false;
+size_t query_upload_addr = 0;
+size_t query_upload_len = 0;
+uint64_t query_num_uploads = 0;
+uint64_t query_num_prefetched = 0;
+uint64_t query_total_wait_us = 0;
+
+// With cfg.packed_seq the sequences are sent in the packed 2-bit + N mask
+// format of seq_pack.h. The packed query stays in its staging buffer until
+// the asynchronous copy to its slot has completed.
+int pack_isa = ISA_SCALAR;
+std::vector<uint8_t> ref_packed;
+std::vector<uint8_t> query_packed[NUM_QUERY_SLOTS];
+uint64_t seq_ascii_bytes = 0;
+uint64_t seq_upload_bytes = 0;
+
+std::atomic<uint64_t> bsw_readback_bytes(0);
+std::atomic<uint64_t> bsw_input_bytes(0);
+std::atomic<uint64_t> bsw_hit_batches(0);
+std::atomic<uint64_t> gactx_tb_readback_bytes(0);
+std::atomic<uint64_t> gactx_tb_tiles(0);
+
+// With cfg.hit_tiles the BSW kernels take raw seed hits and derive the tile
+// windows themselves. The chromosome end table is written once to the
+// chr_ends buffer of every instance; if it does not fit the kernels, the
+// windows are computed on the host as before.
+bool bsw_hit_mode = false;
+
+// Kernel cost models, calibrated with the execution times of the BSW and
+// GACT-X tasks taken from the event profiling counters
+kernel_cost_fit bsw_cost;
+kernel_cost_fit gactx_cost;
+std::atomic<uint64_t> bsw_num_requests(0);
+std::atomic<uint64_t> bsw_num_chunks(0);
+
+// Values last passed to clSetKernelArg for one kernel. Kernel arguments keep
+// their value across enqueues, so an argument is only set again when it has
+// changed: the scoring arguments are set once at startup and a launch only
+// sets the arguments that differ from the previous launch on that kernel.
+struct kernel_arg_cache {
+    kernel_arg_cache () {
+        memset(size, 0, sizeof(size));
+        memset(value, 0, sizeof(value));
+        num_set = 0;
+        num_skipped = 0;
+    };
+    size_t size[MAX_KERNEL_ARGS];
+    uint64_t value[MAX_KERNEL_ARGS];
+    uint64_t num_set;
+    uint64_t num_skipped;
+};
+
+// One instance per BSW_bank<N> kernel present in the xclbin on each card,
+// bound to DDR bank N of that card. Each instance has its own queue and
+// NUM_SLOTS sets of batch buffers.
+struct bsw_instance {
+    std::string name;
+    fpga_device* dev;
+    int bank;
+    cl_kernel kernel;
+    cl_command_queue commands;
+    std::mutex lock;
+    int num_executing;
+    std::vector<int> free_slots;
+    cl_mem d_batch_id[NUM_SLOTS];
+    cl_mem d_batch_params[NUM_SLOTS];
+    cl_mem d_batch_tile_output[NUM_SLOTS];
+    // chromosome end table of hit mode, shared by all slots
+    cl_mem d_chr_ends;
+    // Page-aligned host staging buffers, one set per slot. They are allocated
+    // once at startup and reused by every batch submitted on that slot; page
+    // alignment lets the runtime DMA straight from/to them without a bounce copy.
+    int* h_batch_id[NUM_SLOTS];
+    int* h_batch_params[NUM_SLOTS];
+    int* h_batch_tile_output[NUM_SLOTS];
+    kernel_arg_cache args;
+    uint64_t num_launches;
+    uint64_t num_tiles;
+    uint64_t launch_ns;
+    // estimated cycles of the batches holding a slot, under pool_lock
+    uint64_t pending_cycles;
+    uint64_t predicted_cycles;
+    double busy_secs;
+};
+
+// One instance per GACTX_bank<N> kernel on each card, each served by its own dispatcher
+// thread that pulls from the shared submission queue
+struct gactx_instance {
+    std::string name;
+    fpga_device* dev;
+    int bank;
+    cl_kernel kernel;
+    cl_command_queue commands;
+    cl_mem d_tile_output[NUM_GACTX_SLOTS];
+    cl_mem d_tb_output[NUM_GACTX_SLOTS];
+    std::thread dispatcher;
+    uint64_t num_groups;
+    uint64_t num_tiles;
+    kernel_arg_cache args;
+    uint64_t launch_ns;
+    uint64_t predicted_cycles;
+    double busy_secs;
+};
+
+std::vector<bsw_instance*> bsw_instances;
+std::vector<gactx_instance*> gactx_instances;
+
+// GACT-X submission queue: extender threads enqueue requests and wait on a
+// future while a single dispatcher thread launches them back-to-back
+struct gactx_request {
+    gactx_request (extend_tile t, uint8_t a)
+        : tile(t),
+          align_fields(a)
+    {};
+    extend_tile tile;
+    uint8_t align_fields;
+    std::promise<extend_output> result;
+};
+
+std::mutex gactx_queue_lock;
+std::condition_variable gactx_queue_cv;
+std::deque<gactx_request*> gactx_queue;
+bool gactx_shutdown = false;
+
+void GACTXDispatcher (gactx_instance* inst);
 
 // Get all platforms and then select Xilinx platform
 cl_platform_id platforms[16];       // platform id
@@ -63,12 +234,9 @@ int platform_found = 0;
 
 
 cl_uint num_devices;
-unsigned int device_found = 0;
 cl_device_id devices[16];  // compute device id
 char cl_device_name[1001];
 
-std::vector<int> available_k;
-
 int status;
 
 int Nt2Int(char nt, int complement)
@@ -100,6 +268,60 @@ int Nt2Int(char nt, int complement)
 
 
 
+// The buffers are not cleared: a batch writes every entry it sends before
+// sending it, and only the pages used by the largest batch get committed,
+// which matters with several kernels on each of several cards
+int* AllocHostBuffer (size_t num_ints) {
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, 4096, num_ints * sizeof(int)) != 0) {
+        fprintf(stderr, "Error: Failed to allocate host buffer!\n");
+        exit(1);
+    }
+    return (int*) ptr;
+}
+
+// Scalar and cl_mem arguments are at most 8 bytes, so the cached copy of an
+// argument fits in one word
+int SetKernelArgCached (cl_kernel kernel, kernel_arg_cache& cache, cl_uint idx, size_t size, const void* value) {
+    uint64_t v = 0;
+    assert(idx < MAX_KERNEL_ARGS);
+    assert(size <= sizeof(v));
+    memcpy(&v, value, size);
+    if ((cache.size[idx] == size) && (cache.value[idx] == v)) {
+        cache.num_skipped++;
+        return CL_SUCCESS;
+    }
+    int ret = clSetKernelArg(kernel, idx, size, value);
+    if (ret == CL_SUCCESS) {
+        cache.size[idx] = size;
+        cache.value[idx] = v;
+    }
+    cache.num_set++;
+    return ret;
+}
+
+// Forces the next SetKernelArgCached of argument idx through to
+// clSetKernelArg. Needed when the buffer an argument was set to is released:
+// a buffer created afterwards can get the same handle value.
+void InvalidateKernelArg (kernel_arg_cache& cache, cl_uint idx) {
+    assert(idx < MAX_KERNEL_ARGS);
+    cache.size[idx] = 0;
+}
+
+// Arguments 0-13 are the same for both kernels and for the whole run: the
+// substitution matrix, the gap penalties and the band size (BSW) or ydrop
+// (GACT-X)
+int SetScoringArgs (cl_kernel kernel, kernel_arg_cache& cache, uint arg13) {
+    int ret = 0;
+    for (int i = 0; i < 11; i++) {
+        ret |= SetKernelArgCached(kernel, cache, i, sizeof(int), &cfg.gact_sub_mat[i]);
+    }
+    ret |= SetKernelArgCached(kernel, cache, 11, sizeof(int), &cfg.gap_open);
+    ret |= SetKernelArgCached(kernel, cache, 12, sizeof(int), &cfg.gap_extend);
+    ret |= SetKernelArgCached(kernel, cache, 13, sizeof(uint), &arg13);
+    return ret;
+}
+
 int load_file_to_memory(const char *filename, char **result)
 {
     uint size = 0;
@@ -121,11 +343,171 @@ int load_file_to_memory(const char *filename, char **result)
     return size;
 }
 
+// Creates the context, program and kernel instances of one card. Returns
+// non-zero on failure.
+int InitializeDevice (fpga_device* dev, unsigned char* kernelbinary, size_t n0) {
+    // Create a compute context
+    //
+    dev->context = clCreateContext(0, 1, &dev->id, NULL, NULL, &err);
+    if (!dev->context) {
+        fprintf(stderr, "Error: Failed to create a compute context!\n");
+        fprintf(stderr, "Test failed\n");
+        return 1;
+    }
+
+    fprintf(stderr, "Creating cl program with binary\n");
+    // Create the compute program from offline
+    dev->program = clCreateProgramWithBinary(dev->context, 1, &dev->id, &n0,
+            (const unsigned char **) &kernelbinary, &status, &err);
+
+    if ((!dev->program) || (err!=CL_SUCCESS)) {
+        fprintf(stderr, "Error: Failed to create compute program from binary %d!\n", err);
+        fprintf(stderr, "Test failed\n");
+        return 1;
+    }
+    fprintf(stderr, "Created cl program with binary\n");
+    fprintf(stderr, "Building Program executable\n");
+
+    // Build the program executable
+    //
+    err = clBuildProgram(dev->program, 0, NULL, NULL, NULL, NULL);
+    if (err != CL_SUCCESS) {
+        size_t len;
+        char buffer[2048];
+
+        fprintf(stderr, "Error: Failed to build program executable!\n");
+        clGetProgramBuildInfo(dev->program, dev->id, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
+        fprintf(stderr, "%s\n", buffer);
+        fprintf(stderr, "Test failed\n");
+        return 1;
+    }
+    fprintf(stderr, "Built Program executable\n");
+
+    fprintf(stderr, "Creating kernels\n");
+
+    // Enumerate the kernels in the program and create one instance for each
+    // BSW_bank<N> and GACTX_bank<N>; the bank is taken from the kernel name
+    size_t names_len = 0;
+    err = clGetProgramInfo(dev->program, CL_PROGRAM_KERNEL_NAMES, 0, NULL, &names_len);
+    std::vector<char> kernel_names(names_len + 1, 0);
+    err |= clGetProgramInfo(dev->program, CL_PROGRAM_KERNEL_NAMES, names_len, kernel_names.data(), NULL);
+    if (err != CL_SUCCESS) {
+        fprintf(stderr, "Error: Failed to get kernel names from program!\n");
+        fprintf(stderr, "Test failed\n");
+        return 1;
+    }
+
+    for (int b = 0; b < NUM_BANKS; b++) {
+        dev->bank_used[b] = false;
+    }
+
+    std::stringstream names_stream(kernel_names.data());
+    std::string s;
+    while (std::getline(names_stream, s, ';')) {
+        s.erase(0, s.find_first_not_of(" \t\n"));
+        s.erase(s.find_last_not_of(" \t\n") + 1);
+        if (s.empty()) {
+            continue;
+        }
+
+        int bank = -1;
+        bool is_bsw = (sscanf(s.c_str(), "BSW_bank%d", &bank) == 1);
+        bool is_gactx = !is_bsw && (sscanf(s.c_str(), "GACTX_bank%d", &bank) == 1);
+
+        if (!is_bsw && !is_gactx) {
+            fprintf(stderr, "INFO: Ignoring kernel %s\n", s.c_str());
+            continue;
+        }
+        if ((bank < 0) || (bank >= NUM_BANKS)) {
+            fprintf(stderr, "Error: Kernel %s refers to a non-existent DDR bank!\n", s.c_str());
+            fprintf(stderr, "Test failed\n");
+            return 1;
+        }
+
+        // kernels are told apart by card when there is more than one
+        std::string name = (fpga_devices.size() > 1) ? ("dev" + std::to_string(dev->index) + "/" + s) : s;
+
+        cl_kernel k = clCreateKernel(dev->program, s.c_str(), &err);
+        if (!k || err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to create compute kernel!\n");
+            fprintf(stderr, "Test failed\n");
+            return 1;
+        }
+
+        // queues are out-of-order so that the transfers of one request can
+        // overlap the execution of another; ordering within a request is
+        // enforced through write -> task -> read event chains. Profiling
+        // gives the kernel execution times the cost models are fitted to.
+        cl_command_queue q = clCreateCommandQueue(dev->context, dev->id,
+                CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_PROFILING_ENABLE, &err);
+        if (!q) {
+            fprintf(stderr, "Error: Failed to create a command commands!\n");
+            fprintf(stderr, "Error: code %i\n",err);
+            fprintf(stderr, "Test failed\n");
+            return 1;
+        }
+
+        if (!dev->bank_used[bank]) {
+            dev->bank_used[bank] = true;
+            dev->bank_commands[bank] = q;
+        }
+
+        if (is_bsw) {
+            bsw_instance* inst = new bsw_instance;
+            inst->name = name;
+            inst->dev = dev;
+            inst->bank = bank;
+            inst->kernel = k;
+            inst->commands = q;
+            inst->num_executing = 0;
+            for (int j = 0; j < NUM_SLOTS; j++) {
+                inst->free_slots.push_back(j);
+            }
+            inst->num_launches = 0;
+            inst->num_tiles = 0;
+            inst->launch_ns = 0;
+            inst->pending_cycles = 0;
+            inst->predicted_cycles = 0;
+            inst->busy_secs = 0;
+            err = SetScoringArgs(k, inst->args, cfg.band_size);
+            bsw_instances.push_back(inst);
+        }
+        else {
+            gactx_instance* inst = new gactx_instance;
+            inst->name = name;
+            inst->dev = dev;
+            inst->bank = bank;
+            inst->kernel = k;
+            inst->commands = q;
+            inst->num_groups = 0;
+            inst->num_tiles = 0;
+            inst->launch_ns = 0;
+            inst->predicted_cycles = 0;
+            inst->busy_secs = 0;
+            err = SetScoringArgs(k, inst->args, cfg.ydrop);
+            gactx_instances.push_back(inst);
+        }
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to set scoring arguments of kernel %s! %d\n", s.c_str(), err);
+            fprintf(stderr, "Test failed\n");
+            return 1;
+        }
+        fprintf(stderr, "INFO: Found kernel %s on DDR bank %d\n", name.c_str(), bank);
+    }
+
+    return 0;
+}
+
 size_t InitializeProcessor (int t, int f, char* xclbin) {
     size_t ret = 0;
 
     fprintf(stderr, "XCLBIN is: %s\n", xclbin);
 
+    if (cfg.packed_seq) {
+        pack_isa = DetectCPUISA();
+        fprintf(stderr, "Sending packed sequences (packer: %s)\n", CPUISAName(pack_isa));
+    }
+
     err = clGetPlatformIDs(16, platforms, &platform_count);
     if (err != CL_SUCCESS) {
         fprintf(stderr, "Error: Failed to find an OpenCL platform!\n");
@@ -162,7 +544,7 @@ size_t InitializeProcessor (int t, int f, char* xclbin) {
         return -1;
     }
 
-    //iterate all devices to select the target device.
+    // use every card matching the target, up to cfg.num_devices if set
     for (uint i=0; i<num_devices; i++) {
         err = clGetDeviceInfo(devices[i], CL_DEVICE_NAME, 1024, cl_device_name, 0);
         if (err != CL_SUCCESS) {
@@ -171,46 +553,21 @@ size_t InitializeProcessor (int t, int f, char* xclbin) {
             return EXIT_FAILURE;
         }
         fprintf(stderr, "CL_DEVICE_NAME %s\n", cl_device_name);
-        if(strcmp(cl_device_name, target_device_name) == 0) {
-            device_id = devices[i];
-            device_found = 1;
-            fprintf(stderr, "Selected %s as the target device\n", cl_device_name);
+        if ((strcmp(cl_device_name, target_device_name) == 0) &&
+                ((cfg.num_devices <= 0) || ((int) fpga_devices.size() < cfg.num_devices))) {
+            fpga_device* dev = new fpga_device();
+            dev->index = fpga_devices.size();
+            dev->id = devices[i];
+            fpga_devices.push_back(dev);
+            fprintf(stderr, "Selected %s (device %d) as target device %d\n", cl_device_name, i, dev->index);
         }
     }
 
-    if (!device_found) {
+    if (fpga_devices.empty()) {
         fprintf(stderr, "Target device %s not found. Exit.\n", target_device_name);
         return EXIT_FAILURE;
     }
 
-    // Create a compute context
-    //
-    context = clCreateContext(0, 1, &device_id, NULL, NULL, &err);
-    if (!context) {
-        fprintf(stderr, "Error: Failed to create a compute context!\n");
-        fprintf(stderr, "Test failed\n");
-        return EXIT_FAILURE;
-    }
-
-    // Create a command commands
-    for (int k = 0; k < NUM_KERNELS; k++) {
-        commands[k] = clCreateCommandQueue(context, device_id, 0, &err);
-        if (!commands[k]) {
-            fprintf(stderr, "Error: Failed to create a command commands!\n");
-            fprintf(stderr, "Error: code %i\n",err);
-            fprintf(stderr, "Test failed\n");
-            return EXIT_FAILURE;
-        }
-    }
-
-    gactx_commands = clCreateCommandQueue(context, device_id, 0, &err);
-    if (!gactx_commands) {
-        fprintf(stderr, "Error: Failed to create a command commands!\n");
-        fprintf(stderr, "Error: code %i\n",err);
-        fprintf(stderr, "Test failed\n");
-        return EXIT_FAILURE;
-    }
-
     // Create Program Objects
     // Load binary from disk
     unsigned char *kernelbinary;
@@ -229,64 +586,19 @@ size_t InitializeProcessor (int t, int f, char* xclbin) {
     fprintf(stderr, "INFO: loaded xclbin %s\n", xclbin);
     size_t n0 = n_i0;
 
-    fprintf(stderr, "Creating cl program with binary\n");
-    // Create the compute program from offline
-    program = clCreateProgramWithBinary(context, 1, &device_id, &n0,
-            (const unsigned char **) &kernelbinary, &status, &err);
-
-    if ((!program) || (err!=CL_SUCCESS)) {
-        fprintf(stderr, "Error: Failed to create compute program from binary %d!\n", err);
-        fprintf(stderr, "Test failed\n");
-        return EXIT_FAILURE;
-    }
-    fprintf(stderr, "Created cl program with binary\n");
-    fprintf(stderr, "Building Program executable\n");
-
-    // Build the program executable
-    //
-    err = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
-    if (err != CL_SUCCESS) {
-        size_t len;
-        char buffer[2048];
-
-        fprintf(stderr, "Error: Failed to build program executable!\n");
-        clGetProgramBuildInfo(program, device_id, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
-        fprintf(stderr, "%s\n", buffer);
-        fprintf(stderr, "Test failed\n");
-        return EXIT_FAILURE;
-    }
-    fprintf(stderr, "Built Program executable\n");
-
-    fprintf(stderr, "Creating kernels\n");
-
-    // Create the compute kernel in the program we wish to run
-
-    std::string s1 = "BSW_bank";
-    std::string s;// = "BSW_bank";
-    for (int k = 0; k < NUM_KERNELS; k++) {
-        s = s1 + std::to_string(k);
-
-        kernel[k] = clCreateKernel(program, s.c_str(), &err);
-        if (!kernel[k] || err != CL_SUCCESS) {
-            fprintf(stderr, "Error: Failed to create compute kernel!\n");
-            fprintf(stderr, "Test failed\n");
+    for (auto dev: fpga_devices) {
+        if (InitializeDevice(dev, kernelbinary, n0) != 0) {
             return EXIT_FAILURE;
         }
     }
+    free(kernelbinary);
 
-    gactx_kernel = clCreateKernel(program, "GACTX_bank3", &err);
-    if (!gactx_kernel || err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to create compute kernel!\n");
+    if (bsw_instances.empty() || gactx_instances.empty()) {
+        fprintf(stderr, "Error: xclbin needs at least one BSW_bank* and one GACTX_bank* kernel!\n");
         fprintf(stderr, "Test failed\n");
         return EXIT_FAILURE;
     }
 
-    for (int k = 0; k < NUM_KERNELS; k++) {
-        start_op[k] = 0;
-        num_executing[k] = 0;
-        available_k.push_back(k);
-    }
-
     fprintf(stderr, "Created kernels\n");
 
     fprintf(stderr, "Creating buffers\n");
@@ -318,164 +630,459 @@ size_t InitializeProcessor (int t, int f, char* xclbin) {
 
     // Create the input and output arrays in device memory for our calculation
 
-    for (int b = 0; b < NUM_KERNELS;  b++) {
-        d_batch_id[b] = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX ,  sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_in, &d_bank_ext[b], NULL);
-        if (!(d_batch_id[b])) {
-            fprintf(stderr, "Error: Failed to allocate device memory!\n");
-            fprintf(stderr, "Test failed\n");
-            return EXIT_FAILURE;
-        }
-        err = clEnqueueWriteBuffer(commands[b], d_batch_id[b], CL_TRUE, 0, sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_in,  tmp_arr, 0, NULL, &wr_event);
-        if (err != CL_SUCCESS) {
-            fprintf(stderr, "Error: Failed to write to source array d_batch_id_0!\n");
-            fprintf(stderr, "Test failed\n");
-            return EXIT_FAILURE;
+    for (auto inst: bsw_instances) {
+        for (int j = 0; j < NUM_SLOTS; j++) {
+            inst->h_batch_id[j] = AllocHostBuffer(MAX_NUM_TILES * num_ints_per_tile_in);
+            inst->h_batch_params[j] = AllocHostBuffer(MAX_NUM_TILES * num_ints_per_tile_in);
+            inst->h_batch_tile_output[j] = AllocHostBuffer(MAX_NUM_TILES * num_ints_per_tile_out);
+
+            inst->d_batch_id[j] = clCreateBuffer(inst->dev->context,  CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX ,  sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_in, &d_bank_ext[inst->bank], NULL);
+            if (!(inst->d_batch_id[j])) {
+                fprintf(stderr, "Error: Failed to allocate device memory!\n");
+                fprintf(stderr, "Test failed\n");
+                return EXIT_FAILURE;
+            }
+            err = clEnqueueWriteBuffer(inst->commands, inst->d_batch_id[j], CL_TRUE, 0, sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_in,  tmp_arr, 0, NULL, &wr_event);
+            if (err != CL_SUCCESS) {
+                fprintf(stderr, "Error: Failed to write to source array d_batch_id_0!\n");
+                fprintf(stderr, "Test failed\n");
+                return EXIT_FAILURE;
+            }
+            clWaitForEvents(1, &wr_event); 
+
+            inst->d_batch_params[j] = clCreateBuffer(inst->dev->context,  CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX ,  sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_in, &d_bank_ext[inst->bank], NULL);
+            if (!(inst->d_batch_params[j])) {
+                fprintf(stderr, "Error: Failed to allocate device memory!\n");
+                fprintf(stderr, "Test failed\n");
+                return EXIT_FAILURE;
+            }
+            err = clEnqueueWriteBuffer(inst->commands, inst->d_batch_params[j], CL_TRUE, 0, sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_in,  tmp_arr, 0, NULL, &wr_event);
+            if (err != CL_SUCCESS) {
+                fprintf(stderr, "Error: Failed to write to source array d_batch_params_0!\n");
+                fprintf(stderr, "Test failed\n");
+                return EXIT_FAILURE;
+            }
+            clWaitForEvents(1, &wr_event); 
+
+            inst->d_batch_tile_output[j] = clCreateBuffer(inst->dev->context,  CL_MEM_WRITE_ONLY | CL_MEM_EXT_PTR_XILINX ,  sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_out, &d_bank_ext[inst->bank], NULL);
+            if (!(inst->d_batch_tile_output[j])) {
+                fprintf(stderr, "Error: Failed to allocate device memory!\n");
+                fprintf(stderr, "Test failed\n");
+                return EXIT_FAILURE;
+            }
+            err = clEnqueueWriteBuffer(inst->commands, inst->d_batch_tile_output[j], CL_TRUE, 0, sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_out,  tmp_arr, 0, NULL, &wr_event);
+            if (err != CL_SUCCESS) {
+                fprintf(stderr, "Error: Failed to write to source array d_batch_tile_output_0_0!\n");
+                fprintf(stderr, "Test failed\n");
+                return EXIT_FAILURE;
+            }
+            clWaitForEvents(1, &wr_event); 
         }
-        clWaitForEvents(1, &wr_event); 
 
-        d_batch_params[b] = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX ,  sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_in, &d_bank_ext[b], NULL);
-        if (!(d_batch_params[b])) {
+        inst->d_chr_ends = clCreateBuffer(inst->dev->context,  CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX ,  sizeof(uint32_t) * BSW_MAX_CHR_ENDS, &d_bank_ext[inst->bank], NULL);
+        if (!(inst->d_chr_ends)) {
             fprintf(stderr, "Error: Failed to allocate device memory!\n");
             fprintf(stderr, "Test failed\n");
             return EXIT_FAILURE;
         }
-        err = clEnqueueWriteBuffer(commands[b], d_batch_params[b], CL_TRUE, 0, sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_in,  tmp_arr, 0, NULL, &wr_event);
-        if (err != CL_SUCCESS) {
-            fprintf(stderr, "Error: Failed to write to source array d_batch_params_0!\n");
-            fprintf(stderr, "Test failed\n");
-            return EXIT_FAILURE;
-        }
-        clWaitForEvents(1, &wr_event); 
+    }
 
-        for (int j = 0; j < 4; j++) {
-            d_batch_tile_output[b][j] = clCreateBuffer(context,  CL_MEM_WRITE_ONLY | CL_MEM_EXT_PTR_XILINX ,  sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_out, &d_bank_ext[b], NULL);
-            if (!(d_batch_tile_output[b][j])) {
+    //GACTX buffers
+    for (auto inst: gactx_instances) {
+        for (int j = 0; j < NUM_GACTX_SLOTS; j++) {
+            inst->d_tile_output[j] = clCreateBuffer(inst->dev->context,  CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX ,  sizeof(int) * 16, &d_bank_ext[inst->bank], NULL);
+            if (!(inst->d_tile_output[j])) {
                 fprintf(stderr, "Error: Failed to allocate device memory!\n");
                 fprintf(stderr, "Test failed\n");
                 return EXIT_FAILURE;
             }
-            err = clEnqueueWriteBuffer(commands[b], d_batch_tile_output[b][j], CL_TRUE, 0, sizeof(int) * MAX_NUM_TILES * num_ints_per_tile_out,  tmp_arr, 0, NULL, &wr_event);
+            err = clEnqueueWriteBuffer(inst->commands, inst->d_tile_output[j], CL_TRUE, 0, sizeof(int) * 16,  tmp_arr, 0, NULL, &wr_event);
             if (err != CL_SUCCESS) {
-                fprintf(stderr, "Error: Failed to write to source array d_batch_tile_output_0_0!\n");
+                fprintf(stderr, "Error: Failed to write to source array d_batch_id_0!\n");
                 fprintf(stderr, "Test failed\n");
                 return EXIT_FAILURE;
             }
             clWaitForEvents(1, &wr_event); 
 
+            inst->d_tb_output[j] = clCreateBuffer(inst->dev->context,  CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX ,  MAX_GACTX_TB_BYTES, &d_bank_ext[inst->bank], NULL);
+            if (!(inst->d_tb_output[j])) {
+                fprintf(stderr, "Error: Failed to allocate device memory!\n");
+                fprintf(stderr, "Test failed\n");
+                return EXIT_FAILURE;
+            }
+            err = clEnqueueWriteBuffer(inst->commands, inst->d_tb_output[j], CL_TRUE, 0, MAX_GACTX_TB_BYTES,  tmp_arr, 0, NULL, &wr_event);
+            if (err != CL_SUCCESS) {
+                fprintf(stderr, "Error: Failed to write to source array d_batch_id_0!\n");
+                fprintf(stderr, "Test failed\n");
+                return EXIT_FAILURE;
+            }
+            clWaitForEvents(1, &wr_event); 
         }
     }
 
-    //GACTX buffers
-    d_gactx_tile_output = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX ,  sizeof(int) * 16, &d_bank_ext[3], NULL);
-    if (!(d_gactx_tile_output)) {
-        fprintf(stderr, "Error: Failed to allocate device memory!\n");
-        fprintf(stderr, "Test failed\n");
-        return EXIT_FAILURE;
-    }
-    err = clEnqueueWriteBuffer(gactx_commands, d_gactx_tile_output, CL_TRUE, 0, sizeof(int) * 16,  tmp_arr, 0, NULL, &wr_event);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to write to source array d_batch_id_0!\n");
-        fprintf(stderr, "Test failed\n");
-        return EXIT_FAILURE;
+    free(tmp_arr);
+
+    for (auto inst: gactx_instances) {
+        inst->dispatcher = std::thread(GACTXDispatcher, inst);
     }
-    clWaitForEvents(1, &wr_event); 
 
-    d_gactx_tb_output = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX ,  MAX_GACTX_TB_BYTES, &d_bank_ext[3], NULL);
-    if (!(d_gactx_tile_output)) {
-        fprintf(stderr, "Error: Failed to allocate device memory!\n");
-        fprintf(stderr, "Test failed\n");
-        return EXIT_FAILURE;
+    return ret;
+}
+
+// Returns the host data to copy for g_DRAM[start_addr, start_addr + len) and
+// its size in bytes, packing it into staging first when cfg.packed_seq is set
+const void* SeqUploadSource (size_t start_addr, size_t len, std::vector<uint8_t>& staging, size_t& bytes) {
+    seq_ascii_bytes += len;
+    if (!cfg.packed_seq) {
+        bytes = len;
+        seq_upload_bytes += bytes;
+        return g_DRAM->buffer + start_addr;
     }
-    err = clEnqueueWriteBuffer(gactx_commands, d_gactx_tb_output, CL_TRUE, 0, MAX_GACTX_TB_BYTES,  tmp_arr, 0, NULL, &wr_event);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to write to source array d_batch_id_0!\n");
-        fprintf(stderr, "Test failed\n");
-        return EXIT_FAILURE;
+    bytes = PackedSeqBytes(len);
+    staging.resize(bytes);
+    PackSeq(pack_isa, g_DRAM->buffer + start_addr, len, staging.data());
+    seq_upload_bytes += bytes;
+    return staging.data();
+}
+
+// Writes g_chr_ends, padded with the sentinel to whole beats, to the
+// chr_ends buffer of every BSW instance
+void SendChrTable () {
+    if (g_chr_ends.size() > BSW_MAX_CHR_ENDS) {
+        fprintf(stderr, "Warning: %lu reference chromosomes exceed the BSW kernel table of %d, computing tile windows on the host\n",
+                g_chr_ends.size() - 1, BSW_MAX_CHR_ENDS - 1);
+        bsw_hit_mode = false;
+        return;
     }
-    clWaitForEvents(1, &wr_event); 
 
-    free(tmp_arr);
+    std::vector<uint32_t> table(g_chr_ends.begin(), g_chr_ends.end());
+    table.resize((table.size() + BSW_CHR_ENDS_PER_BEAT - 1) / BSW_CHR_ENDS_PER_BEAT * BSW_CHR_ENDS_PER_BEAT, UINT32_MAX);
 
-    return ret;
+    for (auto inst: bsw_instances) {
+        err = clEnqueueWriteBuffer(inst->commands, inst->d_chr_ends, CL_TRUE, 0, sizeof(uint32_t) * table.size(), table.data(), 0, NULL, NULL);
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to write chromosome table!\n");
+            fprintf(stderr, "Test failed\n");
+            exit(1);
+        }
+    }
+
+    bsw_hit_mode = true;
+    fprintf(stderr, "BSW tile windows computed on the FPGA (%lu chromosomes)\n", g_chr_ends.size() - 1);
 }
 
+// The copies to the banks of all cards are issued together on the per-bank
+// queues so that they proceed in parallel, and only then waited for
 void SendRefWriteRequest (size_t start_addr, size_t len) {
 
-    cl_event writeevent;
+    std::vector<cl_event> writeevents;
 
     fprintf(stderr, "Sending reference to FPGA DRAM\n");
 
-    for (int b = 0; b < NUM_KERNELS; b++) {
-        d_ref_seq[b] = clCreateBuffer(context,   CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX,  sizeof(char) * len, &d_bank_ext[b], NULL);
-        if (!(d_ref_seq[b])) {
-            fprintf(stderr, "Error: Failed to allocate device memory!\n");
-            fprintf(stderr, "Test failed\n");
-            exit(1);
+    size_t bytes;
+    const void* src = SeqUploadSource(start_addr, len, ref_packed, bytes);
+
+    for (auto dev: fpga_devices) {
+        for (int b = 0; b < NUM_BANKS; b++) {
+            if (!dev->bank_used[b]) {
+                continue;
+            }
+            dev->d_ref_seq[b] = clCreateBuffer(dev->context,   CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX,  sizeof(char) * bytes, &d_bank_ext[b], NULL);
+            if (!(dev->d_ref_seq[b])) {
+                fprintf(stderr, "Error: Failed to allocate device memory!\n");
+                fprintf(stderr, "Test failed\n");
+                exit(1);
+            }
+            cl_event writeevent;
+            err = clEnqueueWriteBuffer(dev->bank_commands[b], dev->d_ref_seq[b], CL_FALSE, 0, sizeof(char) * bytes, src, 0, NULL, &writeevent);
+            if (err != CL_SUCCESS) {
+                fprintf(stderr, "Error: Failed to write to source array!\n");
+                fprintf(stderr, "Test failed\n");
+                exit(1);
+            }
+            writeevents.push_back(writeevent);
+            clFlush(dev->bank_commands[b]);
         }
-        err = clEnqueueWriteBuffer(commands[b], d_ref_seq[b], CL_TRUE, 0, sizeof(char) * len, g_DRAM->buffer + start_addr, 0, NULL, &writeevent);
-        if (err != CL_SUCCESS) {
-            fprintf(stderr, "Error: Failed to write to source array!\n");
-            fprintf(stderr, "Test failed\n");
-            return;
+    }
+
+    clWaitForEvents(writeevents.size(), writeevents.data());
+    for (auto e: writeevents) {
+        clReleaseEvent(e);
+    }
+    std::vector<uint8_t>().swap(ref_packed);
+
+    if (cfg.hit_tiles) {
+        SendChrTable();
+    }
+}
+
+// Starts copying g_DRAM[start_addr, start_addr + len) to the query slot after
+// the active one on every bank of every card, without waiting for the copies
+// to complete
+void StartQueryUpload (size_t start_addr, size_t len) {
+    int s = (query_active_slot + 1) % NUM_QUERY_SLOTS;
+
+    size_t bytes;
+    const void* src = SeqUploadSource(start_addr, len, query_packed[s], bytes);
+
+    for (auto dev: fpga_devices) {
+        for (int b = 0; b < NUM_BANKS; b++) {
+            if (!dev->bank_used[b]) {
+                continue;
+            }
+            if (dev->d_query_slot_size[b][s] < std::max(bytes, (size_t) WORD_SIZE)) {
+                if (dev->d_query_slot[b][s]) {
+                    clReleaseMemObject(dev->d_query_slot[b][s]);
+                }
+                dev->d_query_slot_size[b][s] = std::max(bytes, (size_t) WORD_SIZE);
+                dev->d_query_slot_grown[b][s] = true;
+                dev->d_query_slot[b][s] = clCreateBuffer(dev->context,   CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX,  sizeof(char) * dev->d_query_slot_size[b][s], &d_bank_ext[b], NULL);
+                if (!(dev->d_query_slot[b][s])) {
+                    fprintf(stderr, "Error: Failed to allocate device memory!\n");
+                    fprintf(stderr, "Test failed\n");
+                    exit(1);
+                }
+            }
+            err = clEnqueueWriteBuffer(dev->bank_commands[b], dev->d_query_slot[b][s], CL_FALSE, 0, sizeof(char) * bytes, src, 0, NULL, &dev->query_upload_event[b]);
+            if (err != CL_SUCCESS) {
+                fprintf(stderr, "Error: Failed to write to source array!\n");
+                fprintf(stderr, "Test failed\n");
+                exit(1);
+            }
+            clFlush(dev->bank_commands[b]);
         }
-        clWaitForEvents(1, &writeevent); 
     }
 
+    query_upload_pending = true;
+    query_upload_addr = start_addr;
+    query_upload_len = len;
 }
 
-void SendQueryWriteRequest (size_t start_addr, size_t len) {
-    
-    cl_event writeevent;
-    
+void WaitQueryUpload () {
+    for (auto dev: fpga_devices) {
+        for (int b = 0; b < NUM_BANKS; b++) {
+            if (dev->bank_used[b]) {
+                clWaitForEvents(1, &dev->query_upload_event[b]);
+                clReleaseEvent(dev->query_upload_event[b]);
+            }
+        }
+    }
+    query_upload_pending = false;
+}
+
+// Uploads the next query chromosome while the kernels are still aligning the
+// current one. The caller must keep g_DRAM[start_addr, start_addr + len)
+// unchanged until the matching SendQueryWriteRequest.
+void SendQueryPrefetchRequest (size_t start_addr, size_t len) {
+    if (query_upload_pending) {
+        WaitQueryUpload();
+    }
+
     fprintf(stderr, "Sending query to FPGA DRAM\n");
+    StartQueryUpload(start_addr, len);
+}
 
-    for (int b = 0; b < NUM_KERNELS; b++) {
-        d_query_seq[b] = clCreateBuffer(context,   CL_MEM_READ_ONLY | CL_MEM_EXT_PTR_XILINX,  sizeof(char) * len, &d_bank_ext[b], NULL);
-        if (!(d_query_seq[b])) {
-            fprintf(stderr, "Error: Failed to allocate device memory!\n");
-            fprintf(stderr, "Test failed\n");
-            exit(1);
+// Makes g_DRAM[start_addr, start_addr + len) the query read by the kernels.
+// Must not be called while requests on the previous query are in flight.
+void SendQueryWriteRequest (size_t start_addr, size_t len) {
+    auto start = std::chrono::steady_clock::now();
+
+    if (query_upload_pending && (query_upload_addr == start_addr) && (query_upload_len == len)) {
+        query_num_prefetched++;
+    }
+    else {
+        if (query_upload_pending) {
+            WaitQueryUpload();
         }
-        err = clEnqueueWriteBuffer(commands[b], d_query_seq[b], CL_TRUE, 0, sizeof(char) * len, g_DRAM->buffer + start_addr, 0, NULL, &writeevent);
-        if (err != CL_SUCCESS) {
-            fprintf(stderr, "Error: Failed to write to source array!\n");
-            fprintf(stderr, "Test failed\n");
-            return;
+        fprintf(stderr, "Sending query to FPGA DRAM\n");
+        StartQueryUpload(start_addr, len);
+    }
+    WaitQueryUpload();
+
+    query_active_slot = (query_active_slot + 1) % NUM_QUERY_SLOTS;
+    for (auto dev: fpga_devices) {
+        for (int b = 0; b < NUM_BANKS; b++) {
+            if (dev->bank_used[b]) {
+                dev->d_query_seq[b] = dev->d_query_slot[b][query_active_slot];
+            }
         }
-        clWaitForEvents(1, &writeevent); 
     }
 
+    // query argument of the BSW (17) and GACT-X (20) kernels reading a
+    // reallocated slot; no launch is in flight here
+    for (auto inst: bsw_instances) {
+        if (inst->dev->d_query_slot_grown[inst->bank][query_active_slot]) {
+            InvalidateKernelArg(inst->args, 17);
+        }
+    }
+    for (auto inst: gactx_instances) {
+        if (inst->dev->d_query_slot_grown[inst->bank][query_active_slot]) {
+            InvalidateKernelArg(inst->args, 20);
+        }
+    }
+    for (auto dev: fpga_devices) {
+        for (int b = 0; b < NUM_BANKS; b++) {
+            dev->d_query_slot_grown[b][query_active_slot] = false;
+        }
+    }
+
+    query_num_uploads++;
+    query_total_wait_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Returns the kernel with the fewest estimated cycles of work in flight that
+// still has a free slot, or -1 if all slots of all kernels are taken. Ties go
+// to the kernel with fewer batches. Called with pool_lock held.
+int LeastLoadedKernel () {
+    int best_k = -1;
+    for (int k = 0; k < (int) bsw_instances.size(); k++) {
+        bsw_instance* inst = bsw_instances[k];
+        if (inst->free_slots.empty()) {
+            continue;
+        }
+        if ((best_k < 0) || (inst->pending_cycles < bsw_instances[best_k]->pending_cycles) ||
+                ((inst->pending_cycles == bsw_instances[best_k]->pending_cycles) &&
+                 (inst->num_executing < bsw_instances[best_k]->num_executing))) {
+            best_k = k;
+        }
+    }
+    return best_k;
+}
+
+// Blocks until a (kernel, slot) pair is available for a batch of the given
+// estimated cycles. Requests are granted in arrival order; waiting threads
+// sleep instead of spinning.
+void AcquireKernel (int& curr_k, int& s_op, uint64_t cycles) {
+    auto start = std::chrono::steady_clock::now();
+    bool waited = false;
+
+    std::unique_lock<std::mutex> lk(pool_lock);
+    uint64_t ticket = pool_next_ticket++;
+    while ((ticket != pool_now_serving) || (LeastLoadedKernel() < 0)) {
+        waited = true;
+        pool_cv.wait(lk);
+    }
+
+    curr_k = LeastLoadedKernel();
+    s_op = bsw_instances[curr_k]->free_slots.back();
+    bsw_instances[curr_k]->free_slots.pop_back();
+    bsw_instances[curr_k]->num_executing += 1;
+    bsw_instances[curr_k]->pending_cycles += cycles;
+    pool_now_serving++;
+
+    uint64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    pool_num_grants++;
+    if (waited) {
+        pool_num_waits++;
+        pool_total_wait_us += wait_us;
+        pool_max_wait_us = std::max(pool_max_wait_us, wait_us);
+    }
+    lk.unlock();
+
+    // the next ticket holder may be able to proceed as well
+    pool_cv.notify_all();
+}
+
+void BSWPoolLoad (int& queued, int& in_flight, int& num_slots) {
+    std::lock_guard<std::mutex> lk(pool_lock);
+    queued = pool_next_ticket - pool_now_serving;
+    in_flight = 0;
+    for (auto inst: bsw_instances) {
+        in_flight += inst->num_executing;
+    }
+    num_slots = bsw_instances.size() * NUM_SLOTS;
+}
+
+void ReleaseKernel (int curr_k, int s_op, uint64_t cycles) {
+    {
+        std::lock_guard<std::mutex> lk(pool_lock);
+        bsw_instances[curr_k]->free_slots.push_back(s_op);
+        bsw_instances[curr_k]->num_executing -= 1;
+        bsw_instances[curr_k]->pending_cycles -= cycles;
+    }
+    pool_cv.notify_all();
 }
 
 void SendRequest (size_t ref_offset, size_t query_offset, size_t ref_length, size_t query_length, uint8_t align_fields) {
 
-    if (!kernel[0]) {
+    if (bsw_instances.empty()) {
         fprintf(stderr, "ERROR: kernel not initialized! Exiting.\n");
         exit(1);
     }
     
 }
 
-std::vector<tile_output> SendBatchRequest (std::vector<filter_tile> tiles, uint8_t align_fields, int thresh) {
+// Estimated cycles of the tiles of a request as running totals: cycles[t] is
+// the sum over its first t tiles. Hit mode windows are taken as full size.
+std::vector<uint64_t> BSWTilesCycles (size_t num_tiles, const filter_tile* tiles) {
+    std::vector<uint64_t> cycles(num_tiles + 1, 0);
+    for (size_t t = 0; t < num_tiles; t++) {
+        cycles[t+1] = cycles[t] + ((tiles != NULL) ? BSWTileCycles(tiles[t].ref_length, tiles[t].query_length, cfg.band_size) :
+            BSWTileCycles(cfg.first_tile_size, cfg.first_tile_size, cfg.band_size));
+    }
+    return cycles;
+}
+
+// Time between the start and the end of a task, from the profiling counters
+double TaskSecs (cl_event task_event) {
+    cl_ulong start = 0, end = 0;
+    cl_int prof_err = clGetEventProfilingInfo(task_event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+    prof_err |= clGetEventProfilingInfo(task_event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+    if ((prof_err != CL_SUCCESS) || (end < start)) {
+        return -1;
+    }
+    return (end - start) / 1e9;
+}
+
+// Aligns one batch on a BSW kernel, given either explicit tiles or seed hits
+// whose tile windows the kernel derives (hit mode). The batch is padded to a
+// multiple of 16 by repeating its last entry, so besides the estimated cycles
+// of its tiles this takes those of the last one.
+std::vector<tile_output> RunBSWBatch (size_t num_tiles, const filter_tile* tiles, const seed_hit* hits, size_t query_len,
+        uint8_t align_fields, int thresh, uint64_t tile_cycles, uint64_t last_tile_cycles) {
     int err = 0;
 
-    size_t num_tiles = tiles.size();
     size_t extra = num_tiles % 16; 
     if (extra != 0) {
         extra = 16 - extra;
     }
     size_t batch_size = (num_tiles + extra);
 
-    int* h_batch_id;
-    int* h_batch_params;
-    int* h_batch_tile_output;
+    if (batch_size > MAX_NUM_TILES) {
+        fprintf(stderr, "Error: batch of %lu tiles exceeds MAX_NUM_TILES!\n", batch_size);
+        exit(1);
+    }
 
-    h_batch_id = new int[4*batch_size];
-    h_batch_params = new int[4*batch_size];
-    h_batch_tile_output = new int[16*batch_size];
+    cl_event wr_events[2];
+    int num_writes = 0;
+    cl_event task_event;
+    cl_event rd_event;
 
-    for (int b = 0; b < batch_size; b++) {
-        int idx = std::min(b,(int) num_tiles-1);
+    int curr_k = -1;
+    int s_op = -1;
+
+    uint64_t batch_cycles = BSWBatchCycles(num_tiles, tile_cycles, last_tile_cycles);
+
+    // a slot is returned to the pool only after its read-back has completed
+    // and its results have been consumed, so up to NUM_SLOTS batches can be
+    // in flight on a kernel
+    AcquireKernel(curr_k, s_op, batch_cycles);
+    bsw_instance* inst = bsw_instances[curr_k];
+
+    int* h_batch_id = inst->h_batch_id[s_op];
+    int* h_batch_params = inst->h_batch_params[s_op];
+    int* h_batch_tile_output = inst->h_batch_tile_output[s_op];
+
+    for (size_t b = 0; b < batch_size; b++) {
+        size_t idx = std::min(b, num_tiles-1);
+        if (hits != NULL) {
+            // tile ids are the batch positions and batch_id is not read
+            h_batch_params[4*b] =   hits[idx].reference_offset;
+            h_batch_params[4*b+1] = hits[idx].query_offset;
+            h_batch_params[4*b+2] = 0;
+            h_batch_params[4*b+3] = 0;
+            continue;
+        }
         filter_tile tile = tiles[idx];
         h_batch_id[4*b] = b;
         h_batch_id[4*b+1] = 0;
@@ -490,66 +1097,45 @@ std::vector<tile_output> SendBatchRequest (std::vector<filter_tile> tiles, uint8
         assert(tile.query_length <= MAX_BANDED_TILE_SIZE);
     }
 
-    cl_event wr_event;
-    cl_event rd_event;
-
-    int curr_k = -1;
-    int s_op = 0;
+    inst->lock.lock();
 
-    while (curr_k < 0) {
-        rw_lock.lock();
-        int s = available_k.size();
-        if (s > 0) {
-            std::sort(available_k.begin(), available_k.end());
-            std::reverse(available_k.begin(), available_k.end());
-            curr_k = available_k.back();
-            s_op = start_op[curr_k];
-            start_op[curr_k] = (start_op[curr_k] + 1) % 4;
-            available_k.pop_back();
+    if (hits == NULL) {
+        err = clEnqueueWriteBuffer(inst->commands, inst->d_batch_id[s_op], CL_FALSE, 0, sizeof(int) * batch_size * num_ints_per_tile_in,  h_batch_id, 0, NULL, &wr_events[num_writes++]);
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "Error: Failed to write to source array !\n");
+            fprintf(stderr, "Test failed\n");
+            exit(1);
         }
-        rw_lock.unlock();
     }
 
-
-    fpga_lock[curr_k].lock();
-    
-    while (num_executing[curr_k] == 4) {}
-    num_executing[curr_k] += 1;
-
-    err = clEnqueueWriteBuffer(commands[curr_k], d_batch_id[curr_k], CL_TRUE, 0, sizeof(int) * batch_size * num_ints_per_tile_in,  h_batch_id, 0, NULL, &wr_event);
+    err = clEnqueueWriteBuffer(inst->commands, inst->d_batch_params[s_op], CL_FALSE, 0, sizeof(int) * batch_size * num_ints_per_tile_in,  h_batch_params, 0, NULL, &wr_events[num_writes++]);
     if (err != CL_SUCCESS) {
         fprintf(stderr, "Error: Failed to write to source array !\n");
         fprintf(stderr, "Test failed\n");
         exit(1);
     }
-    clWaitForEvents(1, &wr_event); 
-
-
-    err = clEnqueueWriteBuffer(commands[curr_k], d_batch_params[curr_k], CL_TRUE, 0, sizeof(int) * batch_size * num_ints_per_tile_in,  h_batch_params, 0, NULL, &wr_event);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to write to source array !\n");
-        fprintf(stderr, "Test failed\n");
-        exit(1);
-    }
-    clWaitForEvents(1, &wr_event); 
+    bsw_input_bytes += sizeof(int) * batch_size * num_ints_per_tile_in * num_writes;
 
+    // scoring arguments (0-13) were set at startup
+    auto launch_start = std::chrono::steady_clock::now();
     err = 0;
-    for (int i = 0; i < 11; i++) {
-        err |= clSetKernelArg(kernel[curr_k], i, sizeof(int), &cfg.gact_sub_mat[i]);
-    }
-    err |= clSetKernelArg(kernel[curr_k], 11, sizeof(int), &cfg.gap_open);
-    err |= clSetKernelArg(kernel[curr_k], 12, sizeof(int), &cfg.gap_extend);
-    uint d_band_size = cfg.band_size;
-    err |= clSetKernelArg(kernel[curr_k], 13, sizeof(uint), &d_band_size);
     uint d_batch_size = batch_size;
-    err |= clSetKernelArg(kernel[curr_k], 14, sizeof(uint), &d_batch_size);
+    err |= SetKernelArgCached(inst->kernel, inst->args, 14, sizeof(uint), &d_batch_size);
     uint d_batch_align_fields = align_fields;
-    err |= clSetKernelArg(kernel[curr_k], 15, sizeof(uint), &d_batch_align_fields);
-    err |= clSetKernelArg(kernel[curr_k], 16, sizeof(cl_mem), &d_ref_seq[curr_k]);
-    err |= clSetKernelArg(kernel[curr_k], 17, sizeof(cl_mem), &d_query_seq[curr_k]);
-    err |= clSetKernelArg(kernel[curr_k], 18, sizeof(cl_mem), &d_batch_id[curr_k]);
-    err |= clSetKernelArg(kernel[curr_k], 19, sizeof(cl_mem), &d_batch_params[curr_k]);
-    err |= clSetKernelArg(kernel[curr_k], 20, sizeof(cl_mem), &d_batch_tile_output[curr_k][s_op % 4]);
+    err |= SetKernelArgCached(inst->kernel, inst->args, 15, sizeof(uint), &d_batch_align_fields);
+    err |= SetKernelArgCached(inst->kernel, inst->args, 16, sizeof(cl_mem), &inst->dev->d_ref_seq[inst->bank]);
+    err |= SetKernelArgCached(inst->kernel, inst->args, 17, sizeof(cl_mem), &inst->dev->d_query_seq[inst->bank]);
+    err |= SetKernelArgCached(inst->kernel, inst->args, 18, sizeof(cl_mem), &inst->d_batch_id[s_op]);
+    err |= SetKernelArgCached(inst->kernel, inst->args, 19, sizeof(cl_mem), &inst->d_batch_params[s_op]);
+    err |= SetKernelArgCached(inst->kernel, inst->args, 20, sizeof(cl_mem), &inst->d_batch_tile_output[s_op]);
+    err |= SetKernelArgCached(inst->kernel, inst->args, 21, sizeof(int), &thresh);
+    uint d_tile_window = (hits != NULL) ? cfg.first_tile_size : 0;
+    err |= SetKernelArgCached(inst->kernel, inst->args, 22, sizeof(uint), &d_tile_window);
+    uint d_query_len = (hits != NULL) ? query_len : 0;
+    err |= SetKernelArgCached(inst->kernel, inst->args, 23, sizeof(uint), &d_query_len);
+    uint d_num_chrs = (hits != NULL) ? g_chr_ends.size() : 0;
+    err |= SetKernelArgCached(inst->kernel, inst->args, 24, sizeof(uint), &d_num_chrs);
+    err |= SetKernelArgCached(inst->kernel, inst->args, 25, sizeof(cl_mem), &inst->d_chr_ends);
 
     if (err != CL_SUCCESS) {
         fprintf(stderr, "Error: Failed to set kernel arguments! %d\n", err);
@@ -560,172 +1146,440 @@ std::vector<tile_output> SendBatchRequest (std::vector<filter_tile> tiles, uint8
     // Execute the kernel over the entire range of our 1d input data set
     // using the maximum number of work group items for this device
 
-    err = clEnqueueTask(commands[curr_k], kernel[curr_k], 0, NULL, NULL);
+    err = clEnqueueTask(inst->commands, inst->kernel, num_writes, wr_events, &task_event);
     if (err) {
         fprintf(stderr, "Error: Failed to execute kernel! %d\n", err);
         fprintf(stderr, "Test failed\n");
         exit(1);
     }
+    inst->num_launches++;
+    inst->num_tiles += num_tiles;
+    inst->launch_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - launch_start).count();
 
-    // Read back the results from the device to verify the output
-    clFinish(commands[curr_k]);
-
-    fpga_lock[curr_k].unlock();
-
+    // the kernel only writes back the tiles scoring at least thresh: a
+    // header beat with their count, then one packed record per tile, so the
+    // header is read first and then only as many records as it announces
     err = 0;
-    err |= clEnqueueReadBuffer(commands[curr_k], d_batch_tile_output[curr_k][s_op % 4], CL_TRUE, 0, sizeof(int) * batch_size * num_ints_per_tile_out, h_batch_tile_output, 0, NULL, &rd_event);
+    err |= clEnqueueReadBuffer(inst->commands, inst->d_batch_tile_output[s_op], CL_FALSE, 0, sizeof(int) * BSW_OUT_HEADER_INTS, h_batch_tile_output, 1, &task_event, &rd_event);
     if (err != CL_SUCCESS) {
         fprintf(stderr, "error: failed to read output array! %d\n", err);
         fprintf(stderr, "test failed\n");
         exit(1);
     }
+    clFlush(inst->commands);
+
+    // arguments are captured at enqueue time, so the kernel can take the
+    // next batch while this one is still transferring or executing
+    inst->lock.unlock();
+
     clWaitForEvents(1, &rd_event);
 
-    num_executing[curr_k] -= 1;
+    double task_secs = TaskSecs(task_event);
+    if (task_secs >= 0) {
+        bsw_cost.Add(batch_cycles, task_secs);
+        inst->lock.lock();
+        inst->predicted_cycles += batch_cycles;
+        inst->busy_secs += task_secs;
+        inst->lock.unlock();
+    }
 
-    rw_lock.lock();
-    available_k.push_back(curr_k);
-    rw_lock.unlock();
+    for (int w = 0; w < num_writes; w++) {
+        clReleaseEvent(wr_events[w]);
+    }
+    clReleaseEvent(task_event);
+    clReleaseEvent(rd_event);
+
+    size_t num_passed = std::min((size_t) h_batch_tile_output[0], batch_size);
+    if (num_passed > 0) {
+        size_t num_ints = (num_passed + BSW_OUT_RECORDS_PER_BEAT - 1) / BSW_OUT_RECORDS_PER_BEAT * BSW_OUT_HEADER_INTS;
+        err = clEnqueueReadBuffer(inst->commands, inst->d_batch_tile_output[s_op], CL_TRUE, sizeof(int) * BSW_OUT_HEADER_INTS, sizeof(int) * num_ints, h_batch_tile_output + BSW_OUT_HEADER_INTS, 0, NULL, NULL);
+        if (err != CL_SUCCESS) {
+            fprintf(stderr, "error: failed to read output array! %d\n", err);
+            fprintf(stderr, "test failed\n");
+            exit(1);
+        }
+    }
+    bsw_readback_bytes += sizeof(int) * BSW_OUT_HEADER_INTS * (1 + (num_passed + BSW_OUT_RECORDS_PER_BEAT - 1) / BSW_OUT_RECORDS_PER_BEAT);
 
     std::vector <tile_output> filtered_op;
     filtered_op.clear();
 
-    for (int b = 0; b < batch_size; b++) {
-        ushort tile_id;
-        int tile_score;
-        uint32_t ro, qo;
-        tile_id     = h_batch_tile_output[b*16];
-        if (tile_id < num_tiles) {
-            tile_score  = h_batch_tile_output[b*16+2];
-            ro          = h_batch_tile_output[b*16+3];
-            qo          = h_batch_tile_output[b*16+4];
-            if (tile_score >= thresh) {
-                tile_output op = tile_output(tile_id, tile_score, ro, qo);
-                filtered_op.push_back(op);
-            }
+    int* records = h_batch_tile_output + BSW_OUT_HEADER_INTS;
+    for (size_t r = 0; r < num_passed; r++) {
+        int tile_id     = records[4*r];
+        // padding tiles repeat the last tile of the batch
+        if ((size_t) tile_id < num_tiles) {
+            int tile_score  = records[4*r+1];
+            uint32_t ro     = records[4*r+2];
+            uint32_t qo     = records[4*r+3];
+            tile_output op = tile_output(tile_id, tile_score, ro, qo);
+            filtered_op.push_back(op);
         }
     }
 
-    free(h_batch_id);
-    free(h_batch_params);
-    free(h_batch_tile_output);
+    ReleaseKernel(curr_k, s_op, batch_cycles);
+
+    g_fpga_filter_tiles += num_tiles;
 
     return filtered_op;
 }
 
-extend_output GACTXRequest (extend_tile tile, uint8_t align_fields) {
-    extend_output op;
-    int err = 0;
-    int h_gactx_tile_output[16];
-    uint32_t h_gactx_tb_output[MAX_GACTX_TB_BYTES/4];
-    
+// Tiles per launch for a request of num_tiles tiles: the smallest whole
+// number of beats for which the fitted fixed overhead of a launch is at most
+// BSW_MAX_OVERHEAD_FRACTION of its predicted compute time. A request is split
+// over up to as many launches as there are BSW kernels, as long as each launch
+// keeps at least that many tiles, and never beyond MAX_NUM_TILES per launch.
+size_t BSWChunkTiles (size_t num_tiles, uint64_t tile_cycles) {
+    double overhead, secs_per_cycle;
+    bsw_cost.Get(overhead, secs_per_cycle);
+
+    double tile_secs = std::max(1.0, (double) tile_cycles / std::max(num_tiles, (size_t) 1)) / BSW_NUM_ARRAYS * secs_per_cycle;
+    size_t min_tiles = (size_t) (overhead / (BSW_MAX_OVERHEAD_FRACTION * tile_secs)) + 1;
+    min_tiles = (min_tiles + BSW_TILES_PER_BEAT - 1) / BSW_TILES_PER_BEAT * BSW_TILES_PER_BEAT;
+
+    size_t num_chunks = std::min(bsw_instances.size(), std::max((size_t) 1, num_tiles / min_tiles));
+    num_chunks = std::max(num_chunks, (num_tiles + MAX_NUM_TILES - 1) / MAX_NUM_TILES);
+    size_t chunk = (num_tiles + num_chunks - 1) / num_chunks;
+    return (chunk + BSW_TILES_PER_BEAT - 1) / BSW_TILES_PER_BEAT * BSW_TILES_PER_BEAT;
+}
+
+// Runs a request as launches of BSWChunkTiles() tiles, in parallel on the TBB
+// workers, with batch_id translated back to the index in the whole request
+std::vector<tile_output> RunBSWRequest (size_t num_tiles, const filter_tile* tiles, const seed_hit* hits, size_t query_len,
+        uint8_t align_fields, int thresh) {
+    std::vector<uint64_t> cycles = BSWTilesCycles(num_tiles, tiles);
+    size_t chunk = BSWChunkTiles(num_tiles, cycles[num_tiles]);
+    size_t num_chunks = (num_tiles + chunk - 1) / chunk;
+
+    bsw_num_requests += 1;
+    bsw_num_chunks += num_chunks;
+
+    std::vector<std::vector<tile_output> > parts(num_chunks);
+    tbb::task_group chunks;
+    for (size_t p = 0; p < num_chunks; p++) {
+        size_t start = p * chunk;
+        size_t end = std::min(start + chunk, num_tiles);
+        auto run = [=, &parts, &cycles]() {
+            parts[p] = RunBSWBatch(end - start, (tiles != NULL) ? tiles + start : NULL, (hits != NULL) ? hits + start : NULL,
+                    query_len, align_fields, thresh, cycles[end] - cycles[start], cycles[end] - cycles[end-1]);
+        };
+        if (p + 1 < num_chunks) {
+            chunks.run(run);
+        } else {
+            run();
+        }
+    }
+    chunks.wait();
+
+    std::vector<tile_output> filtered_op;
+    for (size_t p = 0; p < num_chunks; p++) {
+        for (auto op: parts[p]) {
+            op.batch_id += p * chunk;
+            filtered_op.push_back(op);
+        }
+    }
+    return filtered_op;
+}
+
+std::vector<tile_output> SendBatchRequest (std::vector<filter_tile> tiles, uint8_t align_fields, int thresh) {
+    return RunBSWRequest(tiles.size(), tiles.data(), NULL, 0, align_fields, thresh);
+}
+
+std::vector<tile_output> SendHitBatchRequest (std::vector<seed_hit> hits, size_t query_len, uint8_t align_fields, int thresh) {
+    if (!bsw_hit_mode) {
+        return SendHitBatchAsTiles(hits, query_len, align_fields, thresh);
+    }
+    bsw_hit_batches += 1;
+    return RunBSWRequest(hits.size(), NULL, hits.data(), query_len, align_fields, thresh);
+}
+
+// Drains the GACT-X submission queue. Up to NUM_GACTX_SLOTS pending tiles are
+// launched back-to-back, each with its own output buffers, and the read-backs
+// are chained on the task events so that the kernel never waits on the host
+// between tiles of a group. The tile outputs are read first and then only the
+// traceback beats each of them reports.
+void GACTXDispatcher (gactx_instance* inst) {
+    int err;
+    std::vector<gactx_request*> group;
+    std::vector<int> h_gactx_tile_output(NUM_GACTX_SLOTS * 16);
+    std::vector<uint32_t> h_gactx_tb_output(NUM_GACTX_SLOTS * MAX_GACTX_TB_BYTES/4);
+    cl_event task_event[NUM_GACTX_SLOTS];
+    cl_event rd_event[NUM_GACTX_SLOTS];
+    cl_event tb_event[NUM_GACTX_SLOTS];
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lk(gactx_queue_lock);
+            while (!gactx_shutdown && gactx_queue.empty()) {
+                gactx_queue_cv.wait(lk);
+            }
+            if (gactx_queue.empty()) {
+                break;
+            }
+            // split the pending work across the GACT-X instances so that one
+            // dispatcher does not take everything while the others sit idle
+            size_t num_take = (gactx_queue.size() + gactx_instances.size() - 1) / gactx_instances.size();
+            num_take = std::min(num_take, (size_t) NUM_GACTX_SLOTS);
+            while (!gactx_queue.empty() && (group.size() < num_take)) {
+                group.push_back(gactx_queue.front());
+                gactx_queue.pop_front();
+            }
+        }
+
+        int num_launch = group.size();
+
+        for (int j = 0; j < num_launch; j++) {
+            extend_tile& tile = group[j]->tile;
+
+            // scoring arguments (0-13) were set at startup
+            auto launch_start = std::chrono::steady_clock::now();
+            err = 0;
+            uint32_t d_batch_align_fields = group[j]->align_fields;
+            err |= SetKernelArgCached(inst->kernel, inst->args, 14, sizeof(uint), &d_batch_align_fields);
+            uint32_t d_ref_len = tile.ref_length;
+            err |= SetKernelArgCached(inst->kernel, inst->args, 15, sizeof(cl_uint), &d_ref_len);
+            uint32_t d_query_len = tile.query_length;
+            err |= SetKernelArgCached(inst->kernel, inst->args, 16, sizeof(cl_uint), &d_query_len);
+            uint64_t d_ref_offset = tile.ref_offset;
+            err |= SetKernelArgCached(inst->kernel, inst->args, 17, sizeof(cl_ulong), &d_ref_offset);
+            uint64_t d_query_offset = tile.query_offset;
+            err |= SetKernelArgCached(inst->kernel, inst->args, 18, sizeof(cl_ulong), &d_query_offset);
+            err |= SetKernelArgCached(inst->kernel, inst->args, 19, sizeof(cl_mem), &inst->dev->d_ref_seq[inst->bank]);
+            err |= SetKernelArgCached(inst->kernel, inst->args, 20, sizeof(cl_mem), &inst->dev->d_query_seq[inst->bank]);
+            err |= SetKernelArgCached(inst->kernel, inst->args, 21, sizeof(cl_mem), &inst->d_tile_output[j]);
+            err |= SetKernelArgCached(inst->kernel, inst->args, 22, sizeof(cl_mem), &inst->d_tb_output[j]);
+
+            if (err != CL_SUCCESS) {
+                fprintf(stderr, "Error: Failed to set kernel arguments! %d\n", err);
+                fprintf(stderr, "Test failed\n");
+                exit(1);
+            }
+
+            err = clEnqueueTask(inst->commands, inst->kernel, 0, NULL, &task_event[j]);
+            if (err) {
+                fprintf(stderr, "Error: Failed to execute kernel! %d\n", err);
+                fprintf(stderr, "Test failed\n");
+                exit(1);
+            }
+            inst->launch_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - launch_start).count();
+
+            err = clEnqueueReadBuffer(inst->commands, inst->d_tile_output[j], CL_FALSE, 0, sizeof(int) * 16, &h_gactx_tile_output[16*j], 1, &task_event[j], &rd_event[j]);
+            if (err != CL_SUCCESS) {
+                fprintf(stderr, "error: failed to read output array! %d\n", err);
+                fprintf(stderr, "test failed\n");
+                exit(1);
+            }
+        }
+        clFlush(inst->commands);
+
+        clWaitForEvents(num_launch, rd_event);
+
+        int num_tb_reads = 0;
+        for (int j = 0; j < num_launch; j++) {
+            int num_beats = std::min(h_gactx_tile_output[16*j + 5], MAX_GACTX_TB_BYTES/64);
+            h_gactx_tile_output[16*j + 5] = std::max(num_beats, 0);
+            if (num_beats > 0) {
+                err = clEnqueueReadBuffer(inst->commands, inst->d_tb_output[j], CL_FALSE, 0, 64 * num_beats, &h_gactx_tb_output[j*MAX_GACTX_TB_BYTES/4], 0, NULL, &tb_event[num_tb_reads++]);
+                if (err != CL_SUCCESS) {
+                    fprintf(stderr, "error: failed to read output array! %d\n", err);
+                    fprintf(stderr, "test failed\n");
+                    exit(1);
+                }
+                gactx_tb_readback_bytes += 64 * num_beats;
+            }
+        }
+        if (num_tb_reads > 0) {
+            clFlush(inst->commands);
+            clWaitForEvents(num_tb_reads, tb_event);
+        }
+        gactx_tb_tiles += num_launch;
+
+        for (int j = 0; j < num_launch; j++) {
+            uint64_t cycles = GACTXTileCycles(group[j]->tile.ref_length, group[j]->tile.query_length);
+            double task_secs = TaskSecs(task_event[j]);
+            if (task_secs >= 0) {
+                gactx_cost.Add(cycles, task_secs);
+                inst->predicted_cycles += cycles;
+                inst->busy_secs += task_secs;
+            }
+        }
+
+        for (int j = 0; j < num_launch; j++) {
+            extend_output op;
+            int* tile_output = &h_gactx_tile_output[16*j];
+            uint32_t* tb_output = &h_gactx_tb_output[j*MAX_GACTX_TB_BYTES/4];
+
+            op.max_ref_offset = tile_output[1];
+            op.max_query_offset = tile_output[2];
+            int num_tb = 16 * tile_output[5];
+
+            op.tb_pointers.clear();
+            for (int i=0; i < num_tb; i++) {
+                op.tb_pointers.push_back(tb_output[i]);
+            }
+
+            group[j]->result.set_value(op);
+            delete group[j];
+
+            clReleaseEvent(task_event[j]);
+            clReleaseEvent(rd_event[j]);
+        }
+        for (int j = 0; j < num_tb_reads; j++) {
+            clReleaseEvent(tb_event[j]);
+        }
+
+        inst->num_groups++;
+        inst->num_tiles += num_launch;
+        group.clear();
+    }
+}
+
+std::future<extend_output> GACTXSubmit (extend_tile tile, uint8_t align_fields) {
     assert(tile.ref_length <= MAX_GACTX_TILE_SIZE);
     assert(tile.query_length <= MAX_GACTX_TILE_SIZE);
 
-    gactx_lock.lock();
+    gactx_request* req = new gactx_request(tile, align_fields);
+    std::future<extend_output> result = req->result.get_future();
 
-    for (int i = 0; i < 11; i++) {
-        err |= clSetKernelArg(gactx_kernel, i, sizeof(int), &cfg.gact_sub_mat[i]);
-    }
-    err |= clSetKernelArg(gactx_kernel, 11, sizeof(int), &cfg.gap_open);
-    err |= clSetKernelArg(gactx_kernel, 12, sizeof(int), &cfg.gap_extend);
-    uint d_y_drop = cfg.ydrop;
-    err |= clSetKernelArg(gactx_kernel, 13, sizeof(uint), &d_y_drop);
-    uint32_t d_batch_align_fields = align_fields;
-    err |= clSetKernelArg(gactx_kernel, 14, sizeof(uint), &d_batch_align_fields);
-    uint32_t d_ref_len = tile.ref_length;
-    err |= clSetKernelArg(gactx_kernel, 15, sizeof(cl_uint), &d_ref_len);
-    uint32_t d_query_len = tile.query_length;
-    err |= clSetKernelArg(gactx_kernel, 16, sizeof(cl_uint), &d_query_len);
-    uint64_t d_ref_offset = tile.ref_offset;
-    err |= clSetKernelArg(gactx_kernel, 17, sizeof(cl_ulong), &d_ref_offset);
-    uint64_t d_query_offset = tile.query_offset;
-    err |= clSetKernelArg(gactx_kernel, 18, sizeof(cl_ulong), &d_query_offset);
-    err |= clSetKernelArg(gactx_kernel, 19, sizeof(cl_mem), &d_ref_seq[3]);
-    err |= clSetKernelArg(gactx_kernel, 20, sizeof(cl_mem), &d_query_seq[3]);
-    err |= clSetKernelArg(gactx_kernel, 21, sizeof(cl_mem), &d_gactx_tile_output);
-    err |= clSetKernelArg(gactx_kernel, 22, sizeof(cl_mem), &d_gactx_tb_output);
+    gactx_queue_lock.lock();
+    gactx_queue.push_back(req);
+    gactx_queue_lock.unlock();
+    gactx_queue_cv.notify_one();
 
+    return result;
+}
 
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "Error: Failed to set kernel arguments! %d\n", err);
-        fprintf(stderr, "Test failed\n");
-        exit(1);
-    }
+extend_output GACTXRequest (extend_tile tile, uint8_t align_fields) {
+    return GACTXSubmit(tile, align_fields).get();
+}
 
-    err = clEnqueueTask(gactx_commands, gactx_kernel, 0, NULL, NULL);
-    if (err) {
-        fprintf(stderr, "Error: Failed to execute kernel! %d\n", err);
-        fprintf(stderr, "Test failed\n");
-        exit(1);
+void ShutdownProcessor() {
+    gactx_queue_lock.lock();
+    gactx_shutdown = true;
+    gactx_queue_lock.unlock();
+    gactx_queue_cv.notify_all();
+    for (auto inst: gactx_instances) {
+        inst->dispatcher.join();
     }
 
-    clFinish(gactx_commands);
+    fprintf(stderr, "#BSW input bytes: %lu (hit batches: %lu), readback bytes: %lu\n", bsw_input_bytes.load(),
+            bsw_hit_batches.load(), bsw_readback_bytes.load());
+    fprintf(stderr, "#BSW kernel grants: %lu (waited: %lu, avg wait: %.1f usec, max wait: %lu usec)\n",
+            pool_num_grants, pool_num_waits,
+            (pool_num_waits > 0) ? ((double) pool_total_wait_us / pool_num_waits) : 0.0, pool_max_wait_us);
+    // host overhead of a launch is the time spent setting arguments and
+    // enqueueing the task
+    for (auto inst: bsw_instances) {
+        fprintf(stderr, "#%s launches: %lu (avg host overhead: %.2f usec, args set: %lu, unchanged: %lu)\n", inst->name.c_str(),
+                inst->num_launches, (inst->num_launches > 0) ? (inst->launch_ns / 1e3 / inst->num_launches) : 0.0,
+                inst->args.num_set, inst->args.num_skipped);
+    }
+    for (auto inst: gactx_instances) {
+        fprintf(stderr, "#%s launch groups: %lu (tiles: %lu, avg tiles per group: %.2f)\n", inst->name.c_str(),
+                inst->num_groups, inst->num_tiles, (inst->num_groups > 0) ? ((double) inst->num_tiles / inst->num_groups) : 0.0);
+        fprintf(stderr, "#%s launches: %lu (avg host overhead: %.2f usec, args set: %lu, unchanged: %lu)\n", inst->name.c_str(),
+                inst->num_tiles, (inst->num_tiles > 0) ? (inst->launch_ns / 1e3 / inst->num_tiles) : 0.0,
+                inst->args.num_set, inst->args.num_skipped);
+    }
 
-    cl_event rd_event;
-    
-    err = 0;
-    err |= clEnqueueReadBuffer(gactx_commands, d_gactx_tile_output, CL_TRUE, 0, sizeof(int) * 16, h_gactx_tile_output, 0, NULL, &rd_event);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "error: failed to read output array! %d\n", err);
-        fprintf(stderr, "test failed\n");
-        exit(1);
+    // the fit is in use once it has seen enough runs; per kernel, the
+    // estimated cycles are converted with the fitted slope only, as the
+    // overhead of a launch overlaps the transfers of the others
+    double overhead, secs_per_cycle;
+    bsw_cost.Get(overhead, secs_per_cycle);
+    fprintf(stderr, "#BSW cost model: %lu runs, fit overhead %.1f usec + %.4f nsec/cycle (estimated cycles: %lu, measured: %.1f ms)\n",
+            bsw_cost.n, overhead * 1e6, secs_per_cycle * 1e9, bsw_cost.predicted_cycles, bsw_cost.measured_secs * 1e3);
+    fprintf(stderr, "#BSW requests: %lu (launches: %lu)\n", bsw_num_requests.load(), bsw_num_chunks.load());
+    for (auto inst: bsw_instances) {
+        fprintf(stderr, "#%s estimated busy: %.1f ms, measured busy: %.1f ms\n", inst->name.c_str(),
+                inst->predicted_cycles * secs_per_cycle * 1e3, inst->busy_secs * 1e3);
     }
-    clWaitForEvents(1, &rd_event);
+    gactx_cost.Get(overhead, secs_per_cycle);
+    fprintf(stderr, "#GACT-X cost model: %lu runs, fit overhead %.1f usec + %.4f nsec/cycle (estimated cycles: %lu, measured: %.1f ms)\n",
+            gactx_cost.n, overhead * 1e6, secs_per_cycle * 1e9, gactx_cost.predicted_cycles, gactx_cost.measured_secs * 1e3);
+    for (auto inst: gactx_instances) {
+        fprintf(stderr, "#%s estimated busy: %.1f ms, measured busy: %.1f ms\n", inst->name.c_str(),
+                inst->predicted_cycles * secs_per_cycle * 1e3, inst->busy_secs * 1e3);
+    }
+    fprintf(stderr, "#GACT-X traceback readback bytes: %lu (%.1f per tile, %s)\n", gactx_tb_readback_bytes.load(),
+            (gactx_tb_tiles > 0) ? ((double) gactx_tb_readback_bytes / gactx_tb_tiles) : 0.0, cfg.tb_rle ? "run-length" : "2-bit");
 
-    err = 0;
-    err |= clEnqueueReadBuffer(gactx_commands, d_gactx_tb_output, CL_TRUE, 0, sizeof(int) * MAX_GACTX_TB_BYTES/4, h_gactx_tb_output, 0, NULL, &rd_event);
-    if (err != CL_SUCCESS) {
-        fprintf(stderr, "error: failed to read output array! %d\n", err);
-        fprintf(stderr, "test failed\n");
-        exit(1);
+    for (auto dev: fpga_devices) {
+        uint64_t bsw_tiles = 0, gactx_tiles = 0;
+        for (auto inst: bsw_instances) {
+            bsw_tiles += (inst->dev == dev) ? inst->num_tiles : 0;
+        }
+        for (auto inst: gactx_instances) {
+            gactx_tiles += (inst->dev == dev) ? inst->num_tiles : 0;
+        }
+        fprintf(stderr, "#FPGA device %d: BSW tiles: %lu, GACT-X tiles: %lu\n", dev->index, bsw_tiles, gactx_tiles);
     }
-    clWaitForEvents(1, &rd_event);
+    fprintf(stderr, "#query uploads: %lu (prefetched: %lu, avg wait: %.1f usec)\n", query_num_uploads, query_num_prefetched,
+            (query_num_uploads > 0) ? ((double) query_total_wait_us / query_num_uploads) : 0.0);
+    fprintf(stderr, "#sequence upload bytes: %lu (%s, %lu bases)\n", seq_upload_bytes,
+            cfg.packed_seq ? "packed" : "ascii", seq_ascii_bytes);
 
-    gactx_lock.unlock();
+    if (query_upload_pending) {
+        WaitQueryUpload();
+    }
+    for (auto dev: fpga_devices) {
+        for (int b = 0; b < NUM_BANKS; b++) {
+            if (dev->bank_used[b]) {
+                clReleaseMemObject(dev->d_ref_seq[b]);
+                for (int s = 0; s < NUM_QUERY_SLOTS; s++) {
+                    if (dev->d_query_slot[b][s]) {
+                        clReleaseMemObject(dev->d_query_slot[b][s]);
+                    }
+                }
+            }
+        }
+    }
 
-    int score = h_gactx_tile_output[0];
-    op.max_ref_offset = h_gactx_tile_output[1];
-    op.max_query_offset = h_gactx_tile_output[2];
-    int num_tb = 16 * h_gactx_tile_output[5];
-    
-    op.tb_pointers.clear();
-    for (int i=0; i < num_tb; i++) {
-        op.tb_pointers.push_back(h_gactx_tb_output[i]);
+    for (auto inst: bsw_instances) {
+        for (int j = 0; j < NUM_SLOTS; j++) {
+            clReleaseMemObject(inst->d_batch_id[j]);
+            clReleaseMemObject(inst->d_batch_params[j]);
+            clReleaseMemObject(inst->d_batch_tile_output[j]);
+            free(inst->h_batch_id[j]);
+            free(inst->h_batch_params[j]);
+            free(inst->h_batch_tile_output[j]);
+        }
+        clReleaseMemObject(inst->d_chr_ends);
+        clReleaseKernel(inst->kernel);
+        clReleaseCommandQueue(inst->commands);
+        delete inst;
     }
+    bsw_instances.clear();
 
-    return op;
-}
+    for (auto inst: gactx_instances) {
+        for (int j = 0; j < NUM_GACTX_SLOTS; j++) {
+            clReleaseMemObject(inst->d_tile_output[j]);
+            clReleaseMemObject(inst->d_tb_output[j]);
+        }
+        clReleaseKernel(inst->kernel);
+        clReleaseCommandQueue(inst->commands);
+        delete inst;
+    }
+    gactx_instances.clear();
 
-void ShutdownProcessor() {
-    for (int i = 0; i < NUM_KERNELS; i++) {
-        clReleaseMemObject(d_ref_seq[i]);
-        clReleaseMemObject(d_query_seq[i]);
-        clReleaseMemObject(d_batch_id[i]);
-        clReleaseMemObject(d_batch_params[i]);
-        for (int j = 0; j < 4; j++) {
-            clReleaseMemObject(d_batch_tile_output[i][j]);
-        }
-    }
-
-    clReleaseProgram(program);
-    for (int k = 0; k < NUM_KERNELS; k++){
-        clReleaseKernel(kernel[k]);
-        clReleaseCommandQueue(commands[k]);
-    }
-    clReleaseMemObject(d_gactx_tile_output);
-    clReleaseMemObject(d_gactx_tb_output);
-    clReleaseCommandQueue(gactx_commands);
-    clReleaseKernel(gactx_kernel);
-    clReleaseContext(context);
+    for (auto dev: fpga_devices) {
+        clReleaseProgram(dev->program);
+        clReleaseContext(dev->context);
+        delete dev;
+    }
+    fpga_devices.clear();
 }
 
-DRAM *g_DRAM = nullptr;
-
-InitializeProcessor_ptr g_InitializeProcessor = InitializeProcessor;
-ShutdownProcessor_ptr g_ShutdownProcessor = ShutdownProcessor;
-SendRequest_ptr g_SendRequest = SendRequest;
-SendBatchRequest_ptr g_SendBatchRequest = SendBatchRequest;
-GACTXRequest_ptr g_GACTXRequest = GACTXRequest;
-SendRefWriteRequest_ptr g_SendRefWriteRequest = SendRefWriteRequest;
-SendQueryWriteRequest_ptr g_SendQueryWriteRequest = SendQueryWriteRequest;
+ProcessorBackend fpga_backend = {
+    "fpga",
+    InitializeProcessor,
+    ShutdownProcessor,
+    SendRequest,
+    SendBatchRequest,
+    SendHitBatchRequest,
+    GACTXRequest,
+    GACTXSubmit,
+    SendRefWriteRequest,
+    SendQueryWriteRequest,
+    SendQueryPrefetchRequest
+};
@@ -5,8 +5,10 @@
 #include <string.h>
 #include <stdio.h>
 #include <mutex>
-#include <CL/opencl.h>
-#include <CL/cl_ext.h>
+#include <future>
+#include <atomic>
+#include <string>
+#include "seed_pos_table.h"
 
 #define NUM_WORKGROUPS (1)
 #define WORKGROUP_SIZE (256)
@@ -25,7 +27,7 @@
 #define MAX_TILE_SIZE 512
 
 #define MAX_NUM_TILES (1 << 20)
-    
+
 typedef int AlnOp;
 enum AlnOperands { ZERO_OP, INSERT_OP, DELETE_OP, LONG_INSERT_OP, LONG_DELETE_OP};
 enum states { Z, I, D, M , L_Z, L_I, L_D};
@@ -84,17 +86,74 @@ struct extend_output {
 typedef size_t(*InitializeProcessor_ptr)(int t, int f, char* xclbin);
 typedef void(*SendRequest_ptr)(size_t ref_offset, size_t query_offset, size_t ref_length, size_t query_length, uint8_t align_fields);
 typedef std::vector<tile_output> (*SendBatchRequest_ptr)(std::vector<filter_tile> tiles, uint8_t align_fields, int thresh);
+typedef std::vector<tile_output> (*SendHitBatchRequest_ptr)(std::vector<seed_hit> hits, size_t query_len, uint8_t align_fields, int thresh);
 typedef extend_output (*GACTXRequest_ptr)(extend_tile tile, uint8_t align_fields);
+typedef std::future<extend_output> (*GACTXSubmit_ptr)(extend_tile tile, uint8_t align_fields);
 typedef void(*ShutdownProcessor_ptr)();
 typedef void(*SendRefWriteRequest_ptr)(size_t addr, size_t len);
 typedef void(*SendQueryWriteRequest_ptr)(size_t addr, size_t len);
+typedef void(*SendQueryPrefetchRequest_ptr)(size_t addr, size_t len);
+
+// Entry points of one processor implementation. SelectProcessor() copies the
+// chosen backend into the g_* pointers used by the pipeline.
+struct ProcessorBackend {
+    const char* name;
+    InitializeProcessor_ptr initialize;
+    ShutdownProcessor_ptr shutdown;
+    SendRequest_ptr send_request;
+    SendBatchRequest_ptr send_batch_request;
+    SendHitBatchRequest_ptr send_hit_batch_request;
+    GACTXRequest_ptr gactx_request;
+    GACTXSubmit_ptr gactx_submit;
+    SendRefWriteRequest_ptr send_ref_write_request;
+    SendQueryWriteRequest_ptr send_query_write_request;
+    SendQueryPrefetchRequest_ptr send_query_prefetch_request;
+};
+
+extern ProcessorBackend cpu_backend;
+#ifdef WITH_OPENCL
+extern ProcessorBackend fpga_backend;
+extern ProcessorBackend hybrid_backend;
+
+// Batches waiting for a BSW kernel slot, batches holding one and the total
+// number of slots.
+void BSWPoolLoad(int& queued, int& in_flight, int& num_slots);
+
+// Filter batch of the hybrid backend with the first fpga_share tiles as the
+// device share; fpga_tiles returns the number of tiles the device aligned
+std::vector<tile_output> HybridSplitBatch(const std::vector<filter_tile>& tiles, size_t fpga_share, uint8_t align_fields, int thresh,
+        size_t& fpga_tiles);
+#endif
+
+// Filter tiles aligned by each kind of backend
+extern std::atomic<uint64_t> g_fpga_filter_tiles;
+extern std::atomic<uint64_t> g_cpu_filter_tiles;
+
+void SelectProcessor(std::string name);
+
+// Chromosome end positions of the reference in g_DRAM, ascending and
+// followed by an all-ones sentinel
+extern std::vector<ref_coord_t> g_chr_ends;
+void BuildChrEndTable(const std::vector<ref_coord_t>& chr_coord, const std::vector<uint32_t>& chr_len);
+
+// Filter tile of up to tile_size bases centred on a seed hit, clipped to the
+// end of the reference chromosome and to the query. This is the reference
+// for the tile windows the BSW kernels derive from hits in hit mode.
+filter_tile HitTile(const seed_hit& hit, size_t query_len, size_t tile_size, bool reverse);
+
+// Hit batch request served by turning the hits into tiles on the host and
+// passing them to g_SendBatchRequest; batch_id is the index of the hit
+std::vector<tile_output> SendHitBatchAsTiles(std::vector<seed_hit> hits, size_t query_len, uint8_t align_fields, int thresh);
 
 extern DRAM *g_DRAM;
     
 extern InitializeProcessor_ptr g_InitializeProcessor;
 extern SendRequest_ptr g_SendRequest;
 extern SendBatchRequest_ptr g_SendBatchRequest;
+extern SendHitBatchRequest_ptr g_SendHitBatchRequest;
 extern GACTXRequest_ptr g_GACTXRequest;
+extern GACTXSubmit_ptr g_GACTXSubmit;
 extern SendRefWriteRequest_ptr g_SendRefWriteRequest;
 extern SendQueryWriteRequest_ptr g_SendQueryWriteRequest;
+extern SendQueryPrefetchRequest_ptr g_SendQueryPrefetchRequest;
 extern ShutdownProcessor_ptr g_ShutdownProcessor;
@@ -0,0 +1,247 @@
+// Throughput of the CPU BSW and GACT-X engines on synthetic tiles. The scalar
+// engine is the reference: every SIMD result, including the GACT-X traceback
+// words, is checked against it.
+//
+// Usage: align_bench <bsw|gactx> [num_tiles] [tile_size]
+//        align_bench pack [seq_len]
+// Scoring, band size and ydrop are read from params.cfg. The pack mode checks
+// the SIMD sequence packer against the scalar one and unpacks the result.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include "ConfigFile.h"
+#include "cpu_align.h"
+#include "seq_pack.h"
+
+static double Elapsed (struct timeval& start, struct timeval& end) {
+    return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+}
+
+// Query is the reference with ~10% substitutions and ~2% single-base indels,
+// so that scores and max positions spread over the whole tile.
+static void MutateSeq (const std::vector<int8_t>& ref, std::vector<int8_t>& query, size_t len) {
+    query.clear();
+    size_t j = 0;
+    while ((query.size() < len) && (j < ref.size())) {
+        int r = rand() % 100;
+        if (r < 10) {
+            query.push_back(rand() % 4);
+            j++;
+        }
+        else if (r < 11) {
+            j++;
+        }
+        else if (r < 12) {
+            query.push_back(rand() % 4);
+        }
+        else {
+            query.push_back(ref[j++]);
+        }
+    }
+    while (query.size() < len) {
+        query.push_back(rand() % 4);
+    }
+}
+
+// Mixed-case sequence with runs of N and occasional other IUPAC codes
+static int PackBench (size_t len) {
+    const char* bases = "ACGTacgt";
+    const char* others = "NnRYKM";
+    std::vector<char> seq(len);
+    size_t i = 0;
+    while (i < len) {
+        if (rand() % 1000 == 0) {
+            size_t run = 1 + rand() % 200;
+            for (size_t j = 0; (j < run) && (i < len); j++) {
+                seq[i++] = 'N';
+            }
+        }
+        else {
+            seq[i++] = (rand() % 500 == 0) ? others[rand() % 6] : bases[rand() % 8];
+        }
+    }
+
+    std::vector<uint8_t> ref_packed(PackedSeqBytes(len)), packed(PackedSeqBytes(len));
+    std::vector<char> unpacked(len);
+    struct timeval start_time, end_time;
+
+    int best_isa = DetectCPUISA();
+    int isas[] = {ISA_SCALAR, ISA_AVX2};
+    double scalar_rate = 0;
+    int ret = 0;
+
+    printf("pack length: %zu, packed bytes: %zu (%.2f bits per base)\n", len, PackedSeqBytes(len), 8.0 * PackedSeqBytes(len) / len);
+    for (int isa: isas) {
+        if (isa > best_isa) {
+            continue;
+        }
+
+        gettimeofday(&start_time, NULL);
+        PackSeq(isa, seq.data(), len, packed.data());
+        gettimeofday(&end_time, NULL);
+        double rate = len / Elapsed(start_time, end_time) / 1e6;
+
+        int mismatches = 0;
+        if (isa == ISA_SCALAR) {
+            ref_packed = packed;
+            scalar_rate = rate;
+        }
+        else if (packed != ref_packed) {
+            mismatches = 1;
+        }
+
+        UnpackSeq(packed.data(), len, unpacked.data());
+        for (size_t j = 0; j < len; j++) {
+            char c = seq[j] & 0xDF;
+            char expected = ((c == 'A') || (c == 'C') || (c == 'G') || (c == 'T')) ? c : 'N';
+            if (unpacked[j] != expected) {
+                if (mismatches == 0) {
+                    fprintf(stderr, "base %zu: %s unpacked %c, expected %c\n", j, CPUISAName(isa), unpacked[j], expected);
+                }
+                mismatches++;
+            }
+        }
+        if (mismatches > 0) {
+            ret = EXIT_FAILURE;
+        }
+
+        printf("%-8s %12.0f Mbases/s  speedup: %5.2fx  mismatches: %d\n", CPUISAName(isa), rate, rate / scalar_rate, mismatches);
+    }
+
+    return ret;
+}
+
+int main (int argc, char** argv) {
+    if ((argc > 1) && (strcmp(argv[1], "pack") == 0)) {
+        long len = (argc > 2) ? atol(argv[2]) : 100000000;
+        if (len <= 0) {
+            printf("Usage: %s pack [seq_len]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        srand(1);
+        return PackBench(len);
+    }
+
+    bool gactx = (argc > 1) && (strcmp(argv[1], "gactx") == 0);
+    int max_tile_size = gactx ? 2048 : 512;
+    int num_tiles = (argc > 2) ? atoi(argv[2]) : (gactx ? 1024 : 16384);
+    int tile_size = (argc > 3) ? atoi(argv[3]) : 320;
+
+    if ((argc < 2) || (!gactx && strcmp(argv[1], "bsw") != 0) ||
+            (num_tiles <= 0) || (tile_size <= 0) || (tile_size > max_tile_size)) {
+        printf("Usage: %s <bsw|gactx> [num_tiles] [tile_size]\n", argv[0]);
+        printf("       %s pack [seq_len]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ConfigFile cfg_file("params.cfg");
+    int sub_mat[11];
+    sub_mat[0]  = cfg_file.Value("Scoring", "sub_AA");
+    sub_mat[1]  = cfg_file.Value("Scoring", "sub_AC");
+    sub_mat[2]  = cfg_file.Value("Scoring", "sub_AG");
+    sub_mat[3]  = cfg_file.Value("Scoring", "sub_AT");
+    sub_mat[4]  = cfg_file.Value("Scoring", "sub_CC");
+    sub_mat[5]  = cfg_file.Value("Scoring", "sub_CG");
+    sub_mat[6]  = cfg_file.Value("Scoring", "sub_CT");
+    sub_mat[7]  = cfg_file.Value("Scoring", "sub_GG");
+    sub_mat[8]  = cfg_file.Value("Scoring", "sub_GT");
+    sub_mat[9]  = cfg_file.Value("Scoring", "sub_TT");
+    sub_mat[10] = cfg_file.Value("Scoring", "sub_N");
+    int gap_open   = cfg_file.Value("Scoring", "gap_open");
+    int gap_extend = cfg_file.Value("Scoring", "gap_extend");
+    int band_size  = cfg_file.Value("BSW_params", "band_size");
+    int ydrop      = cfg_file.Value("GACTX_params", "ydrop");
+
+    cpu_scoring sc;
+    InitCPUScoring(sc, sub_mat, gap_open, gap_extend, band_size, ydrop);
+
+    srand(1);
+    std::vector<std::vector<int8_t> > refs(num_tiles), queries(num_tiles);
+    std::vector<bsw_tile_seq> tiles(num_tiles);
+    for (int t = 0; t < num_tiles; t++) {
+        // a quarter of the tiles are unrelated sequences and some are short,
+        // as at the ends of chromosomes
+        int rl = (t % 7 == 0) ? (1 + rand() % tile_size) : tile_size;
+        int ql = (t % 5 == 0) ? (1 + rand() % tile_size) : tile_size;
+        refs[t].resize(rl);
+        for (int j = 0; j < rl; j++) {
+            refs[t][j] = (rand() % 64 == 0) ? 4 : (rand() % 4);
+        }
+        if (t % 4 == 0) {
+            queries[t].resize(ql);
+            for (int i = 0; i < ql; i++) {
+                queries[t][i] = rand() % 4;
+            }
+        }
+        else {
+            MutateSeq(refs[t], queries[t], ql);
+        }
+        tiles[t].ref = refs[t].data();
+        tiles[t].ref_len = rl;
+        tiles[t].query = queries[t].data();
+        tiles[t].query_len = ql;
+    }
+
+    std::vector<int> ref_score(num_tiles), ref_rmax(num_tiles), ref_qmax(num_tiles);
+    std::vector<int> score(num_tiles), rmax(num_tiles), qmax(num_tiles);
+    std::vector<std::vector<uint32_t> > ref_tb(num_tiles), tb(num_tiles);
+
+    struct timeval start_time, end_time;
+
+    int best_isa = DetectCPUISA();
+    int isas[] = {ISA_SCALAR, ISA_AVX2, ISA_AVX512};
+    double scalar_rate = 0;
+    int ret = 0;
+
+    printf("%s tiles: %d, tile size: %d, band: %d, ydrop: %d\n", argv[1], num_tiles, tile_size, band_size, ydrop);
+    for (int isa: isas) {
+        if (isa > best_isa) {
+            continue;
+        }
+
+        gettimeofday(&start_time, NULL);
+        if (gactx) {
+            for (int t = 0; t < num_tiles; t++) {
+                GACTXTile(isa, tiles[t].ref, tiles[t].ref_len, tiles[t].query, tiles[t].query_len, sc,
+                        score[t], rmax[t], qmax[t], tb[t]);
+            }
+        }
+        else {
+            BSWTiles(isa, tiles.data(), num_tiles, sc, score.data(), rmax.data(), qmax.data());
+        }
+        gettimeofday(&end_time, NULL);
+        double rate = num_tiles / Elapsed(start_time, end_time);
+
+        int mismatches = 0;
+        if (isa == ISA_SCALAR) {
+            ref_score = score;
+            ref_rmax = rmax;
+            ref_qmax = qmax;
+            ref_tb.swap(tb);
+            scalar_rate = rate;
+        }
+        else {
+            for (int t = 0; t < num_tiles; t++) {
+                if ((score[t] != ref_score[t]) || (rmax[t] != ref_rmax[t]) || (qmax[t] != ref_qmax[t]) ||
+                        (gactx && (tb[t] != ref_tb[t]))) {
+                    if (mismatches == 0) {
+                        fprintf(stderr, "tile %d: %s (%d, %d, %d) != scalar (%d, %d, %d)\n", t, CPUISAName(isa),
+                                score[t], rmax[t], qmax[t], ref_score[t], ref_rmax[t], ref_qmax[t]);
+                    }
+                    mismatches++;
+                }
+            }
+            if (mismatches > 0) {
+                ret = EXIT_FAILURE;
+            }
+        }
+
+        printf("%-8s %12.0f tiles/s  speedup: %5.2fx  mismatches: %d\n", CPUISAName(isa), rate, rate / scalar_rate, mismatches);
+    }
+
+    return ret;
+}
@@ -0,0 +1,364 @@
+// Cycles per tile and PE utilization of the verilated BSW_Array and
+// GACTX_Array models (array_model.h), for the NUM_PE and BLOCK_WIDTH they
+// were built with. Every result, including the GACT-X traceback words, is
+// checked against the scalar CPU engine. GACT-X tiles are run a second time
+// with the run-length traceback (tb_run_length), which must match the
+// traceback of the first run converted with RunLengthTraceback() and, decoded
+// back into directions, the steps of the first run.
+//
+// Usage: array_bench <bsw|gactx> [num_tiles] [tile_size]
+//        array_bench trace <tile_trace> [max_tiles]
+//        array_bench vectors <src/host/GACTX>
+// Synthetic tiles are generated as in align_bench; a tile trace is written by
+// the simulated device (tile_trace in [Simulator]) and holds the tiles of a
+// real run. Scoring, band size and ydrop are read from params.cfg, for the
+// GACT-X test vectors (ref.txt, query.txt, parameters.txt) from the
+// params.cfg next to them; each vector is printed with its traceback.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ConfigFile.h"
+#include "cpu_align.h"
+#include "kernel_cost.h"
+#include "array_model.h"
+
+// align_fields bits, as in graph.h
+#define BENCH_REVERSE_REF (1 << 4)
+#define BENCH_COMPLEMENT_REF (1 << 3)
+#define BENCH_REVERSE_QUERY (1 << 2)
+#define BENCH_COMPLEMENT_QUERY (1 << 1)
+#define BENCH_TB_RUN_LENGTH (1 << 6)
+
+struct bench_tile {
+    bool gactx;
+    uint8_t align_fields;
+    std::string ref;
+    std::string query;
+};
+
+struct bench_stats {
+    uint64_t num_tiles;
+    uint64_t load_cycles;
+    uint64_t compute_cycles;
+    uint64_t readout_cycles;
+    uint64_t useful_cells;
+    uint64_t estimated_cycles;
+    uint64_t tb_words;
+    uint64_t rle_tb_words;
+    uint64_t rle_readout_cycles;
+    uint64_t mismatches;
+};
+
+static double Elapsed (struct timeval& start, struct timeval& end) {
+    return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+}
+
+// Query is the reference with ~10% substitutions and ~2% single-base indels,
+// as in align_bench
+static std::string MutateSeq (const std::string& ref, size_t len) {
+    const char* bases = "ACGT";
+    std::string query;
+    size_t j = 0;
+    while ((query.size() < len) && (j < ref.size())) {
+        int r = rand() % 100;
+        if (r < 10) {
+            query.push_back(bases[rand() % 4]);
+            j++;
+        }
+        else if (r < 11) {
+            j++;
+        }
+        else if (r < 12) {
+            query.push_back(bases[rand() % 4]);
+        }
+        else {
+            query.push_back(ref[j++]);
+        }
+    }
+    while (query.size() < len) {
+        query.push_back(bases[rand() % 4]);
+    }
+    return query;
+}
+
+static void SyntheticTiles (bool gactx, int num_tiles, int tile_size, std::vector<bench_tile>& tiles) {
+    const char* bases = "ACGT";
+    srand(1);
+    for (int t = 0; t < num_tiles; t++) {
+        bench_tile tile;
+        tile.gactx = gactx;
+        tile.align_fields = 0;
+        int rl = (t % 7 == 0) ? (1 + rand() % tile_size) : tile_size;
+        int ql = (t % 5 == 0) ? (1 + rand() % tile_size) : tile_size;
+        for (int j = 0; j < rl; j++) {
+            tile.ref.push_back((rand() % 64 == 0) ? 'N' : bases[rand() % 4]);
+        }
+        if (t % 4 == 0) {
+            for (int i = 0; i < ql; i++) {
+                tile.query.push_back(bases[rand() % 4]);
+            }
+        }
+        else {
+            tile.query = MutateSeq(tile.ref, ql);
+        }
+        tiles.push_back(tile);
+    }
+}
+
+static bool ReadTrace (const char* filename, size_t max_tiles, std::vector<bench_tile>& tiles) {
+    std::ifstream trace(filename);
+    if (!trace) {
+        fprintf(stderr, "Error: cannot open tile trace %s!\n", filename);
+        return false;
+    }
+    std::string kernel;
+    unsigned align_fields;
+    bench_tile tile;
+    while ((tiles.size() < max_tiles) && (trace >> kernel >> align_fields >> tile.ref >> tile.query)) {
+        tile.gactx = (kernel == "gactx");
+        tile.align_fields = align_fields;
+        tiles.push_back(tile);
+    }
+    return true;
+}
+
+// parameters.txt: ref_length query_length ref_offset query_offset align_fields
+static bool ReadVectors (const std::string& dir, std::vector<bench_tile>& tiles) {
+    std::string ref, query;
+    std::ifstream infile(dir + "/ref.txt");
+    getline(infile, ref);
+    infile.close();
+    infile.open(dir + "/query.txt");
+    getline(infile, query);
+    infile.close();
+
+    infile.open(dir + "/parameters.txt");
+    if (!infile) {
+        fprintf(stderr, "Error: cannot open %s/parameters.txt!\n", dir.c_str());
+        return false;
+    }
+    size_t rl, ql, ro, qo;
+    unsigned align_fields;
+    while (infile >> rl >> ql >> ro >> qo >> align_fields) {
+        if ((ro + rl > ref.size()) || (qo + ql > query.size())) {
+            fprintf(stderr, "Error: vector %lu is outside the sequences of %s!\n", tiles.size(), dir.c_str());
+            return false;
+        }
+        bench_tile tile;
+        tile.gactx = true;
+        tile.align_fields = align_fields;
+        tile.ref = ref.substr(ro, rl);
+        tile.query = query.substr(qo, ql);
+        tiles.push_back(tile);
+    }
+    return true;
+}
+
+// Directions of a GACT-X traceback in the order the kernel wrote them,
+// decoded from 2-bit directions or from run-length tokens; zero directions
+// and tokens are padding
+static std::vector<uint8_t> TracebackSteps (const std::vector<uint32_t>& tb, bool run_length) {
+    std::vector<uint8_t> steps;
+    for (uint32_t word: tb) {
+        if (run_length) {
+            for (int j = 0; j < 2; j++) {
+                uint32_t token = (word >> (16*j)) & 0xffff;
+                uint8_t dir = token >> TB_RUN_WIDTH;
+                if (dir != 0) {
+                    steps.insert(steps.end(), token & ((1 << TB_RUN_WIDTH) - 1), dir);
+                }
+            }
+        }
+        else {
+            for (int j = 0; j < 16; j++) {
+                uint8_t dir = (word >> (2*j)) & 3;
+                if (dir != 0) {
+                    steps.push_back(dir);
+                }
+            }
+        }
+    }
+    return steps;
+}
+
+static void RunTile (const bench_tile& tile, const array_params& params, const cpu_scoring& sc, bool print, bench_stats& stats) {
+    size_t rl = std::min(tile.ref.size(), ArrayMaxTileSize(tile.gactx));
+    size_t ql = std::min(tile.query.size(), ArrayMaxTileSize(tile.gactx));
+
+    array_tile_result r;
+    if (tile.gactx) {
+        GACTXArrayTile(params, tile.align_fields, tile.ref.data(), rl, tile.query.data(), ql, r);
+    }
+    else {
+        BSWArrayTile(params, tile.align_fields, tile.ref.data(), rl, tile.query.data(), ql, r);
+    }
+
+    std::vector<int8_t> ref(rl), query(ql);
+    EncodeTileSeq(tile.ref.data(), rl, (tile.align_fields & BENCH_REVERSE_REF), (tile.align_fields & BENCH_COMPLEMENT_REF), ref.data());
+    EncodeTileSeq(tile.query.data(), ql, (tile.align_fields & BENCH_REVERSE_QUERY), (tile.align_fields & BENCH_COMPLEMENT_QUERY), query.data());
+
+    int score, rmax, qmax;
+    std::vector<uint32_t> tb;
+    if (tile.gactx) {
+        GACTXTile(ISA_SCALAR, ref.data(), rl, query.data(), ql, sc, score, rmax, qmax, tb);
+    }
+    else {
+        BSWTile(ref.data(), rl, query.data(), ql, sc, score, rmax, qmax);
+    }
+
+    if ((score != r.score) || (rmax != r.ref_max_pos) || (qmax != r.query_max_pos) || (tile.gactx && (tb != r.tb))) {
+        if (stats.mismatches == 0) {
+            fprintf(stderr, "tile %lu: array (%d, %d, %d, %lu tb words) != scalar (%d, %d, %d, %lu tb words)\n", stats.num_tiles,
+                    r.score, r.ref_max_pos, r.query_max_pos, r.tb.size(), score, rmax, qmax, tb.size());
+        }
+        stats.mismatches++;
+    }
+
+    // against the 2-bit traceback of the array itself, so that a run-length
+    // error is told apart from a mismatch of the first run
+    if (tile.gactx) {
+        array_tile_result rle;
+        GACTXArrayTile(params, tile.align_fields | BENCH_TB_RUN_LENGTH, tile.ref.data(), rl, tile.query.data(), ql, rle);
+        tb = r.tb;
+        RunLengthTraceback(tb);
+        std::vector<uint8_t> steps = TracebackSteps(r.tb, false);
+        std::vector<uint8_t> rle_steps = TracebackSteps(rle.tb, true);
+        if ((rle.tb != tb) || (rle_steps != steps)) {
+            if (stats.mismatches == 0) {
+                fprintf(stderr, "tile %lu: array run-length traceback (%lu words, %lu steps decoded) != 2-bit traceback "
+                        "(%lu words, %lu steps)\n", stats.num_tiles, rle.tb.size(), rle_steps.size(), r.tb.size(), steps.size());
+            }
+            stats.mismatches++;
+        }
+        if (print) {
+            printf("vector %lu: score %d, ref max pos %d, query max pos %d, 2-bit traceback: %lu steps in %lu words, "
+                    "run-length: %lu steps in %lu words, decoded %s\n", stats.num_tiles, r.score, r.ref_max_pos,
+                    r.query_max_pos, steps.size(), r.tb.size(), rle_steps.size(), rle.tb.size(),
+                    (rle_steps == steps) ? "equal" : "different");
+        }
+        stats.tb_words += r.tb.size();
+        stats.rle_tb_words += rle.tb.size();
+        stats.rle_readout_cycles += rle.readout_cycles;
+    }
+
+    stats.num_tiles++;
+    stats.load_cycles += r.load_cycles;
+    stats.compute_cycles += r.compute_cycles;
+    stats.readout_cycles += r.readout_cycles;
+    stats.useful_cells += ArrayUsefulCells(tile.gactx, rl, ql, sc.band_size);
+    stats.estimated_cycles += tile.gactx ? GACTXTileCycles(rl, ql) : BSWTileCycles(rl, ql, sc.band_size);
+}
+
+// PE utilization is the useful cells over NUM_PE cells per compute cycle.
+// The analytical estimate of kernel_cost.h is shown only for the array
+// parameters it was written for.
+static void PrintStats (const char* name, const bench_stats& s, bool cost_model) {
+    if (s.num_tiles == 0) {
+        return;
+    }
+    double n = s.num_tiles;
+    uint64_t total = s.load_cycles + s.compute_cycles + s.readout_cycles;
+    printf("%-6s tiles: %lu  cycles per tile: %.0f (load %.0f, compute %.0f, read-out %.0f)  PE utilization: %5.1f%%  "
+            "tiles/s per array: %.0f", name, s.num_tiles, total / n, s.load_cycles / n, s.compute_cycles / n, s.readout_cycles / n,
+            100.0 * s.useful_cells / ((double) ARRAY_NUM_PE * s.compute_cycles), KERNEL_CLOCK_MHZ * 1e6 * n / total);
+    if (cost_model) {
+        printf("  cost model: %.0f (%.2fx)", s.estimated_cycles / n, (double) s.estimated_cycles / total);
+    }
+    if (s.tb_words > 0) {
+        printf("  tb words per tile: %.1f (run-length: %.1f, read-out %.0f cycles)", s.tb_words / n, s.rle_tb_words / n,
+                s.rle_readout_cycles / n);
+    }
+    printf("  mismatches: %lu\n", s.mismatches);
+}
+
+int main (int argc, char** argv) {
+    bool trace = (argc > 2) && (strcmp(argv[1], "trace") == 0);
+    bool vectors = (argc > 2) && (strcmp(argv[1], "vectors") == 0);
+    bool gactx = (argc > 1) && (strcmp(argv[1], "gactx") == 0);
+    int num_tiles = (argc > 2) ? atoi(argv[2]) : (gactx ? 64 : 256);
+    int tile_size = (argc > 3) ? atoi(argv[3]) : 320;
+    long max_tiles = (trace && (argc > 3)) ? atol(argv[3]) : 1000000;
+
+    if ((argc < 2) || (!trace && !vectors && !gactx && strcmp(argv[1], "bsw") != 0) || (max_tiles <= 0) ||
+            (!trace && !vectors && ((num_tiles <= 0) || (tile_size <= 0) || (tile_size > (int) ArrayMaxTileSize(gactx))))) {
+        printf("Usage: %s <bsw|gactx> [num_tiles] [tile_size]\n", argv[0]);
+        printf("       %s trace <tile_trace> [max_tiles]\n", argv[0]);
+        printf("       %s vectors <src/host/GACTX>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ConfigFile cfg_file(vectors ? std::string(argv[2]) + "/params.cfg" : "params.cfg");
+    int sub_mat[11];
+    sub_mat[0]  = cfg_file.Value("Scoring", "sub_AA");
+    sub_mat[1]  = cfg_file.Value("Scoring", "sub_AC");
+    sub_mat[2]  = cfg_file.Value("Scoring", "sub_AG");
+    sub_mat[3]  = cfg_file.Value("Scoring", "sub_AT");
+    sub_mat[4]  = cfg_file.Value("Scoring", "sub_CC");
+    sub_mat[5]  = cfg_file.Value("Scoring", "sub_CG");
+    sub_mat[6]  = cfg_file.Value("Scoring", "sub_CT");
+    sub_mat[7]  = cfg_file.Value("Scoring", "sub_GG");
+    sub_mat[8]  = cfg_file.Value("Scoring", "sub_GT");
+    sub_mat[9]  = cfg_file.Value("Scoring", "sub_TT");
+    sub_mat[10] = cfg_file.Value("Scoring", "sub_N");
+    int gap_open   = cfg_file.Value("Scoring", "gap_open");
+    int gap_extend = cfg_file.Value("Scoring", "gap_extend");
+    int band_size  = vectors ? 0 : (int) cfg_file.Value("BSW_params", "band_size");
+    int ydrop      = cfg_file.Value("GACTX_params", "ydrop");
+
+    cpu_scoring sc;
+    InitCPUScoring(sc, sub_mat, gap_open, gap_extend, band_size, ydrop);
+
+    array_params bsw_params, gactx_params;
+    memcpy(bsw_params.sub_mat, sub_mat, sizeof(sub_mat));
+    bsw_params.gap_open = gap_open;
+    bsw_params.gap_extend = gap_extend;
+    gactx_params = bsw_params;
+    bsw_params.band_or_ydrop = band_size;
+    gactx_params.band_or_ydrop = ydrop;
+
+    std::vector<bench_tile> tiles;
+    if (trace) {
+        if (!ReadTrace(argv[2], max_tiles, tiles)) {
+            return EXIT_FAILURE;
+        }
+    }
+    else if (vectors) {
+        if (!ReadVectors(argv[2], tiles)) {
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        SyntheticTiles(gactx, num_tiles, tile_size, tiles);
+    }
+
+    printf("arrays: NUM_PE %d, BLOCK_WIDTH %d, clock %d MHz, band: %d, ydrop: %d, tiles: %lu\n", ARRAY_NUM_PE,
+            ARRAY_BLOCK_WIDTH, KERNEL_CLOCK_MHZ, band_size, ydrop, tiles.size());
+
+    bench_stats bsw_stats, gactx_stats;
+    memset(&bsw_stats, 0, sizeof(bsw_stats));
+    memset(&gactx_stats, 0, sizeof(gactx_stats));
+
+    struct timeval start_time, end_time;
+    gettimeofday(&start_time, NULL);
+    for (auto& tile: tiles) {
+        if (tile.gactx) {
+            RunTile(tile, gactx_params, sc, vectors, gactx_stats);
+        }
+        else {
+            RunTile(tile, bsw_params, sc, false, bsw_stats);
+        }
+    }
+    gettimeofday(&end_time, NULL);
+
+    PrintStats("bsw", bsw_stats, (ARRAY_NUM_PE == BSW_NUM_PE) && (ARRAY_BLOCK_WIDTH == BSW_BLOCK_WIDTH));
+    PrintStats("gactx", gactx_stats, (ARRAY_NUM_PE == GACTX_NUM_PE) && (ARRAY_BLOCK_WIDTH == GACTX_BLOCK_WIDTH));
+    printf("simulated %lu cycles in %.1f s\n", bsw_stats.load_cycles + bsw_stats.compute_cycles + gactx_stats.load_cycles +
+            gactx_stats.compute_cycles + gactx_stats.readout_cycles, Elapsed(start_time, end_time));
+
+    return ((bsw_stats.mismatches + gactx_stats.mismatches) > 0) ? EXIT_FAILURE : 0;
+}
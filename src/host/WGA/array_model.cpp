@@ -0,0 +1,263 @@
+#include "array_model.h"
+#include "verilated.h"
+#include "VBSW_Array.h"
+#include "VGACTX_Array.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+
+// A tile that has not finished after this many cycles has hung the array
+#define ARRAY_MAX_TILE_CYCLES (1 << 26)
+
+template <typename M>
+struct array_model {
+    std::unique_ptr<VerilatedContext> context;
+    std::unique_ptr<M> top;
+
+    array_model ()
+        : context(new VerilatedContext),
+          top(new M(context.get()))
+    {
+    }
+
+    ~array_model () {
+        top->final();
+    }
+};
+
+// Ports of up to 64 bits are integers, wider ports arrays of 32-bit words
+template <typename T>
+static typename std::enable_if<std::is_integral<T>::value>::type SetBits (T& port, int lsb, int width, uint64_t value) {
+    uint64_t mask = ((1ull << width) - 1) << lsb;
+    port = (T) ((port & ~mask) | ((value << lsb) & mask));
+}
+
+template <typename T>
+static typename std::enable_if<!std::is_integral<T>::value>::type SetBits (T& port, int lsb, int width, uint64_t value) {
+    for (int b = 0; b < width; b++) {
+        uint32_t bit = 1u << ((lsb + b) % 32);
+        if ((value >> b) & 1) {
+            port[(lsb + b) / 32] |= bit;
+        }
+        else {
+            port[(lsb + b) / 32] &= ~bit;
+        }
+    }
+}
+
+template <typename T>
+static typename std::enable_if<std::is_integral<T>::value>::type SetWords (T& port, const uint32_t* words, int num_words) {
+    uint64_t v = 0;
+    for (int w = num_words - 1; w >= 0; w--) {
+        v = (v << 32) | words[w];
+    }
+    port = (T) v;
+}
+
+template <typename T>
+static typename std::enable_if<!std::is_integral<T>::value>::type SetWords (T& port, const uint32_t* words, int num_words) {
+    for (int w = 0; w < num_words; w++) {
+        port[w] = words[w];
+    }
+}
+
+static int SignExtend (uint32_t value, int width) {
+    return ((int32_t) (value << (32 - width))) >> (32 - width);
+}
+
+template <typename M>
+static void Tick (M* m) {
+    m->clk = 0;
+    m->eval();
+    m->clk = 1;
+    m->eval();
+}
+
+// Fields of in_params, most significant first: sub_AA ... sub_TT, sub_N,
+// gap_open, gap_extend, as assigned in the kernel controls
+template <typename T>
+static void SetScoring (T& port, int pe_width, const array_params& params) {
+    for (int i = 0; i < 11; i++) {
+        SetBits(port, (12 - i) * pe_width, pe_width, (uint32_t) params.sub_mat[i]);
+    }
+    SetBits(port, pe_width, pe_width, (uint32_t) params.gap_open);
+    SetBits(port, 0, pe_width, (uint32_t) params.gap_extend);
+}
+
+// Writes a sequence into a tile BRAM, one word of 2^BLOCK_WIDTH characters
+// per cycle starting at address 1 (the array writes at addr - 1), padding the
+// last word with N. Returns the cycles taken.
+template <typename M, typename E, typename A, typename D>
+static uint64_t WriteBRAM (M* m, E& wr_en, A& addr, D& data, int addr_width, const char* seq, size_t len) {
+    const int chars = 1 << ARRAY_BLOCK_WIDTH;
+    uint32_t words[(chars + 3) / 4];
+    uint64_t num_words = (len + chars - 1) / chars;
+
+    wr_en = 1;
+    for (uint64_t w = 0; w < num_words; w++) {
+        std::fill(words, words + (chars + 3) / 4, 0);
+        for (int c = 0; c < chars; c++) {
+            size_t i = w * chars + c;
+            uint32_t ch = (i < len) ? (uint8_t) seq[i] : 'N';
+            words[c / 4] |= ch << (8 * (c % 4));
+        }
+        SetWords(data, words, (chars + 3) / 4);
+        addr = (w + 1) & ((1ull << addr_width) - 1);
+        Tick(m);
+    }
+    wr_en = 0;
+    return num_words;
+}
+
+template <typename M>
+static uint64_t WaitDone (M* m, const char* name) {
+    uint64_t cycles = 0;
+    while (!m->done) {
+        Tick(m);
+        if (++cycles > ARRAY_MAX_TILE_CYCLES) {
+            fprintf(stderr, "Error: %s did not finish a tile in %d cycles!\n", name, ARRAY_MAX_TILE_CYCLES);
+            fprintf(stderr, "Test failed\n");
+            exit(1);
+        }
+    }
+    return cycles;
+}
+
+size_t ArrayMaxTileSize (bool gactx) {
+    return (1 << (gactx ? ARRAY_GACTX_LOG_MAX_TILE_SIZE : ARRAY_BSW_LOG_MAX_TILE_SIZE)) - 1;
+}
+
+void BSWArrayTile (const array_params& params, uint8_t align_fields, const char* ref, size_t ref_len,
+        const char* query, size_t query_len, array_tile_result& result) {
+    static thread_local std::unique_ptr<array_model<VBSW_Array> > model;
+    if (!model) {
+        model.reset(new array_model<VBSW_Array>);
+    }
+    VBSW_Array* m = model->top.get();
+    const int addr_width = ARRAY_BSW_LOG_MAX_TILE_SIZE - ARRAY_BLOCK_WIDTH;
+
+    ref_len = std::min(ref_len, ArrayMaxTileSize(false));
+    query_len = std::min(query_len, ArrayMaxTileSize(false));
+
+    // reset the array and latch the scoring parameters, as BSW_KernelControl
+    // does before each tile
+    m->start = 0;
+    m->clear_done = 0;
+    m->ref_wr_en = 0;
+    m->query_wr_en = 0;
+    m->rst = 1;
+    Tick(m);
+    m->rst = 0;
+    SetScoring(m->in_params, ARRAY_BSW_PE_WIDTH, params);
+    m->band_size = params.band_or_ydrop & ((1 << ARRAY_BSW_LOG_MAX_TILE_SIZE) - 1);
+    m->set_param = 1;
+    Tick(m);
+    m->set_param = 0;
+    result.load_cycles = 2;
+
+    result.load_cycles += WriteBRAM(m, m->ref_wr_en, m->ref_addr, m->ref_in, addr_width, ref, ref_len);
+    result.load_cycles += WriteBRAM(m, m->query_wr_en, m->query_addr, m->query_in, addr_width, query, query_len);
+
+    m->align_fields = align_fields;
+    m->tile_id = 0;
+    m->array_id = 0;
+    m->ref_len = ref_len;
+    m->query_len = query_len;
+    m->start = 1;
+    Tick(m);
+    m->start = 0;
+    result.compute_cycles = 1 + WaitDone(m, "BSW_Array");
+
+    // tile_output is latched on the edge after done, on which the kernel
+    // control also clears done
+    m->clear_done = 1;
+    Tick(m);
+    m->clear_done = 0;
+    result.compute_cycles++;
+
+    // tile_output: {query_len, ref_len, query_max_pos, ref_max_pos, score,
+    // array_id, tile_id}, 32 bits each from the LSB
+    result.score = m->tile_output[2] & ((1 << ARRAY_BSW_PE_WIDTH) - 1);
+    result.ref_max_pos = m->tile_output[3];
+    result.query_max_pos = m->tile_output[4];
+    result.tb.clear();
+    result.readout_cycles = 0;
+}
+
+void GACTXArrayTile (const array_params& params, uint8_t align_fields, const char* ref, size_t ref_len,
+        const char* query, size_t query_len, array_tile_result& result) {
+    static thread_local std::unique_ptr<array_model<VGACTX_Array> > model;
+    if (!model) {
+        model.reset(new array_model<VGACTX_Array>);
+    }
+    VGACTX_Array* m = model->top.get();
+    const int addr_width = ARRAY_GACTX_LOG_MAX_TILE_SIZE - ARRAY_BLOCK_WIDTH;
+
+    ref_len = std::min(ref_len, ArrayMaxTileSize(true));
+    query_len = std::min(query_len, ArrayMaxTileSize(true));
+
+    m->start = 0;
+    m->clear_done = 0;
+    m->ref_wr_en = 0;
+    m->query_wr_en = 0;
+    m->dir_rd_addr = 0;
+    // not connected in GACTX_ArrayWrapper
+    m->max_tb_steps = 0;
+    m->rst = 1;
+    Tick(m);
+    m->rst = 0;
+    SetScoring(m->in_params, ARRAY_GACTX_PE_WIDTH, params);
+    m->y_in = params.band_or_ydrop & ((1 << ARRAY_GACTX_PE_WIDTH) - 1);
+    m->set_params = 1;
+    Tick(m);
+    m->set_params = 0;
+    result.load_cycles = 2;
+
+    result.load_cycles += WriteBRAM(m, m->ref_wr_en, m->ref_addr_in, m->ref_in, addr_width, ref, ref_len);
+    result.load_cycles += WriteBRAM(m, m->query_wr_en, m->query_addr_in, m->query_in, addr_width, query, query_len);
+
+    m->align_fields = align_fields;
+    m->ref_len = ref_len;
+    m->query_len = query_len;
+    m->start = 1;
+    Tick(m);
+    m->start = 0;
+    result.compute_cycles = 1 + WaitDone(m, "GACTX_Array");
+
+    result.score = SignExtend(m->tile_score, ARRAY_GACTX_PE_WIDTH);
+    result.ref_max_pos = m->ref_max_pos;
+    result.query_max_pos = m->query_max_pos;
+
+    // one direction word of 2*NUM_DIR_BLOCK bits per read, one cycle after
+    // its address
+    const int words_per_dir = 2 * ARRAY_GACTX_NUM_DIR_BLOCK / 32;
+    uint32_t num_dir = m->dir_total_count;
+    result.tb.resize(num_dir * words_per_dir);
+    for (uint32_t d = 0; d < num_dir; d++) {
+        m->dir_rd_addr = d;
+        Tick(m);
+        for (int w = 0; w < words_per_dir; w++) {
+            result.tb[d * words_per_dir + w] = m->dir_data_out[w];
+        }
+    }
+    result.readout_cycles = 3 * num_dir;
+
+    m->clear_done = 1;
+    Tick(m);
+    m->clear_done = 0;
+}
+
+uint64_t ArrayUsefulCells (bool gactx, size_t ref_len, size_t query_len, int band_size) {
+    if (gactx) {
+        return (uint64_t) ref_len * query_len;
+    }
+    uint64_t cells = 0;
+    for (size_t q = 0; q < query_len; q++) {
+        size_t lo = (q > (size_t) band_size) ? q - band_size : 0;
+        size_t hi = std::min(ref_len, q + band_size + 1);
+        cells += (hi > lo) ? hi - lo : 0;
+    }
+    return cells;
+}
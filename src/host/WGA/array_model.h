@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Cycle-level models of BSW_Array and GACTX_Array (BSW_ArrayTop and
+// GACTX_ArrayTop with their sequence BRAMs), compiled from the HDL with
+// Verilator. NUM_PE and BLOCK_WIDTH are fixed when the models are verilated
+// (ARRAY_NUM_PE and ARRAY_BLOCK_WIDTH in CMakeLists.txt); the other
+// parameters are those of BSW_KernelControl.sv and GACTX_KernelControl.sv.
+//
+// Each tile is driven with the sequence transcribed from the kernel
+// controls: reset the array, set the scoring parameters, write the reference
+// and query into the BRAMs one 2^BLOCK_WIDTH character word per cycle, start
+// the array, wait for done and, for GACT-X, read the traceback back out of
+// the direction BRAM. The kernel controls themselves are not part of the
+// models (bsw_kernel_bench runs the whole BSW kernel), and no result is
+// assumed to match the CPU engines: the callers compare and count. Sequences
+// are ASCII and are reversed and complemented by the array as requested by
+// the align_fields bits. The models are per thread, so any number of threads
+// can run tiles at the same time.
+
+#ifndef ARRAY_NUM_PE
+#define ARRAY_NUM_PE 32
+#endif
+#ifndef ARRAY_BLOCK_WIDTH
+#define ARRAY_BLOCK_WIDTH 3
+#endif
+
+#define ARRAY_BSW_PE_WIDTH 16
+#define ARRAY_BSW_LOG_MAX_TILE_SIZE 9
+#define ARRAY_GACTX_PE_WIDTH 21
+#define ARRAY_GACTX_LOG_MAX_TILE_SIZE 11
+#define ARRAY_GACTX_NUM_DIR_BLOCK 256
+#define ARRAY_GACTX_DIR_BRAM_ADDR_WIDTH 8
+
+struct array_params {
+    int sub_mat[11];
+    int gap_open;
+    int gap_extend;
+    // band_size for BSW, ydrop for GACT-X
+    int band_or_ydrop;
+};
+
+struct array_tile_result {
+    int score;
+    int ref_max_pos;
+    int query_max_pos;
+    // GACT-X only: traceback words in the format of the GACT-X kernel
+    std::vector<uint32_t> tb;
+
+    // reset, parameters and BRAM writes
+    uint64_t load_cycles;
+    // start to done
+    uint64_t compute_cycles;
+    // GACT-X traceback read-out, three cycles per direction word as in
+    // GACTX_ArrayWrapper
+    uint64_t readout_cycles;
+};
+
+// Longest sequence the length ports of the array can hold; longer
+// sequences are truncated.
+size_t ArrayMaxTileSize (bool gactx);
+
+void BSWArrayTile (const array_params& params, uint8_t align_fields, const char* ref, size_t ref_len,
+        const char* query, size_t query_len, array_tile_result& result);
+
+void GACTXArrayTile (const array_params& params, uint8_t align_fields, const char* ref, size_t ref_len,
+        const char* query, size_t query_len, array_tile_result& result);
+
+// Cells of the tile inside the band that BSW_ArrayTop computes; for GACT-X
+// the whole tile, of which ydrop leaves only part to be computed.
+uint64_t ArrayUsefulCells (bool gactx, size_t ref_len, size_t query_len, int band_size);
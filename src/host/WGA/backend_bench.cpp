@@ -0,0 +1,206 @@
+// Agreement of the fpga and hybrid processor backends with the cpu backend on
+// the simulated device of sim_device.cpp (WITH_SIM_DEVICE), including after
+// switching to queries that regrow the query slots, and of the tile windows
+// the BSW kernels derive from raw seed hits with the host's HitTile(). The
+// reference is
+// two synthetic chromosomes and the query is the reference with ~10%
+// substitutions; filter tiles are centred on random seed hits, two thirds of
+// them on the diagonal.
+//
+// Usage: backend_bench <sim.xclbin> [num_hits]
+// Scoring and the BSW and GACT-X parameters are read from params.cfg.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "ConfigFile.h"
+#include "DRAM.h"
+#include "Processor.h"
+#include "graph.h"
+
+Configuration cfg;
+SeedPosTable *sa;
+std::vector<std::string> r_chr_id;
+std::vector<uint32_t> r_chr_len;
+std::vector<uint32_t> r_chr_len_unpadded;
+std::vector<ref_coord_t> r_chr_coord;
+FILE *mafFile;
+
+#define REF_LEN (1 << 20)
+
+static bool CompareBatchId (const tile_output& o1, const tile_output& o2) {
+    return (o1.batch_id < o2.batch_id);
+}
+
+// Outputs that differ from the reference outputs, after ordering both by
+// batch_id; a missing or extra output counts once
+static int CountMismatches (std::vector<tile_output> op, std::vector<tile_output> ref_op) {
+    std::sort(op.begin(), op.end(), CompareBatchId);
+    std::sort(ref_op.begin(), ref_op.end(), CompareBatchId);
+    int mismatches = std::max(op.size(), ref_op.size()) - std::min(op.size(), ref_op.size());
+    for (size_t i = 0; i < std::min(op.size(), ref_op.size()); i++) {
+        if ((op[i].batch_id != ref_op[i].batch_id) || (op[i].tile_score != ref_op[i].tile_score) ||
+                (op[i].max_ref_offset != ref_op[i].max_ref_offset) || (op[i].max_query_offset != ref_op[i].max_query_offset)) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+static int FilterBench (const std::vector<filter_tile>& tiles, const std::vector<tile_output>& cpu_op) {
+    std::vector<tile_output> op = fpga_backend.send_batch_request(tiles, 0, cfg.first_tile_score_threshold);
+    int mismatches = CountMismatches(op, cpu_op);
+    printf("fpga     tiles: %6zu  outputs: %6zu  mismatches: %d\n", tiles.size(), op.size(), mismatches);
+    return (mismatches > 0);
+}
+
+// The hybrid split with the device share empty, halved and whole. The device
+// has to take work in every case.
+static int HybridBench (const std::vector<filter_tile>& tiles, const std::vector<tile_output>& cpu_op) {
+    int ret = 0;
+    size_t shares[3] = {0, tiles.size() / 2, tiles.size()};
+    for (size_t share: shares) {
+        size_t fpga_tiles = 0;
+        std::vector<tile_output> op = HybridSplitBatch(tiles, share, 0, cfg.first_tile_score_threshold, fpga_tiles);
+        int mismatches = CountMismatches(op, cpu_op);
+        printf("hybrid   fpga share: %6zu  fpga tiles: %6zu  outputs: %6zu  mismatches: %d\n", share, fpga_tiles, op.size(), mismatches);
+        if ((mismatches > 0) || (fpga_tiles == 0)) {
+            ret = 1;
+        }
+    }
+    return ret;
+}
+
+// Queries of growing length, so that each query slot gets a new device buffer
+// while the kernels keep their cached query argument. The kernels have to
+// read the active slot after every switch.
+static int QueryBench (const std::vector<seed_hit>& hits) {
+    int ret = 0;
+    size_t query_lens[4] = {REF_LEN / 8, REF_LEN / 4, REF_LEN / 2, REF_LEN};
+    for (size_t query_len: query_lens) {
+        hybrid_backend.send_query_write_request(REF_LEN, query_len);
+        std::vector<filter_tile> tiles;
+        for (auto h: hits) {
+            if (h.query_offset < query_len - 1) {
+                tiles.push_back(HitTile(h, query_len, cfg.first_tile_size, false));
+            }
+        }
+        std::vector<tile_output> cpu_op = cpu_backend.send_batch_request(tiles, 0, cfg.first_tile_score_threshold);
+        std::vector<tile_output> op = fpga_backend.send_batch_request(tiles, 0, cfg.first_tile_score_threshold);
+        int mismatches = CountMismatches(op, cpu_op);
+        printf("query    length: %7zu  outputs: %6zu  mismatches: %d\n", query_len, op.size(), mismatches);
+        ret |= (mismatches > 0);
+    }
+    return ret;
+}
+
+// Hit batches, with the windows computed by the kernels from the chromosome
+// end table, against the cpu backend on the HitTile() windows of the same
+// hits. Half the hits are within a tile of a chromosome end and tile batches
+// are run in between, on the same slots, so the table must survive them.
+static int HitBench (const std::vector<seed_hit>& hits, const std::vector<filter_tile>& tiles) {
+    int ret = 0;
+    uint8_t align_fields[2] = {0, reverse_query | complement_query};
+    for (int round = 0; round < 4; round++) {
+        uint8_t af = align_fields[round % 2];
+        std::vector<filter_tile> hit_tiles;
+        for (auto h: hits) {
+            hit_tiles.push_back(HitTile(h, REF_LEN, cfg.first_tile_size, (af & reverse_query)));
+        }
+        std::vector<tile_output> cpu_op = cpu_backend.send_batch_request(hit_tiles, af, cfg.first_tile_score_threshold);
+        std::vector<tile_output> op = fpga_backend.send_hit_batch_request(hits, REF_LEN, af, cfg.first_tile_score_threshold);
+        int mismatches = CountMismatches(op, cpu_op);
+        printf("hit      align fields: %d  outputs: %6zu  mismatches: %d\n", af, op.size(), mismatches);
+        ret |= (mismatches > 0);
+        fpga_backend.send_batch_request(tiles, 0, cfg.first_tile_score_threshold);
+    }
+    return ret;
+}
+
+int main (int argc, char** argv) {
+    if (argc < 2) {
+        printf("Usage: %s <sim.xclbin> [num_hits]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int num_hits = (argc > 2) ? atoi(argv[2]) : 10000;
+
+    ConfigFile cfg_file("params.cfg");
+    cfg.gact_sub_mat[0] = cfg_file.Value("Scoring", "sub_AA");
+    cfg.gact_sub_mat[1] = cfg_file.Value("Scoring", "sub_AC");
+    cfg.gact_sub_mat[2] = cfg_file.Value("Scoring", "sub_AG");
+    cfg.gact_sub_mat[3] = cfg_file.Value("Scoring", "sub_AT");
+    cfg.gact_sub_mat[4] = cfg_file.Value("Scoring", "sub_CC");
+    cfg.gact_sub_mat[5] = cfg_file.Value("Scoring", "sub_CG");
+    cfg.gact_sub_mat[6] = cfg_file.Value("Scoring", "sub_CT");
+    cfg.gact_sub_mat[7] = cfg_file.Value("Scoring", "sub_GG");
+    cfg.gact_sub_mat[8] = cfg_file.Value("Scoring", "sub_GT");
+    cfg.gact_sub_mat[9] = cfg_file.Value("Scoring", "sub_TT");
+    cfg.gact_sub_mat[10] = cfg_file.Value("Scoring", "sub_N");
+    cfg.gap_open = cfg_file.Value("Scoring", "gap_open");
+    cfg.gap_extend = cfg_file.Value("Scoring", "gap_extend");
+    cfg.first_tile_size = cfg_file.Value("BSW_params", "first_tile_size");
+    cfg.first_tile_score_threshold = cfg_file.Value("BSW_params", "first_tile_score_threshold");
+    cfg.band_size = cfg_file.Value("BSW_params", "band_size");
+    cfg.ydrop = cfg_file.Value("GACTX_params", "ydrop");
+    cfg.tb_rle = (double) cfg_file.Value("GACTX_params", "tb_rle", 0.0) != 0;
+    cfg.packed_seq = false;
+    cfg.hit_tiles = true;
+    cfg.num_devices = 0;
+
+    g_DRAM = new DRAM;
+    const char* bases = "ACGT";
+    for (size_t i = 0; i < REF_LEN; i++) {
+        g_DRAM->buffer[i] = bases[rand() % 4];
+    }
+    for (size_t i = 0; i < REF_LEN; i++) {
+        g_DRAM->buffer[REF_LEN + i] = (rand() % 10 == 0) ? bases[rand() % 4] : g_DRAM->buffer[i];
+    }
+    g_DRAM->referenceSize = REF_LEN;
+
+    r_chr_coord = {0, REF_LEN / 2};
+    r_chr_len = {REF_LEN / 2, REF_LEN / 2};
+    BuildChrEndTable(r_chr_coord, r_chr_len);
+
+    hybrid_backend.initialize(1, 1, argv[1]);
+    hybrid_backend.send_ref_write_request(0, REF_LEN);
+    hybrid_backend.send_query_write_request(REF_LEN, REF_LEN);
+
+    std::vector<seed_hit> hits;
+    for (int i = 0; i < num_hits; i++) {
+        seed_hit h;
+        h.reference_offset = rand() % (REF_LEN - 1);
+        h.query_offset = (i % 3) ? h.reference_offset : rand() % (REF_LEN - 1);
+        hits.push_back(h);
+    }
+    std::vector<filter_tile> tiles;
+    for (auto h: hits) {
+        tiles.push_back(HitTile(h, REF_LEN, cfg.first_tile_size, false));
+    }
+
+    std::vector<tile_output> cpu_op = cpu_backend.send_batch_request(tiles, 0, cfg.first_tile_score_threshold);
+
+    int ret = 0;
+    ret |= FilterBench(tiles, cpu_op);
+    ret |= HybridBench(tiles, cpu_op);
+    ret |= QueryBench(hits);
+
+    hybrid_backend.send_query_write_request(REF_LEN, REF_LEN);
+
+    std::vector<seed_hit> end_hits;
+    for (int i = 0; i < num_hits; i++) {
+        seed_hit h;
+        uint32_t chr_end = (i % 2) ? REF_LEN / 2 : REF_LEN;
+        h.reference_offset = (i % 4 < 2) ? rand() % (REF_LEN - 1) : chr_end - 1 - rand() % cfg.first_tile_size;
+        h.query_offset = (i % 3) ? h.reference_offset : rand() % (REF_LEN - 1);
+        end_hits.push_back(h);
+    }
+    ret |= HitBench(end_hits, tiles);
+
+    hybrid_backend.shutdown();
+    delete g_DRAM;
+
+    printf("%s\n", (ret == 0) ? "backends agree" : "backends differ");
+    return ret;
+}
@@ -0,0 +1,560 @@
+// The verilated BSW kernel (BSW_Kernel.sv with BSW_KernelControl.sv and its
+// AXI masters) run on a flat memory model behind its four AXI ports.
+//
+// results: the tiles of src/host/BSW (ref.txt, query.txt, parameters.txt)
+// are run as the BSW test host does, once with no score threshold, where
+// the records must match results.txt exactly, and once with a threshold
+// between the scores of results.txt, where the header count and the packing
+// of the passing records into the result stream are checked.
+//
+// hits: hit batches, with the tile windows derived by the kernel from the chromosome
+// end table, are checked against tile batches of the same hits expanded on
+// the host with HitTile(). Half the hits are within a tile of a chromosome
+// end, and the hit batches alternate with tile batches on the same chromosome
+// end table.
+//
+// Usage: bsw_kernel_bench results <src/host/BSW> [score_threshold]
+//        bsw_kernel_bench hits [num_hits]
+// Scoring and band size are read from params.cfg in the test directory
+// (results) or the working directory (hits), the tile size from the latter.
+// The kernel is slow to simulate; a few hundred hits take minutes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <climits>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ConfigFile.h"
+#include "DRAM.h"
+#include "Processor.h"
+#include "graph.h"
+#include "verilated.h"
+#include "VBSW_Kernel.h"
+
+Configuration cfg;
+SeedPosTable *sa;
+std::vector<std::string> r_chr_id;
+std::vector<uint32_t> r_chr_len;
+std::vector<uint32_t> r_chr_len_unpadded;
+std::vector<ref_coord_t> r_chr_coord;
+FILE *mafFile;
+
+#define REF_LEN (1 << 16)
+#define AXI_BEAT_BYTES 64
+#define AXI_MAX_BURSTS 16
+// A batch that has not finished after this many cycles has hung the kernel
+#define KERNEL_MAX_CYCLES (1 << 28)
+
+// Output layout and chromosome table padding, as in Processor.cpp
+#define BSW_OUT_HEADER_INTS 16
+#define BSW_CHR_ENDS_PER_BEAT 16
+
+struct axi_burst {
+    uint64_t addr;
+    int len;
+    int beat;
+};
+
+// Signals of one AXI4 master port of the kernel and the bursts it has
+// issued on it
+struct axi_port {
+    CData* arvalid;
+    CData* arready;
+    QData* araddr;
+    CData* arlen;
+    CData* rvalid;
+    CData* rready;
+    EData* rdata;
+    CData* rlast;
+    CData* awvalid;
+    CData* awready;
+    QData* awaddr;
+    CData* awlen;
+    CData* wvalid;
+    CData* wready;
+    EData* wdata;
+    QData* wstrb;
+    CData* wlast;
+    CData* bvalid;
+    CData* bready;
+    std::deque<axi_burst> reads;
+    std::deque<axi_burst> writes;
+    int num_responses;
+};
+
+#define BIND_AXI(p, top, m) \
+    p.arvalid = &top->m##_axi_arvalid; p.arready = &top->m##_axi_arready; \
+    p.araddr = &top->m##_axi_araddr; p.arlen = &top->m##_axi_arlen; \
+    p.rvalid = &top->m##_axi_rvalid; p.rready = &top->m##_axi_rready; \
+    p.rdata = &top->m##_axi_rdata[0]; p.rlast = &top->m##_axi_rlast; \
+    p.awvalid = &top->m##_axi_awvalid; p.awready = &top->m##_axi_awready; \
+    p.awaddr = &top->m##_axi_awaddr; p.awlen = &top->m##_axi_awlen; \
+    p.wvalid = &top->m##_axi_wvalid; p.wready = &top->m##_axi_wready; \
+    p.wdata = &top->m##_axi_wdata[0]; p.wstrb = &top->m##_axi_wstrb; p.wlast = &top->m##_axi_wlast; \
+    p.bvalid = &top->m##_axi_bvalid; p.bready = &top->m##_axi_bready;
+
+struct bsw_kernel {
+    std::unique_ptr<VerilatedContext> context;
+    std::unique_ptr<VBSW_Kernel> top;
+    axi_port ports[4];
+    // device memory, with buffers placed 4 KB apart from address 4096
+    std::vector<uint8_t> mem;
+    uint64_t cycles;
+
+    bsw_kernel ()
+        : context(new VerilatedContext),
+          top(new VBSW_Kernel(context.get())),
+          mem(4096),
+          cycles(0)
+    {
+        BIND_AXI(ports[0], top, m00);
+        BIND_AXI(ports[1], top, m01);
+        BIND_AXI(ports[2], top, m02);
+        BIND_AXI(ports[3], top, m03);
+        for (auto& p: ports) {
+            p.num_responses = 0;
+        }
+    }
+
+    ~bsw_kernel () {
+        top->final();
+    }
+
+    uint64_t Alloc (const void* data, size_t bytes) {
+        uint64_t addr = mem.size();
+        mem.resize(addr + (bytes + 4095) / 4096 * 4096 + 4096, 0);
+        if (data != NULL) {
+            memcpy(mem.data() + addr, data, bytes);
+        }
+        return addr;
+    }
+
+    uint8_t* Beat (uint64_t addr, const char* what) {
+        addr &= ~(uint64_t) (AXI_BEAT_BYTES - 1);
+        if (addr + AXI_BEAT_BYTES > mem.size()) {
+            fprintf(stderr, "Error: kernel %s at 0x%lx outside device memory!\n", what, addr);
+            fprintf(stderr, "Test failed\n");
+            exit(1);
+        }
+        return mem.data() + addr;
+    }
+
+    // Handshakes are sampled before the rising edge and the memory model
+    // answers them after it
+    void Tick () {
+        bool ar[4], r[4], aw[4], w[4], b[4];
+        uint32_t wdata[4][AXI_BEAT_BYTES/4];
+        uint64_t wstrb[4];
+
+        top->aclk = 0;
+        top->eval();
+        for (int i = 0; i < 4; i++) {
+            axi_port& p = ports[i];
+            ar[i] = *p.arvalid && *p.arready;
+            r[i] = *p.rvalid && *p.rready;
+            aw[i] = *p.awvalid && *p.awready;
+            w[i] = *p.wvalid && *p.wready;
+            b[i] = *p.bvalid && *p.bready;
+            if (ar[i]) {
+                p.reads.push_back({*p.araddr, *p.arlen, 0});
+            }
+            if (aw[i]) {
+                p.writes.push_back({*p.awaddr, *p.awlen, 0});
+            }
+            if (w[i]) {
+                memcpy(wdata[i], p.wdata, AXI_BEAT_BYTES);
+                wstrb[i] = *p.wstrb;
+            }
+        }
+        top->aclk = 1;
+        top->eval();
+        cycles++;
+
+        for (int i = 0; i < 4; i++) {
+            axi_port& p = ports[i];
+            if (r[i]) {
+                if (++p.reads.front().beat > p.reads.front().len) {
+                    p.reads.pop_front();
+                }
+            }
+            if (w[i]) {
+                axi_burst& burst = p.writes.front();
+                uint8_t* dst = Beat(burst.addr + (uint64_t) burst.beat * AXI_BEAT_BYTES, "writes");
+                const uint8_t* src = (const uint8_t*) wdata[i];
+                for (int k = 0; k < AXI_BEAT_BYTES; k++) {
+                    if ((wstrb[i] >> k) & 1) {
+                        dst[k] = src[k];
+                    }
+                }
+                if (++burst.beat > burst.len) {
+                    p.writes.pop_front();
+                    p.num_responses++;
+                }
+            }
+            if (b[i]) {
+                p.num_responses--;
+            }
+
+            *p.arready = (p.reads.size() < AXI_MAX_BURSTS);
+            *p.rvalid = !p.reads.empty();
+            if (*p.rvalid) {
+                axi_burst& burst = p.reads.front();
+                memcpy(p.rdata, Beat(burst.addr + (uint64_t) burst.beat * AXI_BEAT_BYTES, "reads"), AXI_BEAT_BYTES);
+                *p.rlast = (burst.beat == burst.len);
+            }
+            else {
+                *p.rlast = 0;
+            }
+            *p.awready = (p.writes.size() < AXI_MAX_BURSTS);
+            *p.wready = !p.writes.empty();
+            *p.bvalid = (p.num_responses > 0);
+        }
+    }
+
+    void Reset () {
+        top->areset = 1;
+        top->ap_start = 0;
+        for (int i = 0; i < 16; i++) {
+            Tick();
+        }
+        top->areset = 0;
+        Tick();
+    }
+};
+
+// One launch of the kernel: the batch buffers and the arguments that are
+// not scoring
+struct kernel_batch {
+    uint32_t batch_size;
+    uint8_t align_fields;
+    std::vector<int> batch_id;
+    std::vector<int> batch_params;
+    int thresh;
+    uint32_t tile_window;
+    uint32_t query_length;
+    uint32_t num_chrs;
+};
+
+// Runs a batch on the kernel and returns the records of its result stream;
+// num_passed is the count in the header beat
+static std::vector<tile_output> RunKernel (bsw_kernel& k, uint64_t ref_addr, uint64_t query_addr, uint64_t chr_ends_addr,
+        const kernel_batch& batch, int& num_passed) {
+    VBSW_Kernel* top = k.top.get();
+    size_t out_ints = BSW_OUT_HEADER_INTS + 4 * batch.batch_size;
+    std::vector<int> out(out_ints, 0x55555555);
+
+    top->sub_AA = cfg.gact_sub_mat[0];
+    top->sub_AC = cfg.gact_sub_mat[1];
+    top->sub_AG = cfg.gact_sub_mat[2];
+    top->sub_AT = cfg.gact_sub_mat[3];
+    top->sub_CC = cfg.gact_sub_mat[4];
+    top->sub_CG = cfg.gact_sub_mat[5];
+    top->sub_CT = cfg.gact_sub_mat[6];
+    top->sub_GG = cfg.gact_sub_mat[7];
+    top->sub_GT = cfg.gact_sub_mat[8];
+    top->sub_TT = cfg.gact_sub_mat[9];
+    top->sub_N = cfg.gact_sub_mat[10];
+    top->gap_open = cfg.gap_open;
+    top->gap_extend = cfg.gap_extend;
+    top->band_size = cfg.band_size;
+    top->batch_size = batch.batch_size;
+    top->batch_align_fields = batch.align_fields;
+    top->ref_seq = ref_addr;
+    top->query_seq = query_addr;
+    top->batch_id = k.Alloc(batch.batch_id.data(), sizeof(int) * batch.batch_id.size());
+    top->batch_params = k.Alloc(batch.batch_params.data(), sizeof(int) * batch.batch_params.size());
+    uint64_t out_addr = k.Alloc(out.data(), sizeof(int) * out_ints);
+    top->batch_tile_output = out_addr;
+    top->score_threshold = batch.thresh;
+    top->tile_window = batch.tile_window;
+    top->query_length = batch.query_length;
+    top->num_chrs = batch.num_chrs;
+    top->chr_ends = chr_ends_addr;
+
+    top->ap_start = 1;
+    uint64_t start = k.cycles;
+    while (!top->ap_done) {
+        k.Tick();
+        if (k.cycles - start > KERNEL_MAX_CYCLES) {
+            fprintf(stderr, "Error: BSW kernel did not finish a batch of %u tiles!\n", batch.batch_size);
+            fprintf(stderr, "Test failed\n");
+            exit(1);
+        }
+    }
+    top->ap_start = 0;
+    k.Tick();
+
+    memcpy(out.data(), k.mem.data() + out_addr, sizeof(int) * out_ints);
+    num_passed = out[0];
+    std::vector<tile_output> op;
+    for (int i = 0; (i < num_passed) && (i < (int) batch.batch_size); i++) {
+        int* rec = out.data() + BSW_OUT_HEADER_INTS + 4*i;
+        op.push_back(tile_output(rec[0], rec[1], rec[2], rec[3]));
+    }
+    return op;
+}
+
+static bool CompareBatchId (const tile_output& o1, const tile_output& o2) {
+    return (o1.batch_id < o2.batch_id);
+}
+
+// Outputs that differ from the reference outputs, after ordering both by
+// batch_id; a missing or extra output counts once
+static int CountMismatches (std::vector<tile_output> op, std::vector<tile_output> ref_op) {
+    std::sort(op.begin(), op.end(), CompareBatchId);
+    std::sort(ref_op.begin(), ref_op.end(), CompareBatchId);
+    int mismatches = std::max(op.size(), ref_op.size()) - std::min(op.size(), ref_op.size());
+    for (size_t i = 0; i < std::min(op.size(), ref_op.size()); i++) {
+        if ((op[i].batch_id != ref_op[i].batch_id) || (op[i].tile_score != ref_op[i].tile_score) ||
+                (op[i].max_ref_offset != ref_op[i].max_ref_offset) || (op[i].max_query_offset != ref_op[i].max_query_offset)) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// Batches are padded to whole beats of 16 tiles with copies of the last
+// tile, as in RunBSWBatch
+static kernel_batch TileBatch (const std::vector<filter_tile>& tiles, uint8_t align_fields, int thresh) {
+    kernel_batch batch;
+    batch.batch_size = (tiles.size() + 15) / 16 * 16;
+    batch.align_fields = align_fields;
+    for (uint32_t b = 0; b < batch.batch_size; b++) {
+        const filter_tile& t = tiles[std::min((size_t) b, tiles.size() - 1)];
+        batch.batch_id.insert(batch.batch_id.end(), {(int) b, 0, 0, 0});
+        batch.batch_params.insert(batch.batch_params.end(), {(int) t.ref_offset, (int) t.query_offset, (int) t.ref_length, (int) t.query_length});
+    }
+    batch.thresh = thresh;
+    batch.tile_window = 0;
+    batch.query_length = 0;
+    batch.num_chrs = 0;
+    return batch;
+}
+
+static kernel_batch HitBatch (const std::vector<seed_hit>& hits, uint8_t align_fields, int thresh) {
+    kernel_batch batch;
+    batch.batch_size = (hits.size() + 15) / 16 * 16;
+    batch.align_fields = align_fields;
+    for (uint32_t b = 0; b < batch.batch_size; b++) {
+        const seed_hit& h = hits[std::min((size_t) b, hits.size() - 1)];
+        batch.batch_id.insert(batch.batch_id.end(), {0, 0, 0, 0});
+        batch.batch_params.insert(batch.batch_params.end(), {(int) h.reference_offset, (int) h.query_offset, 0, 0});
+    }
+    batch.thresh = thresh;
+    batch.tile_window = cfg.first_tile_size;
+    batch.query_length = REF_LEN;
+    batch.num_chrs = g_chr_ends.size();
+    return batch;
+}
+
+static int HitBench (int num_hits) {
+    std::vector<char> ref(REF_LEN), query(REF_LEN);
+    const char* bases = "ACGT";
+    for (size_t i = 0; i < REF_LEN; i++) {
+        ref[i] = bases[rand() % 4];
+        query[i] = (rand() % 10 == 0) ? bases[rand() % 4] : ref[i];
+    }
+
+    // three chromosomes of unequal length
+    r_chr_coord = {0, REF_LEN / 4, REF_LEN / 2 + REF_LEN / 8};
+    r_chr_len = {REF_LEN / 4, REF_LEN / 4 + REF_LEN / 8, REF_LEN - (REF_LEN / 2 + REF_LEN / 8)};
+    BuildChrEndTable(r_chr_coord, r_chr_len);
+    std::vector<uint32_t> chr_table(g_chr_ends.begin(), g_chr_ends.end());
+    chr_table.resize((chr_table.size() + BSW_CHR_ENDS_PER_BEAT - 1) / BSW_CHR_ENDS_PER_BEAT * BSW_CHR_ENDS_PER_BEAT, UINT32_MAX);
+
+    std::vector<seed_hit> hits;
+    for (int i = 0; i < num_hits; i++) {
+        seed_hit h;
+        uint32_t chr_end = r_chr_coord[i % 3] + r_chr_len[i % 3];
+        h.reference_offset = (i % 2) ? rand() % (REF_LEN - 1) : chr_end - 1 - rand() % cfg.first_tile_size;
+        h.query_offset = (i % 3) ? h.reference_offset : rand() % (REF_LEN - 1);
+        hits.push_back(h);
+    }
+
+    bsw_kernel k;
+    k.Reset();
+    uint64_t ref_addr = k.Alloc(ref.data(), REF_LEN);
+    uint64_t query_addr = k.Alloc(query.data(), REF_LEN);
+    uint64_t chr_ends_addr = k.Alloc(chr_table.data(), sizeof(uint32_t) * chr_table.size());
+
+    int ret = 0;
+    uint8_t align_fields[2] = {0, reverse_query | complement_query};
+    for (uint8_t af: align_fields) {
+        std::vector<filter_tile> tiles;
+        for (auto h: hits) {
+            tiles.push_back(HitTile(h, REF_LEN, cfg.first_tile_size, (af & reverse_query)));
+        }
+        int tile_passed, hit_passed;
+        std::vector<tile_output> tile_op = RunKernel(k, ref_addr, query_addr, chr_ends_addr, TileBatch(tiles, af, INT_MIN), tile_passed);
+        std::vector<tile_output> hit_op = RunKernel(k, ref_addr, query_addr, chr_ends_addr, HitBatch(hits, af, INT_MIN), hit_passed);
+        int mismatches = CountMismatches(hit_op, tile_op);
+        printf("hit      align fields: %d  tiles: %6d  outputs: %6d  mismatches: %d\n", af, tile_passed, hit_passed, mismatches);
+        ret |= (mismatches > 0) || (hit_passed != tile_passed);
+    }
+    printf("kernel cycles: %lu\n", k.cycles);
+    return ret;
+}
+
+// The result stream of a batch of the test tiles, each padded copy carrying
+// the expected record of the tile it copies: the header count must be the
+// number of tiles scoring at least thresh, and the records must follow the
+// header beat back to back, each passing tile exactly once
+static int CheckResults (const std::vector<tile_output>& op, int num_passed, const std::vector<tile_output>& expected,
+        uint32_t batch_size, int thresh) {
+    int mismatches = 0;
+    int num_expected = 0;
+    for (uint32_t b = 0; b < batch_size; b++) {
+        num_expected += (expected[b % expected.size()].tile_score >= thresh);
+    }
+    std::vector<bool> seen(batch_size, false);
+    for (auto o: op) {
+        if ((o.batch_id < 0) || ((uint32_t) o.batch_id >= batch_size) || seen[o.batch_id]) {
+            mismatches++;
+            continue;
+        }
+        seen[o.batch_id] = true;
+        const tile_output& e = expected[o.batch_id % expected.size()];
+        if ((e.tile_score < thresh) || (o.tile_score != e.tile_score) ||
+                (o.max_ref_offset != e.max_ref_offset) || (o.max_query_offset != e.max_query_offset)) {
+            mismatches++;
+        }
+    }
+    mismatches += std::abs(num_passed - num_expected) + std::abs((int) op.size() - num_expected);
+    return mismatches;
+}
+
+static int ResultsBench (const std::string& dir, bool has_thresh, int thresh) {
+    std::string ref, query;
+    std::ifstream infile(dir + "/ref.txt");
+    getline(infile, ref);
+    infile.close();
+    infile.open(dir + "/query.txt");
+    getline(infile, query);
+    infile.close();
+
+    // parameters.txt: ref_length query_length ref_offset query_offset
+    std::vector<filter_tile> tiles;
+    infile.open(dir + "/parameters.txt");
+    size_t rl, ql, ro, qo;
+    while (infile >> rl >> ql >> ro >> qo) {
+        tiles.push_back(filter_tile(ro, qo, rl, ql, qo));
+    }
+    infile.close();
+
+    // results.txt: tile_id, score, ref_max_pos, query_max_pos
+    std::vector<tile_output> expected;
+    infile.open(dir + "/results.txt");
+    std::string line;
+    while (getline(infile, line)) {
+        int id, score;
+        uint32_t rmax, qmax;
+        if (sscanf(line.c_str(), "%d, %d, %u, %u", &id, &score, &rmax, &qmax) == 4) {
+            expected.push_back(tile_output(id, score, rmax, qmax));
+        }
+    }
+    infile.close();
+
+    if (tiles.empty() || (tiles.size() != expected.size())) {
+        fprintf(stderr, "Error: %s holds %lu tiles and %lu results!\n", dir.c_str(), tiles.size(), expected.size());
+        fprintf(stderr, "Test failed\n");
+        exit(1);
+    }
+
+    // by default, a threshold between the scores of the test tiles
+    if (!has_thresh) {
+        std::vector<int> scores;
+        for (auto e: expected) {
+            scores.push_back(e.tile_score);
+        }
+        std::sort(scores.begin(), scores.end());
+        thresh = scores[scores.size() / 2];
+    }
+
+    bsw_kernel k;
+    k.Reset();
+    uint64_t ref_addr = k.Alloc(ref.data(), ref.size());
+    uint64_t query_addr = k.Alloc(query.data(), query.size());
+    uint64_t chr_ends_addr = k.Alloc(NULL, 64);
+
+    int ret = 0;
+    int threshs[2] = {INT_MIN, thresh};
+    for (int t: threshs) {
+        kernel_batch batch = TileBatch(tiles, 0, t);
+        // padded tiles copy the test tiles in turn, as in the BSW test host
+        for (uint32_t b = tiles.size(); b < batch.batch_size; b++) {
+            const filter_tile& c = tiles[b % tiles.size()];
+            batch.batch_params[4*b] = c.ref_offset;
+            batch.batch_params[4*b+1] = c.query_offset;
+            batch.batch_params[4*b+2] = c.ref_length;
+            batch.batch_params[4*b+3] = c.query_length;
+        }
+        int num_passed;
+        std::vector<tile_output> op = RunKernel(k, ref_addr, query_addr, chr_ends_addr, batch, num_passed);
+        int mismatches = CheckResults(op, num_passed, expected, batch.batch_size, t);
+        if (t == INT_MIN) {
+            printf("results  threshold:    none  outputs: %6d  mismatches: %d\n", num_passed, mismatches);
+            std::sort(op.begin(), op.end(), CompareBatchId);
+            for (auto o: op) {
+                if (o.batch_id < (int) tiles.size()) {
+                    printf("%d, %d, %u, %u\n", o.batch_id, o.tile_score, o.max_ref_offset, o.max_query_offset);
+                }
+            }
+        }
+        else {
+            printf("results  threshold: %7d  outputs: %6d  mismatches: %d\n", t, num_passed, mismatches);
+        }
+        ret |= (mismatches > 0);
+    }
+    printf("kernel cycles: %lu\n", k.cycles);
+    return ret;
+}
+
+static void ReadScoring (const ConfigFile& cfg_file) {
+    cfg.gact_sub_mat[0] = cfg_file.Value("Scoring", "sub_AA");
+    cfg.gact_sub_mat[1] = cfg_file.Value("Scoring", "sub_AC");
+    cfg.gact_sub_mat[2] = cfg_file.Value("Scoring", "sub_AG");
+    cfg.gact_sub_mat[3] = cfg_file.Value("Scoring", "sub_AT");
+    cfg.gact_sub_mat[4] = cfg_file.Value("Scoring", "sub_CC");
+    cfg.gact_sub_mat[5] = cfg_file.Value("Scoring", "sub_CG");
+    cfg.gact_sub_mat[6] = cfg_file.Value("Scoring", "sub_CT");
+    cfg.gact_sub_mat[7] = cfg_file.Value("Scoring", "sub_GG");
+    cfg.gact_sub_mat[8] = cfg_file.Value("Scoring", "sub_GT");
+    cfg.gact_sub_mat[9] = cfg_file.Value("Scoring", "sub_TT");
+    cfg.gact_sub_mat[10] = cfg_file.Value("Scoring", "sub_N");
+    cfg.gap_open = cfg_file.Value("Scoring", "gap_open");
+    cfg.gap_extend = cfg_file.Value("Scoring", "gap_extend");
+    cfg.band_size = cfg_file.Value("BSW_params", "band_size");
+}
+
+int main (int argc, char** argv) {
+    Verilated::commandArgs(argc, argv);
+    std::string mode = (argc > 1) ? argv[1] : "";
+    if (!((mode == "results") && (argc > 2)) && (mode != "hits")) {
+        printf("Usage: %s results <src/host/BSW> [score_threshold]\n", argv[0]);
+        printf("       %s hits [num_hits]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int ret;
+    if (mode == "results") {
+        std::string dir = argv[2];
+        ConfigFile cfg_file(dir + "/params.cfg");
+        ReadScoring(cfg_file);
+        ret = ResultsBench(dir, (argc > 3), (argc > 3) ? atoi(argv[3]) : 0);
+    }
+    else {
+        ConfigFile cfg_file("params.cfg");
+        ReadScoring(cfg_file);
+        cfg.first_tile_size = cfg_file.Value("BSW_params", "first_tile_size");
+        int num_hits = (argc > 2) ? atoi(argv[2]) : 256;
+        ret = HitBench(num_hits);
+    }
+
+    printf("%s\n", (ret == 0) ? "kernel agrees" : "kernel differs");
+    return ret;
+}
@@ -0,0 +1,348 @@
+#include "cpu_align.h"
+#include "ntcoding.h"
+#include <immintrin.h>
+#include <algorithm>
+
+#define BSW_NUM_PE 32
+
+// Inter-tile banded Smith-Waterman: each vector lane carries one tile, so a
+// batch is processed 8 (AVX2) or 16 (AVX-512) tiles at a time. All lanes step
+// through the same (i, j) cells; a lane only keeps the results of cells that
+// lie inside its own band, which gives exactly the values of BSWTile().
+//
+// Sequences are transposed so that element [x * lanes + l] is position x of
+// lane l. Reference codes are pre-multiplied so that adding the query code
+// yields the substitution table index: by 5 for the cpu_scoring::sub index
+// (AVX-512), or by 4 for a 4x4 table of A/C/G/T pairs with N coded as 16 on
+// both sides, so that every pair with N indexes past the table (AVX2). The
+// best cell of each lane is kept as (score, rank, j) where rank =
+// (i % 32) * 16 + i / 32 orders rows the way the BSW_Array max reduction does
+// (valid for tiles up to 512 rows).
+
+struct bsw_lanes {
+    int lanes;
+    int max_ref_len;
+    int max_query_len;
+    std::vector<int32_t> ref_t;
+    std::vector<int32_t> query_t;
+    std::vector<int32_t> ref_len;
+    std::vector<int32_t> query_len;
+    std::vector<int32_t> stop;
+    std::vector<int32_t> prev_V, prev_M, prev_F;
+    std::vector<int32_t> curr_V, curr_M, curr_F;
+};
+
+static void LoadLanes (bsw_lanes& bl, int lanes, int ref_scale, const bsw_tile_seq* tiles, int num_tiles) {
+    bl.lanes = lanes;
+    bl.max_ref_len = 0;
+    bl.max_query_len = 0;
+    for (int l = 0; l < num_tiles; l++) {
+        bl.max_ref_len = std::max(bl.max_ref_len, tiles[l].ref_len);
+        bl.max_query_len = std::max(bl.max_query_len, tiles[l].query_len);
+    }
+
+    bl.ref_t.assign((size_t) bl.max_ref_len * lanes, 0);
+    bl.query_t.assign((size_t) bl.max_query_len * lanes, 0);
+    bl.ref_len.assign(lanes, 0);
+    bl.query_len.assign(lanes, 0);
+    bl.stop.assign(lanes, -1);
+
+    for (int l = 0; l < num_tiles; l++) {
+        bl.ref_len[l] = tiles[l].ref_len;
+        bl.query_len[l] = tiles[l].query_len;
+        for (int j = 0; j < tiles[l].ref_len; j++) {
+            int nt = tiles[l].ref[j];
+            bl.ref_t[(size_t) j * lanes + l] = ((ref_scale == 4) && (nt == N_NT)) ? 16 : ref_scale * nt;
+        }
+        for (int i = 0; i < tiles[l].query_len; i++) {
+            int nt = tiles[l].query[i];
+            bl.query_t[(size_t) i * lanes + l] = ((ref_scale == 4) && (nt == N_NT)) ? 16 : nt;
+        }
+    }
+
+    size_t row_size = (size_t) bl.max_ref_len * lanes;
+    bl.prev_V.assign(row_size, CPU_NEG_INF);
+    bl.prev_M.assign(row_size, CPU_NEG_INF);
+    bl.prev_F.assign(row_size, CPU_NEG_INF);
+    bl.curr_V.assign(row_size, CPU_NEG_INF);
+    bl.curr_M.assign(row_size, CPU_NEG_INF);
+    bl.curr_F.assign(row_size, CPU_NEG_INF);
+}
+
+// Band limits of stripe s for every lane, as in BSWTile(). Returns the stop
+// column of the widest lane; lanes whose query is exhausted get stop = -1.
+static int StripeLimits (bsw_lanes& bl, int s, int band, int& start) {
+    int s0 = s * BSW_NUM_PE;
+    start = (s0 <= band) ? 0 : s0 - band;
+
+    int max_stop = -1;
+    for (int l = 0; l < bl.lanes; l++) {
+        int R = bl.ref_len[l];
+        int Q = bl.query_len[l];
+        int stop = -1;
+        if (s0 < Q) {
+            if (s == 0) {
+                stop = band + BSW_NUM_PE - 1;
+            }
+            else if (s0 + BSW_NUM_PE - 1 >= Q - band) {
+                stop = R;
+            }
+            else {
+                stop = s0 + BSW_NUM_PE - 1 + band;
+            }
+            stop = std::min(stop, R - 1);
+        }
+        bl.stop[l] = stop;
+        max_stop = std::max(max_stop, stop);
+    }
+    return max_stop;
+}
+
+static void StoreLanes (int num_tiles, const int32_t* best_V, const int32_t* best_rank, const int32_t* best_j,
+        int* score, int* ref_max_pos, int* query_max_pos) {
+    for (int l = 0; l < num_tiles; l++) {
+        score[l] = best_V[l];
+        if (best_rank[l] < 0) {
+            ref_max_pos[l] = 0;
+            query_max_pos[l] = 0;
+        }
+        else {
+            ref_max_pos[l] = best_j[l];
+            query_max_pos[l] = (best_rank[l] & 15) * BSW_NUM_PE + (best_rank[l] >> 4);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void BSWTilesAVX2 (const bsw_tile_seq* tiles, int num_tiles, const cpu_scoring& sc,
+        int* score, int* ref_max_pos, int* query_max_pos) {
+    const int L = 8;
+    thread_local bsw_lanes bl;
+    LoadLanes(bl, L, 4, tiles, num_tiles);
+
+    // the 4x4 table of A/C/G/T pairs fits in two registers for
+    // permutevar8x32; pairs with N index past it and score sub_N
+    int32_t sub_table[16];
+    for (int r = 0; r < 4; r++) {
+        for (int q = 0; q < 4; q++) {
+            sub_table[4*r+q] = sc.sub[5*r+q];
+        }
+    }
+    const __m256i sub_lo = _mm256_loadu_si256((const __m256i*) sub_table);
+    const __m256i sub_hi = _mm256_loadu_si256((const __m256i*) (sub_table + 8));
+    const __m256i sub_n = _mm256_set1_epi32(sc.sub[5*N_NT]);
+    const __m256i seven = _mm256_set1_epi32(7);
+    const __m256i fifteen = _mm256_set1_epi32(15);
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i neg = _mm256_set1_epi32(CPU_NEG_INF);
+    const __m256i go = _mm256_set1_epi32(sc.gap_open);
+    const __m256i ge = _mm256_set1_epi32(sc.gap_extend);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i q_len = _mm256_loadu_si256((const __m256i*) bl.query_len.data());
+
+    __m256i best_V = zero;
+    __m256i best_rank = _mm256_set1_epi32(-1);
+    __m256i best_j = zero;
+
+    int num_stripes = (bl.max_query_len + BSW_NUM_PE - 1) / BSW_NUM_PE;
+    for (int s = 0; s < num_stripes; s++) {
+        int start;
+        int max_stop = StripeLimits(bl, s, sc.band_size, start);
+        __m256i stop_p1 = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*) bl.stop.data()), one);
+
+        int s0 = s * BSW_NUM_PE;
+        int s1 = std::min(s0 + BSW_NUM_PE, bl.max_query_len);
+        for (int i = s0; i < s1; i++) {
+            __m256i row_active = _mm256_cmpgt_epi32(q_len, _mm256_set1_epi32(i));
+            int rank = (i % BSW_NUM_PE) * 16 + (i / BSW_NUM_PE);
+            __m256i rank_v = _mm256_set1_epi32(rank);
+            __m256i rank_p1 = _mm256_set1_epi32(rank + 1);
+            __m256i q_v = _mm256_loadu_si256((const __m256i*) &bl.query_t[(size_t) i * L]);
+            const int32_t* ref_t = bl.ref_t.data();
+            const int32_t* prev_V = bl.prev_V.data();
+            const int32_t* prev_M = bl.prev_M.data();
+            const int32_t* prev_F = bl.prev_F.data();
+            int32_t* curr_V = bl.curr_V.data();
+            int32_t* curr_M = bl.curr_M.data();
+            int32_t* curr_F = bl.curr_F.data();
+
+            __m256i M_left = zero;
+            __m256i E_left = neg;
+            __m256i V_diag = zero;
+            __m256i row_max = neg;
+
+            for (int j = start; j <= max_stop; j++) {
+                size_t off = (size_t) j * L;
+                __m256i V_up, M_up, F_up;
+                if (i == 0) {
+                    V_up = zero;
+                    M_up = zero;
+                    F_up = neg;
+                }
+                else {
+                    V_up = _mm256_loadu_si256((const __m256i*) &prev_V[off]);
+                    M_up = _mm256_loadu_si256((const __m256i*) &prev_M[off]);
+                    F_up = _mm256_loadu_si256((const __m256i*) &prev_F[off]);
+                }
+
+                __m256i E = _mm256_max_epi32(_mm256_add_epi32(M_left, go), _mm256_add_epi32(E_left, ge));
+                __m256i F = _mm256_max_epi32(_mm256_add_epi32(M_up, go), _mm256_add_epi32(F_up, ge));
+                __m256i idx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*) &ref_t[off]), q_v);
+                __m256i sub = _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(sub_lo, idx),
+                        _mm256_permutevar8x32_epi32(sub_hi, idx), _mm256_cmpgt_epi32(idx, seven));
+                sub = _mm256_blendv_epi8(sub, sub_n, _mm256_cmpgt_epi32(idx, fifteen));
+                __m256i m = _mm256_add_epi32(V_diag, sub);
+                __m256i M = _mm256_max_epi32(m, zero);
+                __m256i V = _mm256_max_epi32(M, _mm256_max_epi32(E, F));
+
+                __m256i active = _mm256_and_si256(row_active, _mm256_cmpgt_epi32(stop_p1, _mm256_set1_epi32(j)));
+                V = _mm256_blendv_epi8(neg, V, active);
+
+                _mm256_storeu_si256((__m256i*) &curr_V[off], V);
+                _mm256_storeu_si256((__m256i*) &curr_M[off], _mm256_blendv_epi8(neg, M, active));
+                _mm256_storeu_si256((__m256i*) &curr_F[off], _mm256_blendv_epi8(neg, F, active));
+                row_max = _mm256_max_epi32(row_max, V);
+
+                M_left = M;
+                E_left = E;
+                V_diag = V_up;
+            }
+
+            // Cells of a row share their rank, so a lane whose row max beats
+            // its best cell takes the last cell of the row holding that max,
+            // found by scanning the stored row again
+            __m256i better = _mm256_cmpgt_epi32(row_max, best_V);
+            __m256i tie = _mm256_and_si256(_mm256_cmpeq_epi32(row_max, best_V), _mm256_cmpgt_epi32(rank_p1, best_rank));
+            __m256i upd = _mm256_or_si256(better, tie);
+            if (!_mm256_testz_si256(upd, upd)) {
+                __m256i row_j = zero;
+                for (int j = start; j <= max_stop; j++) {
+                    __m256i V = _mm256_loadu_si256((const __m256i*) &curr_V[(size_t) j * L]);
+                    row_j = _mm256_blendv_epi8(row_j, _mm256_set1_epi32(j), _mm256_cmpeq_epi32(V, row_max));
+                }
+                best_V = _mm256_blendv_epi8(best_V, row_max, upd);
+                best_rank = _mm256_blendv_epi8(best_rank, rank_v, upd);
+                best_j = _mm256_blendv_epi8(best_j, row_j, upd);
+            }
+            bl.prev_V.swap(bl.curr_V);
+            bl.prev_M.swap(bl.curr_M);
+            bl.prev_F.swap(bl.curr_F);
+        }
+    }
+
+    int32_t out_V[L], out_rank[L], out_j[L];
+    _mm256_storeu_si256((__m256i*) out_V, best_V);
+    _mm256_storeu_si256((__m256i*) out_rank, best_rank);
+    _mm256_storeu_si256((__m256i*) out_j, best_j);
+    StoreLanes(num_tiles, out_V, out_rank, out_j, score, ref_max_pos, query_max_pos);
+}
+
+__attribute__((target("avx512f")))
+static void BSWTilesAVX512 (const bsw_tile_seq* tiles, int num_tiles, const cpu_scoring& sc,
+        int* score, int* ref_max_pos, int* query_max_pos) {
+    const int L = 16;
+    thread_local bsw_lanes bl;
+    LoadLanes(bl, L, 5, tiles, num_tiles);
+
+    // the 25-entry substitution table fits in two registers for permutex2var
+    int32_t sub_table[32] = {0};
+    std::copy(sc.sub, sc.sub + 25, sub_table);
+    const __m512i sub_lo = _mm512_loadu_si512(sub_table);
+    const __m512i sub_hi = _mm512_loadu_si512(sub_table + 16);
+
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i neg = _mm512_set1_epi32(CPU_NEG_INF);
+    const __m512i go = _mm512_set1_epi32(sc.gap_open);
+    const __m512i ge = _mm512_set1_epi32(sc.gap_extend);
+    const __m512i q_len = _mm512_loadu_si512(bl.query_len.data());
+
+    __m512i best_V = zero;
+    __m512i best_rank = _mm512_set1_epi32(-1);
+    __m512i best_j = zero;
+
+    int num_stripes = (bl.max_query_len + BSW_NUM_PE - 1) / BSW_NUM_PE;
+    for (int s = 0; s < num_stripes; s++) {
+        int start;
+        int max_stop = StripeLimits(bl, s, sc.band_size, start);
+        __m512i stop_v = _mm512_loadu_si512(bl.stop.data());
+
+        int s0 = s * BSW_NUM_PE;
+        int s1 = std::min(s0 + BSW_NUM_PE, bl.max_query_len);
+        for (int i = s0; i < s1; i++) {
+            __mmask16 row_active = _mm512_cmpgt_epi32_mask(q_len, _mm512_set1_epi32(i));
+            int rank = (i % BSW_NUM_PE) * 16 + (i / BSW_NUM_PE);
+            __m512i rank_v = _mm512_set1_epi32(rank);
+            __m512i q_v = _mm512_loadu_si512(&bl.query_t[(size_t) i * L]);
+
+            __m512i M_left = zero;
+            __m512i E_left = neg;
+            __m512i V_diag = zero;
+
+            for (int j = start; j <= max_stop; j++) {
+                size_t off = (size_t) j * L;
+                __m512i V_up, M_up, F_up;
+                if (i == 0) {
+                    V_up = zero;
+                    M_up = zero;
+                    F_up = neg;
+                }
+                else {
+                    V_up = _mm512_loadu_si512(&bl.prev_V[off]);
+                    M_up = _mm512_loadu_si512(&bl.prev_M[off]);
+                    F_up = _mm512_loadu_si512(&bl.prev_F[off]);
+                }
+
+                __m512i E = _mm512_max_epi32(_mm512_add_epi32(M_left, go), _mm512_add_epi32(E_left, ge));
+                __m512i F = _mm512_max_epi32(_mm512_add_epi32(M_up, go), _mm512_add_epi32(F_up, ge));
+                __m512i idx = _mm512_add_epi32(_mm512_loadu_si512(&bl.ref_t[off]), q_v);
+                __m512i m = _mm512_add_epi32(V_diag, _mm512_permutex2var_epi32(sub_lo, idx, sub_hi));
+                __m512i M = _mm512_max_epi32(m, zero);
+                __m512i V = _mm512_max_epi32(M, _mm512_max_epi32(E, F));
+
+                __m512i j_v = _mm512_set1_epi32(j);
+                __mmask16 active = row_active & _mm512_cmple_epi32_mask(j_v, stop_v);
+
+                _mm512_storeu_si512(&bl.curr_V[off], _mm512_mask_mov_epi32(neg, active, V));
+                _mm512_storeu_si512(&bl.curr_M[off], _mm512_mask_mov_epi32(neg, active, M));
+                _mm512_storeu_si512(&bl.curr_F[off], _mm512_mask_mov_epi32(neg, active, F));
+
+                __mmask16 better = _mm512_cmpgt_epi32_mask(V, best_V);
+                __mmask16 tie = _mm512_cmpeq_epi32_mask(V, best_V) & _mm512_cmpge_epi32_mask(rank_v, best_rank);
+                __mmask16 upd = active & (better | tie);
+                best_V = _mm512_mask_mov_epi32(best_V, upd, V);
+                best_rank = _mm512_mask_mov_epi32(best_rank, upd, rank_v);
+                best_j = _mm512_mask_mov_epi32(best_j, upd, j_v);
+
+                M_left = M;
+                E_left = E;
+                V_diag = V_up;
+            }
+            bl.prev_V.swap(bl.curr_V);
+            bl.prev_M.swap(bl.curr_M);
+            bl.prev_F.swap(bl.curr_F);
+        }
+    }
+
+    int32_t out_V[L], out_rank[L], out_j[L];
+    _mm512_storeu_si512(out_V, best_V);
+    _mm512_storeu_si512(out_rank, best_rank);
+    _mm512_storeu_si512(out_j, best_j);
+    StoreLanes(num_tiles, out_V, out_rank, out_j, score, ref_max_pos, query_max_pos);
+}
+
+void BSWTiles (int isa, const bsw_tile_seq* tiles, int num_tiles, const cpu_scoring& sc,
+        int* score, int* ref_max_pos, int* query_max_pos) {
+    for (int t = 0; t < num_tiles; t += isa) {
+        int n = std::min(isa, num_tiles - t);
+        if (isa == ISA_AVX512) {
+            BSWTilesAVX512(tiles + t, n, sc, score + t, ref_max_pos + t, query_max_pos + t);
+        }
+        else if (isa == ISA_AVX2) {
+            BSWTilesAVX2(tiles + t, n, sc, score + t, ref_max_pos + t, query_max_pos + t);
+        }
+        else {
+            BSWTile(tiles[t].ref, tiles[t].ref_len, tiles[t].query, tiles[t].query_len, sc, score[t], ref_max_pos[t], query_max_pos[t]);
+        }
+    }
+}
@@ -0,0 +1,156 @@
+#include "cpu_align.h"
+#include "ntcoding.h"
+#include <algorithm>
+#include <climits>
+
+#define BSW_NUM_PE 32
+
+void InitCPUScoring (cpu_scoring& sc, int* sub_mat, int gap_open, int gap_extend, int band_size, int ydrop) {
+    // sub_mat follows the kernel argument order:
+    // AA, AC, AG, AT, CC, CG, CT, GG, GT, TT, N
+    int idx = 0;
+    for (int r = 0; r < 4; r++) {
+        for (int q = r; q < 4; q++) {
+            sc.sub[5*r+q] = sub_mat[idx];
+            sc.sub[5*q+r] = sub_mat[idx];
+            idx++;
+        }
+    }
+    for (int n = 0; n < 5; n++) {
+        sc.sub[5*n+N_NT] = sub_mat[10];
+        sc.sub[5*N_NT+n] = sub_mat[10];
+    }
+    sc.gap_open = gap_open;
+    sc.gap_extend = gap_extend;
+    sc.band_size = band_size;
+    sc.ydrop = ydrop;
+}
+
+void EncodeTileSeq (const char* seq, size_t len, bool reverse, bool complement, int8_t* out) {
+    for (size_t i = 0; i < len; i++) {
+        int8_t nt = NtChar2IntCaseInsensitive(seq[reverse ? (len-1-i) : i]);
+        if (complement && (nt != N_NT)) {
+            nt = T_NT - nt;
+        }
+        out[i] = nt;
+    }
+}
+
+void BSWTile (const int8_t* ref, int ref_len, const int8_t* query, int query_len, const cpu_scoring& sc,
+        int& score, int& ref_max_pos, int& query_max_pos) {
+
+    const int go = sc.gap_open;
+    const int ge = sc.gap_extend;
+    const int band = sc.band_size;
+
+    thread_local std::vector<int> prev_V, prev_M, prev_F;
+    thread_local std::vector<int> curr_V, curr_M, curr_F;
+
+    prev_V.assign(ref_len, CPU_NEG_INF);
+    prev_M.assign(ref_len, CPU_NEG_INF);
+    prev_F.assign(ref_len, CPU_NEG_INF);
+    curr_V.assign(ref_len, CPU_NEG_INF);
+    curr_M.assign(ref_len, CPU_NEG_INF);
+    curr_F.assign(ref_len, CPU_NEG_INF);
+
+    int best_V = 0;
+    int best_r = 0, best_q = 0;
+    int64_t best_key = -1;
+
+    int num_stripes = (query_len + BSW_NUM_PE - 1) / BSW_NUM_PE;
+    for (int s = 0; s < num_stripes; s++) {
+        int s0 = s * BSW_NUM_PE;
+
+        // band limits of the stripe, as sequenced by BSW_Array
+        int start = (s0 <= band) ? 0 : s0 - band;
+        int stop;
+        if (s == 0) {
+            stop = band + BSW_NUM_PE - 1;
+        }
+        else if (s0 + BSW_NUM_PE - 1 >= query_len - band) {
+            stop = ref_len;
+        }
+        else {
+            stop = s0 + BSW_NUM_PE - 1 + band;
+        }
+        stop = std::min(stop, ref_len - 1);
+
+        int s1 = std::min(s0 + BSW_NUM_PE, query_len);
+        for (int i = s0; i < s1; i++) {
+            int M_left = 0;
+            int E_left = CPU_NEG_INF;
+            int V_diag = 0;
+            const int* sub_q = &sc.sub[query[i]];
+
+            for (int j = start; j <= stop; j++) {
+                int V_up, M_up, F_up;
+                if (i == 0) {
+                    V_up = 0;
+                    M_up = 0;
+                    F_up = CPU_NEG_INF;
+                }
+                else {
+                    V_up = prev_V[j];
+                    M_up = prev_M[j];
+                    F_up = prev_F[j];
+                }
+
+                int E = std::max(M_left + go, E_left + ge);
+                int F = std::max(M_up + go, F_up + ge);
+                int m = V_diag + sub_q[5*ref[j]];
+                int V = std::max(std::max(0, m), std::max(E, F));
+                int M = std::max(m, 0);
+
+                curr_V[j] = V;
+                curr_M[j] = M;
+                curr_F[j] = F;
+
+                // the array reduces its max across PEs first and stripes
+                // second, with later cells winning ties
+                int64_t key = ((int64_t) (i % BSW_NUM_PE) << 40) | ((int64_t) (i / BSW_NUM_PE) << 20) | j;
+                if ((V > best_V) || ((V == best_V) && (key >= best_key))) {
+                    best_V = V;
+                    best_r = j;
+                    best_q = i;
+                    best_key = key;
+                }
+
+                M_left = M;
+                E_left = E;
+                V_diag = V_up;
+            }
+            prev_V.swap(curr_V);
+            prev_M.swap(curr_M);
+            prev_F.swap(curr_F);
+        }
+    }
+
+    score = best_V;
+    ref_max_pos = best_r;
+    query_max_pos = best_q;
+}
+
+int DetectCPUISA () {
+    static int isa = -1;
+    if (isa < 0) {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            isa = ISA_AVX512;
+        }
+        else if (__builtin_cpu_supports("avx2")) {
+            isa = ISA_AVX2;
+        }
+        else {
+            isa = ISA_SCALAR;
+        }
+    }
+    return isa;
+}
+
+const char* CPUISAName (int isa) {
+    switch (isa) {
+        case ISA_AVX512: return "avx512";
+        case ISA_AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
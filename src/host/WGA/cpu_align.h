@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define CPU_NEG_INF (-16384)
+
+// Scoring parameters used by the CPU alignment engines. sub is indexed by
+// 5*ref_nt + query_nt using the A/C/G/T/N codes from ntcoding.h.
+struct cpu_scoring {
+    int sub[25];
+    int gap_open;
+    int gap_extend;
+    int band_size;
+    int ydrop;
+};
+
+void InitCPUScoring (cpu_scoring& sc, int* sub_mat, int gap_open, int gap_extend, int band_size, int ydrop);
+
+// Converts len characters starting at seq to 2-bit codes (N = 4), reversing
+// and/or complementing them as requested by the align_fields bits.
+void EncodeTileSeq (const char* seq, size_t len, bool reverse, bool complement, int8_t* out);
+
+// Banded Smith-Waterman over one filter tile. Computes the same striped band
+// (32 rows per stripe) and max-cell tie-breaking as BSW_Array, so that the
+// score and max positions match the BSW kernel.
+void BSWTile (const int8_t* ref, int ref_len, const int8_t* query, int query_len, const cpu_scoring& sc,
+        int& score, int& ref_max_pos, int& query_max_pos);
+
+// Instruction sets of the CPU engines; the value is the number of 32-bit
+// lanes per vector.
+enum cpu_isa { ISA_SCALAR = 1, ISA_AVX2 = 8, ISA_AVX512 = 16 };
+
+// Widest instruction set supported by the running CPU.
+int DetectCPUISA ();
+const char* CPUISAName (int isa);
+
+struct bsw_tile_seq {
+    const int8_t* ref;
+    int ref_len;
+    const int8_t* query;
+    int query_len;
+};
+
+// Inter-tile SIMD banded Smith-Waterman, one tile per vector lane. Results
+// are identical to calling BSWTile() on each tile.
+void BSWTiles (int isa, const bsw_tile_seq* tiles, int num_tiles, const cpu_scoring& sc,
+        int* score, int* ref_max_pos, int* query_max_pos);
+
+// GACT-X extension over one tile: global alignment from the tile origin with
+// y-drop termination, followed by a traceback from the max scoring cell.
+// Computes the same stripes (32 query rows per stripe) as GACTX_Array: each
+// stripe spans the reference columns where the previous stripe had a cell
+// within ydrop of the max score so far, so that the score, max positions and
+// traceback match the GACT-X kernel on every ISA. The traceback is packed 16
+// directions per word in the GACTX_BTLogic format and padded to whole 512-bit
+// beats, as returned by the GACT-X kernel.
+void GACTXTile (int isa, const int8_t* ref, int ref_len, const int8_t* query, int query_len, const cpu_scoring& sc,
+        int& score, int& ref_max_pos, int& query_max_pos, std::vector<uint32_t>& tb_pointers);
+
+// Run-length traceback format of GACTX_BTLogic (tb_run_length in
+// align_fields): each run of steps in one direction is a 16-bit token with the
+// direction in the top 2 bits and the run length in the low TB_RUN_WIDTH
+// bits, two tokens per word starting from the low half. Zero tokens pad the
+// last beat.
+#define TB_RUN_WIDTH 14
+
+// Converts a traceback from GACTXTile() into the run-length format, in place.
+void RunLengthTraceback (std::vector<uint32_t>& tb_pointers);
@@ -0,0 +1,147 @@
+#include "Processor.h"
+#include "graph.h"
+#include "cpu_align.h"
+#include <atomic>
+#include <assert.h>
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
+#define MAX_BANDED_TILE_SIZE 512
+#define MAX_GACTX_TILE_SIZE 2048
+
+// CPU backend: the reference and query stay in g_DRAM and the tiles are
+// aligned by the worker threads, so no accelerator or OpenCL runtime is needed.
+static cpu_scoring cpu_sc;
+static int cpu_isa = ISA_SCALAR;
+static const char* cpu_ref_seq = nullptr;
+static const char* cpu_query_seq = nullptr;
+
+static std::atomic<uint64_t> cpu_num_batches(0);
+static std::atomic<uint64_t> cpu_num_gactx_tiles(0);
+
+static size_t CPUInitializeProcessor (int t, int f, char* xclbin) {
+    fprintf(stderr, "Using CPU processor backend\n");
+
+    InitCPUScoring(cpu_sc, cfg.gact_sub_mat, cfg.gap_open, cfg.gap_extend, cfg.band_size, cfg.ydrop);
+
+    cpu_isa = DetectCPUISA();
+    fprintf(stderr, "CPU alignment engines: %s\n", CPUISAName(cpu_isa));
+
+    return 0;
+}
+
+static void CPUSendRefWriteRequest (size_t start_addr, size_t len) {
+    cpu_ref_seq = g_DRAM->buffer + start_addr;
+}
+
+static void CPUSendQueryWriteRequest (size_t start_addr, size_t len) {
+    cpu_query_seq = g_DRAM->buffer + start_addr;
+}
+
+static void CPUSendQueryPrefetchRequest (size_t start_addr, size_t len) {
+}
+
+static void CPUSendRequest (size_t ref_offset, size_t query_offset, size_t ref_length, size_t query_length, uint8_t align_fields) {
+}
+
+static std::vector<tile_output> CPUSendBatchRequest (std::vector<filter_tile> tiles, uint8_t align_fields, int thresh) {
+    size_t num_tiles = tiles.size();
+
+    bool rev_ref = (align_fields & reverse_ref);
+    bool comp_ref = (align_fields & complement_ref);
+    bool rev_query = (align_fields & reverse_query);
+    bool comp_query = (align_fields & complement_query);
+
+    std::vector<int> scores(num_tiles);
+    std::vector<int> ref_max(num_tiles);
+    std::vector<int> query_max(num_tiles);
+
+    // each task encodes and aligns whole vectors of tiles
+    size_t grain = cpu_isa;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, (num_tiles + grain - 1) / grain),
+        [&](const tbb::blocked_range<size_t>& r) {
+            int8_t ref_tile[ISA_AVX512][MAX_BANDED_TILE_SIZE];
+            int8_t query_tile[ISA_AVX512][MAX_BANDED_TILE_SIZE];
+            bsw_tile_seq seqs[ISA_AVX512];
+
+            for (size_t g = r.begin(); g != r.end(); g++) {
+                size_t t0 = g * grain;
+                int n = std::min(grain, num_tiles - t0);
+                for (int l = 0; l < n; l++) {
+                    const filter_tile& tile = tiles[t0 + l];
+                    assert(tile.ref_length <= MAX_BANDED_TILE_SIZE);
+                    assert(tile.query_length <= MAX_BANDED_TILE_SIZE);
+
+                    EncodeTileSeq(cpu_ref_seq + tile.ref_offset, tile.ref_length, rev_ref, comp_ref, ref_tile[l]);
+                    EncodeTileSeq(cpu_query_seq + tile.query_offset, tile.query_length, rev_query, comp_query, query_tile[l]);
+                    seqs[l].ref = ref_tile[l];
+                    seqs[l].ref_len = tile.ref_length;
+                    seqs[l].query = query_tile[l];
+                    seqs[l].query_len = tile.query_length;
+                }
+                BSWTiles(cpu_isa, seqs, n, cpu_sc, &scores[t0], &ref_max[t0], &query_max[t0]);
+            }
+        });
+
+    std::vector<tile_output> filtered_op;
+
+    for (size_t t = 0; t < num_tiles; t++) {
+        if (scores[t] >= thresh) {
+            filtered_op.push_back(tile_output(t, scores[t], ref_max[t], query_max[t]));
+        }
+    }
+
+    cpu_num_batches += 1;
+    g_cpu_filter_tiles += num_tiles;
+
+    return filtered_op;
+}
+
+static extend_output CPUGACTXRequest (extend_tile tile, uint8_t align_fields) {
+    assert(tile.ref_length <= MAX_GACTX_TILE_SIZE);
+    assert(tile.query_length <= MAX_GACTX_TILE_SIZE);
+
+    int8_t ref_tile[MAX_GACTX_TILE_SIZE];
+    int8_t query_tile[MAX_GACTX_TILE_SIZE];
+
+    EncodeTileSeq(cpu_ref_seq + tile.ref_offset, tile.ref_length, (align_fields & reverse_ref), (align_fields & complement_ref), ref_tile);
+    EncodeTileSeq(cpu_query_seq + tile.query_offset, tile.query_length, (align_fields & reverse_query), (align_fields & complement_query), query_tile);
+
+    int score, ref_max, query_max;
+    extend_output op;
+    GACTXTile(cpu_isa, ref_tile, tile.ref_length, query_tile, tile.query_length, cpu_sc, score, ref_max, query_max, op.tb_pointers);
+    if (align_fields & tb_run_length) {
+        RunLengthTraceback(op.tb_pointers);
+    }
+    op.max_ref_offset = ref_max;
+    op.max_query_offset = query_max;
+
+    cpu_num_gactx_tiles += 1;
+
+    return op;
+}
+
+static std::future<extend_output> CPUGACTXSubmit (extend_tile tile, uint8_t align_fields) {
+    std::promise<extend_output> result;
+    result.set_value(CPUGACTXRequest(tile, align_fields));
+    return result.get_future();
+}
+
+static void CPUShutdownProcessor () {
+    fprintf(stderr, "#CPU BSW batches: %lu (tiles: %lu)\n", cpu_num_batches.load(), g_cpu_filter_tiles.load());
+    fprintf(stderr, "#CPU GACT-X tiles: %lu\n", cpu_num_gactx_tiles.load());
+}
+
+ProcessorBackend cpu_backend = {
+    "cpu",
+    CPUInitializeProcessor,
+    CPUShutdownProcessor,
+    CPUSendRequest,
+    CPUSendBatchRequest,
+    SendHitBatchAsTiles,
+    CPUGACTXRequest,
+    CPUGACTXSubmit,
+    CPUSendRefWriteRequest,
+    CPUSendQueryWriteRequest,
+    CPUSendQueryPrefetchRequest
+};
@@ -1,12 +1,80 @@
 #include <atomic>
 #include <mutex>
 #include "graph.h"
+#include "cpu_align.h"
 #include <unordered_map>
 
 #define TB_MASK (1<<2)-1
+#define TB_RUN_MASK ((1<<TB_RUN_WIDTH)-1)
 
 std::atomic<uint64_t> extender_body::num_extend_tiles(0);
 
+// Anchors are looked up by their reference and query position, packed into
+// one 64-bit key with 32-bit reference coordinates and kept as a pair with
+// WIDE_COORD
+#ifdef WIDE_COORD
+typedef std::pair<ref_coord_t, uint32_t> anchor_key;
+
+struct AnchorKeyHash {
+    size_t operator()(const anchor_key& k) const {
+        return std::hash<uint64_t>()((k.first << 32) + k.second);
+    }
+};
+
+static inline anchor_key AnchorKey (ref_coord_t ro, uint32_t qo) {
+    return anchor_key(ro, qo);
+}
+#else
+typedef uint64_t anchor_key;
+typedef std::hash<uint64_t> AnchorKeyHash;
+
+static inline anchor_key AnchorKey (ref_coord_t ro, uint32_t qo) {
+    return ((uint64_t) ro << 32) + qo;
+}
+#endif
+
+struct tb_run {
+    int dir;
+    uint32_t length;
+};
+
+// Splits the traceback of a tile into runs of one direction and returns the
+// number of steps. With cfg.tb_rle the kernel returns the runs as 16-bit
+// tokens (cpu_align.h), otherwise consecutive 2-bit directions are merged.
+static int DecodeTraceback (const std::vector<uint32_t>& tb_pointers, std::vector<tb_run>& runs) {
+    int num_steps = 0;
+    runs.clear();
+    for (uint32_t tb_ptr: tb_pointers) {
+        if (cfg.tb_rle) {
+            for (int j = 0; j < 2; j++) {
+                uint32_t token = (tb_ptr >> (16*j)) & 0xffff;
+                tb_run run = {(int) (token >> TB_RUN_WIDTH), token & TB_RUN_MASK};
+                if ((run.dir != Z) && (run.length > 0)) {
+                    runs.push_back(run);
+                    num_steps += run.length;
+                }
+            }
+        }
+        else {
+            for (int j = 0; j < 16; j++) {
+                int dir = ((tb_ptr >> (2*j)) & TB_MASK);
+                if (dir == Z) {
+                    continue;
+                }
+                if (!runs.empty() && (runs.back().dir == dir)) {
+                    runs.back().length++;
+                }
+                else {
+                    tb_run run = {dir, 1};
+                    runs.push_back(run);
+                }
+                num_steps++;
+            }
+        }
+    }
+    return num_steps;
+}
+
 void extender_body::operator()(extender_input input, extender_node::output_ports_type &op)
 {
     auto &payload = get<0>(input);
@@ -19,30 +87,43 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
 
     extender_output output;
 
-    std::unordered_map<uint64_t, bool> fwAnchors; 
-    std::unordered_map<uint64_t, bool> rcAnchors; 
+    uint8_t tb_fields = cfg.tb_rle ? tb_run_length : 0;
+
+    std::unordered_map<anchor_key, bool, AnchorKeyHash> fwAnchors; 
+    std::unordered_map<anchor_key, bool, AnchorKeyHash> rcAnchors; 
 
     fwAnchors.clear();
     rcAnchors.clear();
     
 
     for (auto anc: fwData) {
-        uint64_t key = anc.reference_offset;
-        key = (key << 32) + anc.query_offset;
+        anchor_key key = AnchorKey(anc.reference_offset, anc.query_offset);
         fwAnchors[key] = true;
     }
 
     char* query = (char*) read.seq.data();
     for (auto anc: fwData) {
-        uint64_t key = anc.reference_offset;
-        key = (key << 32) + anc.query_offset;
+        anchor_key key = AnchorKey(anc.reference_offset, anc.query_offset);
         int anc_score = anc.score;
 
         if (fwAnchors[key]) {
             Alignment e = makeAlignment(read, anc, '+');
             bool right_ext_done = false;
             bool left_ext_done = false;
-            uint8_t align_fields = 0;
+            uint8_t align_fields = tb_fields;
+
+            // the first left tile ends at the anchor just like the first
+            // right tile starts there, so queue both before waiting on either
+            std::future<extend_output> first_left_op;
+            if ((e.curr_reference_offset != 0) && (e.curr_query_offset != 0)) {
+                uint32_t r_end = e.curr_reference_offset;
+                uint32_t r_start = std::max(r_end, (uint32_t) cfg.tile_size) - cfg.tile_size;
+                uint32_t q_end = e.curr_query_offset;
+                uint32_t q_start = std::max(q_end, (uint32_t) cfg.tile_size) - cfg.tile_size;
+                extend_tile tile(e.reference_start_addr + r_start, q_start, r_end-r_start, q_end-q_start);
+                first_left_op = g_GACTXSubmit(tile, reverse_ref + reverse_query + tb_fields);
+            }
+
             while (!right_ext_done) {
                 uint32_t r_start = e.curr_reference_offset;
                 uint32_t r_end = std::min(e.curr_reference_offset + cfg.tile_size, e.reference_length);
@@ -50,22 +131,23 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                 uint32_t q_end = std::min(e.curr_query_offset + cfg.tile_size, e.query_length);
                 extend_tile tile(e.reference_start_addr + r_start, q_start, r_end-r_start, q_end-q_start);
 
-                extend_output op = g_GACTXRequest(tile, align_fields);
+                extend_output op = g_GACTXSubmit(tile, align_fields).get();
                 num_extend_tiles++;
                 e.num_right_tiles++;
 
-                int tb_size = op.tb_pointers.size();
-                char* ref_buf = (char*) malloc(16 * tb_size);
-                char* query_buf = (char*) malloc(16 * tb_size);
+                std::vector<tb_run> tb_runs;
+                int tb_size = DecodeTraceback(op.tb_pointers, tb_runs);
+                char* ref_buf = (char*) malloc(tb_size);
+                char* query_buf = (char*) malloc(tb_size);
 
                 uint32_t ref_pos = e.curr_reference_offset + op.max_ref_offset;
                 uint32_t query_pos = e.curr_query_offset + op.max_query_offset;
 
-                uint32_t rp = e.reference_start_addr + ref_pos;
+                ref_coord_t rp = e.reference_start_addr + ref_pos;
                 uint32_t qp = query_pos;
                 
                 int num_r_bases = 0, num_q_bases = 0;
-                uint32_t r_tile_begin = e.reference_start_addr + r_start + cfg.tile_size - cfg.tile_overlap;
+                ref_coord_t r_tile_begin = e.reference_start_addr + r_start + cfg.tile_size - cfg.tile_overlap;
                 uint32_t q_tile_begin = q_start + cfg.tile_size - cfg.tile_overlap;
 
                 int tb_pos = 0;
@@ -73,10 +155,9 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                 bool begin_tb = false;
                 //TODO: add condition
 
-                for (int i = 0; i < tb_size; i++) {
-                    uint32_t tb_ptr = op.tb_pointers[i];
-                    for(int j = 0; j < 16; j++){
-                        int dir = ((tb_ptr >> (2*j)) & TB_MASK);
+                for (auto run: tb_runs) {
+                    int dir = run.dir;
+                    for (uint32_t j = 0; j < run.length; j++) {
                         switch(dir) {
                             case Z:
                                 break;
@@ -103,8 +184,7 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                                     begin_tb = true;
                                 }
                                 if (begin_tb) {
-                                    uint64_t k = rp;
-                                    k = (k << 32) + qp;
+                                    anchor_key k = AnchorKey(rp, qp);
                                     if (fwAnchors.find(k) != fwAnchors.end()) {
                                         fwAnchors[k] = false;
                                     }
@@ -134,7 +214,7 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                 e.aligned_query_str = e.aligned_query_str + aligned_query_str; 
 
                 std::string tile_ref(g_DRAM->buffer + e.reference_start_addr + r_start, r_end-r_start);
-                std::string tile_query(g_DRAM->buffer + g_DRAM->referenceSize + q_start, q_end-q_start);
+                std::string tile_query(query + q_start, q_end-q_start);
 
                 free(ref_buf);
                 free(query_buf);
@@ -152,7 +232,7 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
             if ((e.curr_reference_offset == 0) || (e.curr_query_offset == 0)) {
                 left_ext_done = true;
             }
-            align_fields = reverse_ref + reverse_query;
+            align_fields = reverse_ref + reverse_query + tb_fields;
             while (!left_ext_done) {
                 uint32_t r_end = e.curr_reference_offset;
                 uint32_t r_start = std::max(r_end, (uint32_t) cfg.tile_size) - cfg.tile_size;
@@ -160,37 +240,36 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                 uint32_t q_start = std::max(q_end, (uint32_t) cfg.tile_size) - cfg.tile_size;
 
                 std::string t_r(g_DRAM->buffer + e.reference_start_addr + r_start, r_end - r_start);
-                std::string t_q(g_DRAM->buffer + g_DRAM->referenceSize + q_start, q_end - q_start);
+                std::string t_q(query + q_start, q_end - q_start);
                 std::reverse(t_r.begin(), t_r.end());
                 std::reverse(t_q.begin(), t_q.end());
                 extend_tile tile(e.reference_start_addr + r_start, q_start, r_end-r_start, q_end-q_start);
 
-                extend_output op = g_GACTXRequest(tile, align_fields);
+                extend_output op = first_left_op.valid() ? first_left_op.get() : g_GACTXSubmit(tile, align_fields).get();
                 num_extend_tiles++;
                 e.num_left_tiles++;
 
-                int tb_size = op.tb_pointers.size();
-                char* ref_buf = (char*) malloc(16 * tb_size);
-                char* query_buf = (char*) malloc(16 * tb_size);
+                std::vector<tb_run> tb_runs;
+                int tb_size = DecodeTraceback(op.tb_pointers, tb_runs);
+                char* ref_buf = (char*) malloc(tb_size);
+                char* query_buf = (char*) malloc(tb_size);
 
-                uint32_t ref_pos = e.curr_reference_offset - op.max_ref_offset - 1;
                 uint32_t query_pos = e.curr_query_offset - op.max_query_offset - 1;
 
-                uint32_t rp = e.reference_start_addr + ref_pos;
+                ref_coord_t rp = e.reference_start_addr + e.curr_reference_offset - op.max_ref_offset - 1;
                 uint32_t qp = query_pos;
 
                 int num_r_bases = 0, num_q_bases = 0;
-                uint32_t r_tile_begin = (e.reference_start_addr + std::max(r_end, (uint32_t) (cfg.tile_size-cfg.tile_overlap))) - (cfg.tile_size - cfg.tile_overlap);
+                ref_coord_t r_tile_begin = (e.reference_start_addr + std::max(r_end, (uint32_t) (cfg.tile_size-cfg.tile_overlap))) - (cfg.tile_size - cfg.tile_overlap);
                 uint32_t q_tile_begin = (std::max(q_end, (uint32_t) (cfg.tile_size-cfg.tile_overlap))) - (cfg.tile_size - cfg.tile_overlap);
 
                 int tb_pos = 0;
 
                 bool begin_tb = false;
 
-                for (int i = 0; i < tb_size; i++) {
-                    uint32_t tb_ptr = op.tb_pointers[i];
-                    for(int j = 0; j < 16; j++){
-                        int dir = ((tb_ptr >> (2*j)) & TB_MASK);
+                for (auto run: tb_runs) {
+                    int dir = run.dir;
+                    for (uint32_t j = 0; j < run.length; j++) {
                         switch(dir) {
                             case Z:
                                 break;
@@ -217,8 +296,7 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                                     begin_tb = true;
                                 }
                                 if (begin_tb) {
-                                    uint64_t k = rp;
-                                    k = (k << 32) + qp;
+                                    anchor_key k = AnchorKey(rp, qp);
                                     if (fwAnchors.find(k) != fwAnchors.end()) {
                                         fwAnchors[k] = false;
                                     }
@@ -259,21 +337,30 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
     }
     
     for (auto anc: rcData) {
-        uint64_t key = anc.reference_offset;
-        key = (key << 32) + anc.query_offset;
+        anchor_key key = AnchorKey(anc.reference_offset, anc.query_offset);
         rcAnchors[key] = true;
     }
     
     char* rc_query = (char*) read.rc_seq.data();
     for (auto anc: rcData) {
-        uint64_t key = anc.reference_offset;
-        key = (key << 32) + anc.query_offset;
+        anchor_key key = AnchorKey(anc.reference_offset, anc.query_offset);
 
         if (rcAnchors[key]) {
             Alignment e = makeAlignment(read, anc, '-');
             bool right_ext_done = false;
             bool left_ext_done = false;
-            uint8_t align_fields = reverse_query + complement_query;
+            uint8_t align_fields = reverse_query + complement_query + tb_fields;
+
+            std::future<extend_output> first_left_op;
+            if ((e.curr_reference_offset != 0) && (e.curr_query_offset != 0)) {
+                uint32_t r_end = e.curr_reference_offset;
+                uint32_t r_start = std::max(r_end, (uint32_t) cfg.tile_size) - cfg.tile_size;
+                uint32_t q_end = e.curr_query_offset;
+                uint32_t q_start = std::max(q_end, (uint32_t) cfg.tile_size) - cfg.tile_size;
+                uint32_t q_tile_start = e.query_length - q_end;
+                extend_tile tile(e.reference_start_addr + r_start, q_tile_start, r_end-r_start, q_end-q_start);
+                first_left_op = g_GACTXSubmit(tile, reverse_ref + complement_query + tb_fields);
+            }
             
             while (!right_ext_done) {
                 uint32_t r_start = e.curr_reference_offset;
@@ -284,33 +371,33 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                 uint32_t q_tile_start = e.query_length - q_end;
                 extend_tile tile(e.reference_start_addr + r_start, q_tile_start, r_end-r_start, q_end-q_start);
 
-                extend_output op = g_GACTXRequest(tile, align_fields);
+                extend_output op = g_GACTXSubmit(tile, align_fields).get();
                 num_extend_tiles++;
                 e.num_right_tiles++;
 
-                int tb_size = op.tb_pointers.size();
-                char* ref_buf = (char*) malloc(16 * tb_size);
-                char* query_buf = (char*) malloc(16 * tb_size);
+                std::vector<tb_run> tb_runs;
+                int tb_size = DecodeTraceback(op.tb_pointers, tb_runs);
+                char* ref_buf = (char*) malloc(tb_size);
+                char* query_buf = (char*) malloc(tb_size);
 
                 uint32_t ref_pos = e.curr_reference_offset + op.max_ref_offset;
                 uint32_t query_pos = e.curr_query_offset + op.max_query_offset;
 
-                uint32_t rp = e.reference_start_addr + ref_pos;
+                ref_coord_t rp = e.reference_start_addr + ref_pos;
                 uint32_t qp = query_pos;
 
                 int num_r_bases = 0, num_q_bases = 0;
 
-                uint32_t r_tile_begin = e.reference_start_addr + r_start + cfg.tile_size - cfg.tile_overlap;
+                ref_coord_t r_tile_begin = e.reference_start_addr + r_start + cfg.tile_size - cfg.tile_overlap;
                 uint32_t q_tile_begin = q_start + cfg.tile_size - cfg.tile_overlap;
 
                 int tb_pos = 0;
 
                 bool begin_tb = false;
 
-                for (int i = 0; i < tb_size; i++) {
-                    uint32_t tb_ptr = op.tb_pointers[i];
-                    for(int j = 0; j < 16; j++){
-                        int dir = ((tb_ptr >> (2*j)) & TB_MASK);
+                for (auto run: tb_runs) {
+                    int dir = run.dir;
+                    for (uint32_t j = 0; j < run.length; j++) {
                         switch(dir) {
                             case Z:
                                 break;
@@ -337,8 +424,7 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                                     begin_tb = true;
                                 }
                                 if (begin_tb) {
-                                    uint64_t k = rp;
-                                    k = (k << 32) + qp;
+                                    anchor_key k = AnchorKey(rp, qp);
                                     if (rcAnchors.find(k) != rcAnchors.end()) {
                                         rcAnchors[k] = false;
                                     }
@@ -383,7 +469,7 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                 left_ext_done = true;
             }
 
-            align_fields = reverse_ref + complement_query;
+            align_fields = reverse_ref + complement_query + tb_fields;
             while (!left_ext_done) {
                 uint32_t r_end = e.curr_reference_offset;
                 uint32_t r_start = std::max(r_end, (uint32_t) cfg.tile_size) - cfg.tile_size;
@@ -393,33 +479,32 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                 uint32_t q_tile_start = e.query_length - q_end;
                 extend_tile tile(e.reference_start_addr + r_start, q_tile_start, r_end-r_start, q_end-q_start);
 
-                extend_output op = g_GACTXRequest(tile, align_fields);
+                extend_output op = first_left_op.valid() ? first_left_op.get() : g_GACTXSubmit(tile, align_fields).get();
                 num_extend_tiles++;
                 e.num_left_tiles++;
 
-                int tb_size = op.tb_pointers.size();
-                char* ref_buf = (char*) malloc(16 * tb_size);
-                char* query_buf = (char*) malloc(16 * tb_size);
+                std::vector<tb_run> tb_runs;
+                int tb_size = DecodeTraceback(op.tb_pointers, tb_runs);
+                char* ref_buf = (char*) malloc(tb_size);
+                char* query_buf = (char*) malloc(tb_size);
 
-                uint32_t ref_pos = e.curr_reference_offset - op.max_ref_offset - 1;
                 uint32_t query_pos = e.curr_query_offset - op.max_query_offset - 1;
 
-                uint32_t rp = e.reference_start_addr + ref_pos;
+                ref_coord_t rp = e.reference_start_addr + e.curr_reference_offset - op.max_ref_offset - 1;
                 uint32_t qp = query_pos;
 
                 int num_r_bases = 0, num_q_bases = 0;
 
-                uint32_t r_tile_begin = (e.reference_start_addr + std::max(r_end, (uint32_t) (cfg.tile_size-cfg.tile_overlap))) - (cfg.tile_size - cfg.tile_overlap);
+                ref_coord_t r_tile_begin = (e.reference_start_addr + std::max(r_end, (uint32_t) (cfg.tile_size-cfg.tile_overlap))) - (cfg.tile_size - cfg.tile_overlap);
                 uint32_t q_tile_begin = std::max(q_end, (uint32_t) (cfg.tile_size-cfg.tile_overlap)) - (cfg.tile_size - cfg.tile_overlap);
 
                 int tb_pos = 0;
 
                 bool begin_tb = false;
 
-                for (int i = 0; i < tb_size; i++) {
-                    uint32_t tb_ptr = op.tb_pointers[i];
-                    for(int j = 0; j < 16; j++){
-                        int dir = ((tb_ptr >> (2*j)) & TB_MASK);
+                for (auto run: tb_runs) {
+                    int dir = run.dir;
+                    for (uint32_t j = 0; j < run.length; j++) {
                         switch(dir) {
                             case Z:
                                 break;
@@ -446,8 +531,7 @@ void extender_body::operator()(extender_input input, extender_node::output_ports
                                     begin_tb = true;
                                 }
                                 if (begin_tb) {
-                                    uint64_t k = rp;
-                                    k = (k << 32) + qp;
+                                    anchor_key k = AnchorKey(rp, qp);
                                     if (rcAnchors.find(k) != rcAnchors.end()) {
                                         rcAnchors[k] = false;
                                     }
@@ -499,7 +583,7 @@ Alignment extender_body::makeAlignment(reader_output read, anchor anc, char stra
     const size_t read_len = read.seq.size();
     
     int chr_id = std::upper_bound(r_chr_coord.cbegin(), r_chr_coord.cend(), anc.reference_offset) - r_chr_coord.cbegin() - 1;
-    uint32_t chr_start = r_chr_coord[chr_id];
+    ref_coord_t chr_start = r_chr_coord[chr_id];
 
     extend_alignment.chr_id = chr_id;
 
@@ -513,7 +597,7 @@ Alignment extender_body::makeAlignment(reader_output read, anchor anc, char stra
     extend_alignment.query_end_offset = anc.query_offset;
 
     extend_alignment.reference_start_addr = chr_start;
-    extend_alignment.query_start_addr = g_DRAM->referenceSize;
+    extend_alignment.query_start_addr = (char*) read.seq.data() - g_DRAM->buffer;
 
     extend_alignment.reference_length = r_chr_len[chr_id];
     extend_alignment.query_length = read_len;
@@ -0,0 +1,601 @@
+#include "cpu_align.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#define GACTX_NEG_INF (INT_MIN/4)
+#define GACTX_MAX_LANES 16
+#define GACTX_NUM_PE 32
+
+enum tb_dirs { TB_Z = 0, TB_V = 1, TB_H = 2, TB_M = 3 };
+
+// GACT-X tile alignment in the order of GACTX_Array: the query is cut into
+// stripes of GACTX_NUM_PE rows, one per PE, and each stripe is computed over
+// its window of reference columns one anti-diagonal at a time. Cell (i, j)
+// lies on diagonal k = i + j, where i is the query row and j the reference
+// column (row and column 0 being the tile boundary). Its predecessors are
+// (i, j-1) and (i-1, j) on diagonal k-1 and (i-1, j-1) on diagonal k-2, so the
+// per-diagonal score arrays are indexed by i and all cells of a diagonal
+// within a stripe are independent.
+//
+// Direction byte of a cell: bits [1:0] select the V source (TB_M, TB_V from F
+// or TB_H from E), bit 2 is set when F opened from M and bit 3 when E opened
+// from M, as in GACTX_BTLogic.
+
+struct gactx_work {
+    int ref_len;
+    int query_len;
+    int gap_open;
+    int gap_extend;
+    const int* sub;
+    const int32_t* ref_rev;     // 5 * ref[ref_len-1-x]
+    const int32_t* query;       // query[i] = query nt of row i (i >= 1)
+    const int32_t* V2;          // diagonal k-2
+    const int32_t* V1;          // diagonal k-1
+    const int32_t* M1;
+    const int32_t* E1;
+    const int32_t* F1;
+    int32_t* V0;                // diagonal k
+    int32_t* M0;
+    int32_t* E0;
+    int32_t* F0;
+    int32_t* row_max;           // max score of row i so far and its column
+    int32_t* row_j;
+};
+
+// Each kernel computes the interior cells i0..i1 (1 <= i, 1 <= j) of diagonal
+// k, writes their direction bytes to dir[i - i0], updates the max of each row
+// (the later cell on ties, as a PE keeps it) and raises max_V to the max score
+// of the diagonal.
+typedef void (*GACTXDiag_ptr)(const gactx_work& w, int k, int i0, int i1, uint8_t* dir, int& max_V);
+
+static void GACTXDiagScalar (const gactx_work& w, int k, int i0, int i1, uint8_t* dir, int& max_V) {
+    const int go = w.gap_open;
+    const int ge = w.gap_extend;
+    const int32_t* ref_k = w.ref_rev + w.ref_len - k;
+
+    for (int i = i0; i <= i1; i++) {
+        uint8_t d = 0;
+        int E, F, V;
+        if (w.M1[i] + go >= w.E1[i] + ge) {
+            E = w.M1[i] + go;
+            d |= 8;
+        }
+        else {
+            E = w.E1[i] + ge;
+        }
+        if (w.M1[i-1] + go >= w.F1[i-1] + ge) {
+            F = w.M1[i-1] + go;
+            d |= 4;
+        }
+        else {
+            F = w.F1[i-1] + ge;
+        }
+        int m = w.V2[i-1] + w.sub[ref_k[i] + w.query[i]];
+        if ((m >= E) && (m >= F)) {
+            V = m;
+            d |= TB_M;
+        }
+        else if (F >= E) {
+            V = F;
+            d |= TB_V;
+        }
+        else {
+            V = E;
+            d |= TB_H;
+        }
+        dir[i - i0] = d;
+
+        w.V0[i] = V;
+        w.M0[i] = m;
+        w.E0[i] = E;
+        w.F0[i] = F;
+
+        if (V >= w.row_max[i]) {
+            w.row_max[i] = V;
+            w.row_j[i] = k - i;
+        }
+        max_V = std::max(max_V, V);
+    }
+}
+
+__attribute__((target("avx2")))
+static void GACTXDiagAVX2 (const gactx_work& w, int k, int i0, int i1, uint8_t* dir, int& max_V) {
+    const __m256i go = _mm256_set1_epi32(w.gap_open);
+    const __m256i ge = _mm256_set1_epi32(w.gap_extend);
+    const __m256i neg = _mm256_set1_epi32(GACTX_NEG_INF);
+    const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i i1_p1 = _mm256_set1_epi32(i1 + 1);
+    const __m256i k_v = _mm256_set1_epi32(k);
+    const __m256i ones = _mm256_set1_epi32(-1);
+    const __m256i d_M = _mm256_set1_epi32(TB_M);
+    const __m256i d_V = _mm256_set1_epi32(TB_V);
+    const __m256i d_H = _mm256_set1_epi32(TB_H);
+    const __m256i d_F = _mm256_set1_epi32(4);
+    const __m256i d_E = _mm256_set1_epi32(8);
+    const int32_t* ref_k = w.ref_rev + w.ref_len - k;
+
+    __m256i run_max = neg;
+
+    for (int i = i0; i <= i1; i += 8) {
+        __m256i i_v = _mm256_add_epi32(_mm256_set1_epi32(i), iota);
+        __m256i valid = _mm256_cmpgt_epi32(i1_p1, i_v);
+
+        __m256i M_left = _mm256_loadu_si256((const __m256i*) &w.M1[i]);
+        __m256i E_left = _mm256_loadu_si256((const __m256i*) &w.E1[i]);
+        __m256i M_up = _mm256_loadu_si256((const __m256i*) &w.M1[i-1]);
+        __m256i F_up = _mm256_loadu_si256((const __m256i*) &w.F1[i-1]);
+        __m256i V_diag = _mm256_loadu_si256((const __m256i*) &w.V2[i-1]);
+
+        __m256i E_open = _mm256_add_epi32(M_left, go);
+        __m256i E_ext = _mm256_add_epi32(E_left, ge);
+        __m256i E = _mm256_max_epi32(E_open, E_ext);
+        __m256i E_from_M = _mm256_andnot_si256(_mm256_cmpgt_epi32(E_ext, E_open), d_E);
+
+        __m256i F_open = _mm256_add_epi32(M_up, go);
+        __m256i F_ext = _mm256_add_epi32(F_up, ge);
+        __m256i F = _mm256_max_epi32(F_open, F_ext);
+        __m256i F_from_M = _mm256_andnot_si256(_mm256_cmpgt_epi32(F_ext, F_open), d_F);
+
+        __m256i idx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*) &ref_k[i]),
+                _mm256_loadu_si256((const __m256i*) &w.query[i]));
+        __m256i m = _mm256_add_epi32(V_diag, _mm256_i32gather_epi32(w.sub, idx, 4));
+
+        // m >= E && m >= F selects M, else F >= E selects F, else E
+        __m256i sel_M = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(E, m), _mm256_cmpgt_epi32(F, m)), ones);
+        __m256i sel_F = _mm256_andnot_si256(_mm256_cmpgt_epi32(E, F), ones);
+        __m256i V = _mm256_blendv_epi8(_mm256_blendv_epi8(E, F, sel_F), m, sel_M);
+        __m256i d = _mm256_blendv_epi8(_mm256_blendv_epi8(d_H, d_V, sel_F), d_M, sel_M);
+        d = _mm256_or_si256(d, _mm256_or_si256(E_from_M, F_from_M));
+
+        // lanes past i1 are scratch: the caller rewrites the boundary cell
+        // that follows the interior and nothing reads further down
+        _mm256_storeu_si256((__m256i*) &w.V0[i], V);
+        _mm256_storeu_si256((__m256i*) &w.M0[i], m);
+        _mm256_storeu_si256((__m256i*) &w.E0[i], E);
+        _mm256_storeu_si256((__m256i*) &w.F0[i], F);
+
+        // narrow the direction words to bytes; lanes 0-3 and 4-7 end up in
+        // the low dword of each 128-bit half
+        __m256i d8 = _mm256_packus_epi16(_mm256_packs_epi32(d, _mm256_setzero_si256()), _mm256_setzero_si256());
+        uint32_t lo_half = _mm_cvtsi128_si32(_mm256_castsi256_si128(d8));
+        uint32_t hi_half = _mm_cvtsi128_si32(_mm256_extracti128_si256(d8, 1));
+        memcpy(&dir[i - i0], &lo_half, 4);
+        memcpy(&dir[i - i0 + 4], &hi_half, 4);
+
+        __m256i row_max = _mm256_loadu_si256((const __m256i*) &w.row_max[i]);
+        __m256i row_j = _mm256_loadu_si256((const __m256i*) &w.row_j[i]);
+        __m256i upd = _mm256_andnot_si256(_mm256_cmpgt_epi32(row_max, V), valid);
+        _mm256_storeu_si256((__m256i*) &w.row_max[i], _mm256_blendv_epi8(row_max, V, upd));
+        _mm256_storeu_si256((__m256i*) &w.row_j[i], _mm256_blendv_epi8(row_j, _mm256_sub_epi32(k_v, i_v), upd));
+
+        run_max = _mm256_max_epi32(run_max, _mm256_blendv_epi8(neg, V, valid));
+    }
+
+    __m128i m4 = _mm_max_epi32(_mm256_castsi256_si128(run_max), _mm256_extracti128_si256(run_max, 1));
+    m4 = _mm_max_epi32(m4, _mm_shuffle_epi32(m4, _MM_SHUFFLE(1, 0, 3, 2)));
+    m4 = _mm_max_epi32(m4, _mm_shuffle_epi32(m4, _MM_SHUFFLE(2, 3, 0, 1)));
+    max_V = std::max(max_V, _mm_cvtsi128_si32(m4));
+}
+
+__attribute__((target("avx512f")))
+static void GACTXDiagAVX512 (const gactx_work& w, int k, int i0, int i1, uint8_t* dir, int& max_V) {
+    int32_t sub_table[32] = {0};
+    std::copy(w.sub, w.sub + 25, sub_table);
+    const __m512i sub_lo = _mm512_loadu_si512(sub_table);
+    const __m512i sub_hi = _mm512_loadu_si512(sub_table + 16);
+
+    const __m512i go = _mm512_set1_epi32(w.gap_open);
+    const __m512i ge = _mm512_set1_epi32(w.gap_extend);
+    const __m512i neg = _mm512_set1_epi32(GACTX_NEG_INF);
+    const __m512i iota = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i k_v = _mm512_set1_epi32(k);
+    const __m512i d_M = _mm512_set1_epi32(TB_M);
+    const __m512i d_V = _mm512_set1_epi32(TB_V);
+    const __m512i d_H = _mm512_set1_epi32(TB_H);
+    const __m512i d_F = _mm512_set1_epi32(4);
+    const __m512i d_E = _mm512_set1_epi32(8);
+    const int32_t* ref_k = w.ref_rev + w.ref_len - k;
+
+    __m512i run_max = neg;
+
+    for (int i = i0; i <= i1; i += 16) {
+        __m512i i_v = _mm512_add_epi32(_mm512_set1_epi32(i), iota);
+        int n = std::min(16, i1 - i + 1);
+        __mmask16 valid = (n == 16) ? 0xFFFF : (__mmask16) ((1u << n) - 1);
+
+        __m512i M_left = _mm512_loadu_si512(&w.M1[i]);
+        __m512i E_left = _mm512_loadu_si512(&w.E1[i]);
+        __m512i M_up = _mm512_loadu_si512(&w.M1[i-1]);
+        __m512i F_up = _mm512_loadu_si512(&w.F1[i-1]);
+        __m512i V_diag = _mm512_loadu_si512(&w.V2[i-1]);
+
+        __m512i E_open = _mm512_add_epi32(M_left, go);
+        __m512i E_ext = _mm512_add_epi32(E_left, ge);
+        __m512i E = _mm512_max_epi32(E_open, E_ext);
+        __mmask16 E_from_M = _mm512_cmpge_epi32_mask(E_open, E_ext);
+
+        __m512i F_open = _mm512_add_epi32(M_up, go);
+        __m512i F_ext = _mm512_add_epi32(F_up, ge);
+        __m512i F = _mm512_max_epi32(F_open, F_ext);
+        __mmask16 F_from_M = _mm512_cmpge_epi32_mask(F_open, F_ext);
+
+        __m512i idx = _mm512_add_epi32(_mm512_loadu_si512(&ref_k[i]), _mm512_loadu_si512(&w.query[i]));
+        __m512i m = _mm512_add_epi32(V_diag, _mm512_permutex2var_epi32(sub_lo, idx, sub_hi));
+
+        __mmask16 sel_M = _mm512_cmpge_epi32_mask(m, E) & _mm512_cmpge_epi32_mask(m, F);
+        __mmask16 sel_F = _mm512_cmpge_epi32_mask(F, E);
+        __m512i V = _mm512_mask_mov_epi32(_mm512_mask_mov_epi32(E, sel_F, F), sel_M, m);
+        __m512i d = _mm512_mask_mov_epi32(_mm512_mask_mov_epi32(d_H, sel_F, d_V), sel_M, d_M);
+        d = _mm512_mask_or_epi32(d, E_from_M, d, d_E);
+        d = _mm512_mask_or_epi32(d, F_from_M, d, d_F);
+
+        _mm512_storeu_si512(&w.V0[i], V);
+        _mm512_storeu_si512(&w.M0[i], m);
+        _mm512_storeu_si512(&w.E0[i], E);
+        _mm512_storeu_si512(&w.F0[i], F);
+        _mm_storeu_si128((__m128i*) &dir[i - i0], _mm512_cvtepi32_epi8(d));
+
+        __m512i row_max = _mm512_loadu_si512(&w.row_max[i]);
+        __m512i row_j = _mm512_loadu_si512(&w.row_j[i]);
+        __mmask16 upd = valid & _mm512_cmpge_epi32_mask(V, row_max);
+        _mm512_storeu_si512(&w.row_max[i], _mm512_mask_mov_epi32(row_max, upd, V));
+        _mm512_storeu_si512(&w.row_j[i], _mm512_mask_mov_epi32(row_j, upd, _mm512_sub_epi32(k_v, i_v)));
+
+        run_max = _mm512_mask_max_epi32(run_max, valid, run_max, V);
+    }
+
+    max_V = std::max(max_V, _mm512_reduce_max_epi32(run_max));
+}
+
+// Score buffers hold one diagonal each, indexed by query row. Only the rows of
+// the current stripe, the row above it and the row below it are cleared
+// before a diagonal is computed; the kernels may leave scratch values further
+// down, which no cell of the stripe reads.
+struct gactx_buffers {
+    std::vector<int32_t> ref_rev;
+    std::vector<int32_t> query;
+    std::vector<int32_t> V[3], M[2], E[2], F[2];
+    std::vector<int32_t> row_max, row_j;
+    std::vector<int32_t> prev_V, prev_M, prev_F;    // last row of the stripe above, by column
+    std::vector<int32_t> next_V, next_M, next_F;
+    std::vector<uint8_t> dir;
+    std::vector<size_t> dir_base;
+    std::vector<int> diag_lo;
+    std::vector<int> stripe_diag0;                  // first diagonal of each stripe
+    std::vector<size_t> stripe_entry;               // and its entry in dir_base
+};
+
+static void ClearRange (std::vector<int32_t>& buf, int lo, int hi) {
+    if (lo <= hi) {
+        std::fill(buf.begin() + lo, buf.begin() + hi + 1, GACTX_NEG_INF);
+    }
+}
+
+// Stripe windows follow GACTX_ArrayTop. The diagonals of a stripe are
+// numbered by the column c of its first row, as the PEs see them, and a
+// diagonal is live when one of its cells, or the column 0 value still held by
+// the PEs that have not started, scores at least the max of the earlier
+// diagonals minus ydrop. The next stripe starts at the first live diagonal
+// (column 1 after the first stripe), and this one streams up to the first
+// dead diagonal at or past the end of its own window (the first falling edge
+// in the first stripe) or the end of the reference, which also ends the next
+// window. A stripe without a live diagonal streams to the end of the
+// reference and keeps its window. Cells inside a window are never dropped;
+// the cells left of it are -inf, and so is column 0 unless the window starts
+// at column 1. Each PE keeps the last of its cells with the max score and the
+// later PE wins ties between PEs.
+void GACTXTile (int isa, const int8_t* ref, int ref_len, const int8_t* query, int query_len, const cpu_scoring& sc,
+        int& score, int& ref_max_pos, int& query_max_pos, std::vector<uint32_t>& tb_pointers) {
+
+    GACTXDiag_ptr diag_fn = GACTXDiagScalar;
+    if (isa == ISA_AVX512) {
+        diag_fn = GACTXDiagAVX512;
+    }
+    else if (isa == ISA_AVX2) {
+        diag_fn = GACTXDiagAVX2;
+    }
+
+    const int R = ref_len;
+    const int Q = query_len;
+    const int go = sc.gap_open;
+    const int ge = sc.gap_extend;
+    const int num_stripes = (R > 0) ? (Q + GACTX_NUM_PE - 1) / GACTX_NUM_PE : 0;
+
+    // score buffers have one extra element in front (index -1 reads) and a
+    // vector of padding behind for the tail of the last chunk
+    thread_local gactx_buffers bufs;
+    size_t row_size = Q + 2 + GACTX_MAX_LANES;
+
+    bufs.ref_rev.assign(R + GACTX_MAX_LANES, 0);
+    for (int x = 0; x < R; x++) {
+        bufs.ref_rev[x] = 5 * ref[R - 1 - x];
+    }
+    bufs.query.assign(row_size, 0);
+    for (int i = 1; i <= Q; i++) {
+        bufs.query[i] = query[i - 1];
+    }
+    for (int b = 0; b < 3; b++) {
+        bufs.V[b].assign(row_size, GACTX_NEG_INF);
+    }
+    for (int b = 0; b < 2; b++) {
+        bufs.M[b].assign(row_size, GACTX_NEG_INF);
+        bufs.E[b].assign(row_size, GACTX_NEG_INF);
+        bufs.F[b].assign(row_size, GACTX_NEG_INF);
+    }
+    bufs.row_max.assign(row_size, 0);
+    bufs.row_j.assign(row_size, -1);
+
+    // row 0 is the last row above the first stripe
+    bufs.prev_V.assign(R + 1, GACTX_NEG_INF);
+    bufs.prev_M.assign(R + 1, GACTX_NEG_INF);
+    bufs.prev_F.assign(R + 1, GACTX_NEG_INF);
+    bufs.next_V.assign(R + 1, GACTX_NEG_INF);
+    bufs.next_M.assign(R + 1, GACTX_NEG_INF);
+    bufs.next_F.assign(R + 1, GACTX_NEG_INF);
+    bufs.prev_V[0] = 0;
+    for (int j = 1; j <= R; j++) {
+        bufs.prev_V[j] = go + (j - 1) * ge;
+    }
+    int prev_lo = 0, prev_hi = R;
+
+    bufs.dir.clear();
+    bufs.dir_base.clear();
+    bufs.diag_lo.clear();
+    bufs.stripe_diag0.assign(num_stripes, 0);
+    bufs.stripe_entry.assign(num_stripes, 0);
+
+    gactx_work w;
+    w.ref_len = R;
+    w.query_len = Q;
+    w.gap_open = go;
+    w.gap_extend = ge;
+    w.sub = sc.sub;
+    w.ref_rev = bufs.ref_rev.data();
+    w.query = bufs.query.data();
+    w.row_max = bufs.row_max.data();
+    w.row_j = bufs.row_j.data();
+
+    int global_max = 0;
+    int a = 1, b = R;           // window of the current stripe
+
+    for (int s = 0; s < num_stripes; s++) {
+        int r0 = s * GACTX_NUM_PE + 1;
+        int r1 = std::min(r0 + GACTX_NUM_PE - 1, Q);
+
+        // diagonal input of the first cell of row r0
+        bufs.prev_V[a - 1] = (a > 1) ? GACTX_NEG_INF : ((s == 0) ? 0 : go + (r0 - 2) * ge);
+        bufs.prev_M[a - 1] = GACTX_NEG_INF;
+        bufs.prev_F[a - 1] = GACTX_NEG_INF;
+
+        bool started = false;
+        bool prev_live = false;
+        int e = -1;             // last column of this stripe, once known
+        int next_a = a, next_b = b;
+
+        int k0 = r0 + a - 2;
+        bufs.stripe_diag0[s] = k0;
+        bufs.stripe_entry[s] = bufs.dir_base.size();
+
+        for (int k = k0; (e < 0) || (k <= r1 + e); k++) {
+            int c = k - r0;
+            int v0 = k % 3, v1 = (k + 2) % 3, v2 = (k + 1) % 3;
+            int b0 = k % 2, b1 = (k + 1) % 2;
+
+            // buffers are offset by one
+            ClearRange(bufs.V[v0], r0, r1 + 2);
+            ClearRange(bufs.M[b0], r0, r1 + 2);
+            ClearRange(bufs.E[b0], r0, r1 + 2);
+            ClearRange(bufs.F[b0], r0, r1 + 2);
+
+            w.V2 = bufs.V[v2].data() + 1;
+            w.V1 = bufs.V[v1].data() + 1;
+            w.M1 = bufs.M[b1].data() + 1;
+            w.E1 = bufs.E[b1].data() + 1;
+            w.F1 = bufs.F[b1].data() + 1;
+            w.V0 = bufs.V[v0].data() + 1;
+            w.M0 = bufs.M[b0].data() + 1;
+            w.E0 = bufs.E[b0].data() + 1;
+            w.F0 = bufs.F[b0].data() + 1;
+
+            if (c + 1 <= R) {
+                w.V0[r0 - 1] = bufs.prev_V[c + 1];
+                w.M0[r0 - 1] = bufs.prev_M[c + 1];
+                w.F0[r0 - 1] = bufs.prev_F[c + 1];
+            }
+
+            int i0 = (e < 0) ? r0 : std::max(r0, k - e);
+            int i1 = std::min(r1, k - a);
+            int diag_max = GACTX_NEG_INF;
+
+            size_t base = bufs.dir.size();
+            bufs.dir_base.push_back(base);
+            bufs.diag_lo.push_back(i0);
+            if (i0 <= i1) {
+                bufs.dir.resize(base + (i1 - i0 + 1) + GACTX_MAX_LANES);
+                diag_fn(w, k, i0, i1, &bufs.dir[base], diag_max);
+                bufs.dir.resize(base + (i1 - i0 + 1));
+            }
+
+            // column a - 1, left of the window
+            int ib = k - (a - 1);
+            int boundary_V = GACTX_NEG_INF;
+            if ((ib >= r0) && (ib <= r1)) {
+                if (a == 1) {
+                    boundary_V = go + (ib - 1) * ge;
+                }
+                w.V0[ib] = boundary_V;
+                w.M0[ib] = GACTX_NEG_INF;
+                w.E0[ib] = GACTX_NEG_INF;
+                w.F0[ib] = GACTX_NEG_INF;
+            }
+
+            if ((i0 <= r1) && (r1 <= i1)) {
+                bufs.next_V[k - r1] = w.V0[r1];
+                bufs.next_M[k - r1] = w.M0[r1];
+                bufs.next_F[k - r1] = w.F0[r1];
+            }
+
+            if ((e < 0) && (c >= a)) {
+                bool live = (std::max(diag_max, boundary_V) >= global_max - sc.ydrop);
+                if (!started) {
+                    if ((s == 0) ? (c == 1) : live) {
+                        started = true;
+                        next_a = c;
+                    }
+                }
+                else if (!live && ((s == 0) ? prev_live : (c >= b))) {
+                    e = c;
+                    next_b = c;
+                }
+                if ((e < 0) && (c == R)) {
+                    e = R;
+                    if (started) {
+                        next_b = R;
+                    }
+                }
+                prev_live = live;
+            }
+            global_max = std::max(global_max, diag_max);
+        }
+
+        // the last row of this stripe is the row above the next one
+        ClearRange(bufs.prev_V, prev_lo, prev_hi);
+        ClearRange(bufs.prev_M, prev_lo, prev_hi);
+        ClearRange(bufs.prev_F, prev_lo, prev_hi);
+        std::swap(bufs.prev_V, bufs.next_V);
+        std::swap(bufs.prev_M, bufs.next_M);
+        std::swap(bufs.prev_F, bufs.next_F);
+        prev_lo = a - 1;
+        prev_hi = e;
+
+        a = next_a;
+        b = next_b;
+    }
+
+    // each PE keeps its max over its rows in stripe order, and the max is
+    // then passed down the PEs with the later one winning ties
+    int best_V = 0;
+    int best_i = 0, best_j = 0;
+    for (int p = 0; p < GACTX_NUM_PE; p++) {
+        int pe_V = 0;
+        int pe_i = 0, pe_j = 0;
+        for (int i = p + 1; i <= Q; i += GACTX_NUM_PE) {
+            if ((bufs.row_j[i] >= 0) && (bufs.row_max[i] >= pe_V)) {
+                pe_V = bufs.row_max[i];
+                pe_i = i;
+                pe_j = bufs.row_j[i];
+            }
+        }
+        if (pe_V >= best_V) {
+            best_V = pe_V;
+            best_i = pe_i;
+            best_j = pe_j;
+        }
+    }
+
+    score = best_V;
+    ref_max_pos = best_j - 1;
+    query_max_pos = best_i - 1;
+
+    // traceback from the max cell; emitted from the last aligned pair back
+    // to the tile origin
+    tb_pointers.clear();
+    int num_dirs = 0;
+    uint32_t curr_word = 0;
+
+    int i = best_i;
+    int j = best_j;
+    auto dir_at = [&](int ti, int tj) -> uint8_t {
+        int s = (ti - 1) / GACTX_NUM_PE;
+        size_t entry = bufs.stripe_entry[s] + (ti + tj - bufs.stripe_diag0[s]);
+        return bufs.dir[bufs.dir_base[entry] + ti - bufs.diag_lo[entry]];
+    };
+
+    int state = ((i > 0) && (j > 0)) ? (dir_at(i, j) & 3) : TB_Z;
+    while ((i > 0) || (j > 0)) {
+        int out;
+        if (i == 0) {
+            out = TB_H;
+            j--;
+        }
+        else if (j == 0) {
+            out = TB_V;
+            i--;
+        }
+        else {
+            uint8_t d = dir_at(i, j);
+            out = state;
+            if (state == TB_M) {
+                i--;
+                j--;
+                state = ((i > 0) && (j > 0)) ? (dir_at(i, j) & 3) : TB_Z;
+            }
+            else if (state == TB_V) {
+                state = (d & 4) ? TB_M : TB_V;
+                i--;
+            }
+            else {
+                state = (d & 8) ? TB_M : TB_H;
+                j--;
+            }
+        }
+
+        curr_word |= ((uint32_t) out) << (2 * (num_dirs % 16));
+        num_dirs++;
+        if (num_dirs % 16 == 0) {
+            tb_pointers.push_back(curr_word);
+            curr_word = 0;
+        }
+    }
+    if (num_dirs % 16 != 0) {
+        tb_pointers.push_back(curr_word);
+    }
+
+    // the kernel writes whole 512-bit beats of directions
+    while (tb_pointers.size() % 16 != 0) {
+        tb_pointers.push_back(0);
+    }
+}
+
+void RunLengthTraceback (std::vector<uint32_t>& tb_pointers) {
+    const uint32_t max_run = (1 << TB_RUN_WIDTH) - 1;
+    std::vector<uint32_t> runs;
+    uint32_t run_dir = TB_Z, run_len = 0;
+    int num_tokens = 0;
+
+    auto emit = [&]() {
+        uint32_t token = (run_dir << TB_RUN_WIDTH) | run_len;
+        if (num_tokens % 2 == 0) {
+            runs.push_back(token);
+        }
+        else {
+            runs.back() |= token << 16;
+        }
+        num_tokens++;
+    };
+
+    for (uint32_t word: tb_pointers) {
+        for (int j = 0; j < 16; j++) {
+            uint32_t dir = (word >> (2*j)) & 3;
+            if (dir == TB_Z) {
+                continue;
+            }
+            if ((run_len > 0) && ((dir != run_dir) || (run_len == max_run))) {
+                emit();
+                run_len = 0;
+            }
+            run_dir = dir;
+            run_len++;
+        }
+    }
+    if (run_len > 0) {
+        emit();
+    }
+
+    while (runs.size() % 16 != 0) {
+        runs.push_back(0);
+    }
+    tb_pointers.swap(runs);
+}
@@ -21,6 +21,7 @@
 
 using namespace tbb::flow;
 
+#define tb_run_length (1 << 6)
 #define do_traceback (1 << 5)
 #define reverse_ref (1 << 4)
 #define complement_ref (1 << 3)
@@ -32,7 +33,7 @@ using namespace tbb::flow;
 extern std::vector<std::string> r_chr_id;
 extern std::vector<uint32_t>  r_chr_len;
 extern std::vector<uint32_t>  r_chr_len_unpadded;
-extern std::vector<uint32_t>  r_chr_coord;
+extern std::vector<ref_coord_t>  r_chr_coord;
 
 extern FILE *mafFile;
 
@@ -55,6 +56,9 @@ struct Configuration {
     bool ignore_lower;
     bool use_transition;
     int hash_size;
+    std::string index_file;
+    bool index_populate;
+    bool index_hugepages;
     
 	// GACT scoring
 	int gact_sub_mat[11];
@@ -71,6 +75,13 @@ struct Configuration {
     int tile_overlap;
     int extension_threshold;
     int ydrop;
+    bool tb_rle;
+
+    // Processor backend
+    std::string processor;
+    bool packed_seq;
+    bool hit_tiles;
+    int num_devices;
 
 	//Multi-threading
 	int num_threads;
@@ -108,12 +119,12 @@ typedef tbb::flow::tuple<reader_output, seeder_output> filter_payload;
 typedef tbb::flow::tuple<filter_payload, size_t> filter_input;
 
 struct anchor {
-    anchor(uint32_t ro, uint32_t qo, int score) 
+    anchor(ref_coord_t ro, uint32_t qo, int score) 
         : reference_offset(ro),
         query_offset(qo),
         score(score)
     {};
-    uint32_t reference_offset;
+    ref_coord_t reference_offset;
     uint32_t query_offset;
     int score;
 };
@@ -135,8 +146,8 @@ struct Alignment {
 	uint32_t query_start_offset;
 	uint32_t reference_end_offset;
 	uint32_t query_end_offset;
-	uint32_t reference_start_addr;
-	uint32_t query_start_addr;
+	ref_coord_t reference_start_addr;
+	ref_coord_t query_start_addr;
 	uint32_t reference_length;
 	uint32_t query_length;
 	std::string aligned_reference_str;
@@ -0,0 +1,204 @@
+#include "Processor.h"
+#include "graph.h"
+#include <mutex>
+#include <chrono>
+#include <future>
+
+#define HYBRID_CPU_CHUNK 1024
+#define HYBRID_MIN_FPGA_CHUNK 4096
+#define HYBRID_RATE_WEIGHT 0.25
+
+// Hybrid backend: GACT-X runs on the device, and every filter batch is split
+// between the BSW kernels and the CPU engines. The device takes its share from
+// the front of the batch and the calling thread works through the CPU share
+// from the back, both claiming chunks from a shared pair of cursors. The side
+// that runs out of work first keeps claiming from the other side's share, and
+// the device claims at least HYBRID_MIN_FPGA_CHUNK tiles even when its share
+// is empty, so that an idle device keeps taking work and its rate recovers.
+//
+// Each side gets a share of the batch that matches its recently observed
+// throughput. The device rate is discounted by the number of batches already
+// queued for or holding BSW kernel slots.
+
+struct hybrid_cursor {
+    std::mutex lock;
+    size_t front;
+    size_t back;
+};
+
+static std::mutex hybrid_rate_lock;
+static double hybrid_fpga_rate = 1.0;   // tiles/s, exponentially averaged
+static double hybrid_cpu_rate = 1.0;
+
+static std::atomic<uint64_t> hybrid_num_batches(0);
+static std::atomic<uint64_t> hybrid_fpga_stolen(0);
+static std::atomic<uint64_t> hybrid_cpu_stolen(0);
+
+static bool ClaimFront (hybrid_cursor& c, size_t want, size_t& start, size_t& end) {
+    std::lock_guard<std::mutex> lk(c.lock);
+    if (c.front >= c.back) {
+        return false;
+    }
+    start = c.front;
+    end = std::min(c.front + want, c.back);
+    c.front = end;
+    return true;
+}
+
+static bool ClaimBack (hybrid_cursor& c, size_t want, size_t& start, size_t& end) {
+    std::lock_guard<std::mutex> lk(c.lock);
+    if (c.front >= c.back) {
+        return false;
+    }
+    end = c.back;
+    start = (c.back - c.front > want) ? c.back - want : c.front;
+    c.back = start;
+    return true;
+}
+
+// Aligns tiles [start, end) on one backend and appends the results, with
+// batch_id translated back to the index in the whole batch.
+static void RunChunk (ProcessorBackend& backend, const std::vector<filter_tile>& tiles, size_t start, size_t end,
+        uint8_t align_fields, int thresh, std::vector<tile_output>& out) {
+    std::vector<tile_output> chunk_op = backend.send_batch_request(
+            std::vector<filter_tile>(tiles.begin() + start, tiles.begin() + end), align_fields, thresh);
+    for (auto op: chunk_op) {
+        op.batch_id += start;
+        out.push_back(op);
+    }
+}
+
+static void UpdateRate (double& rate, size_t num_tiles, double secs) {
+    if ((num_tiles > 0) && (secs > 0)) {
+        std::lock_guard<std::mutex> lk(hybrid_rate_lock);
+        rate = (1 - HYBRID_RATE_WEIGHT) * rate + HYBRID_RATE_WEIGHT * (num_tiles / secs);
+    }
+}
+
+static size_t HybridInitializeProcessor (int t, int f, char* xclbin) {
+    size_t ret = fpga_backend.initialize(t, f, xclbin);
+    cpu_backend.initialize(t, f, xclbin);
+    return ret;
+}
+
+static void HybridSendRefWriteRequest (size_t start_addr, size_t len) {
+    fpga_backend.send_ref_write_request(start_addr, len);
+    cpu_backend.send_ref_write_request(start_addr, len);
+}
+
+static void HybridSendQueryWriteRequest (size_t start_addr, size_t len) {
+    fpga_backend.send_query_write_request(start_addr, len);
+    cpu_backend.send_query_write_request(start_addr, len);
+}
+
+static void HybridSendQueryPrefetchRequest (size_t start_addr, size_t len) {
+    fpga_backend.send_query_prefetch_request(start_addr, len);
+    cpu_backend.send_query_prefetch_request(start_addr, len);
+}
+
+static void HybridSendRequest (size_t ref_offset, size_t query_offset, size_t ref_length, size_t query_length, uint8_t align_fields) {
+    fpga_backend.send_request(ref_offset, query_offset, ref_length, query_length, align_fields);
+}
+
+std::vector<tile_output> HybridSplitBatch (const std::vector<filter_tile>& tiles, size_t fpga_share, uint8_t align_fields, int thresh,
+        size_t& fpga_tiles) {
+    size_t num_tiles = tiles.size();
+
+    hybrid_cursor cursor;
+    cursor.front = 0;
+    cursor.back = num_tiles;
+
+    std::future<std::vector<tile_output> > fpga_part = std::async(std::launch::async, [&]() {
+        std::vector<tile_output> out;
+        size_t done = 0;
+        size_t want = std::max(fpga_share, (size_t) HYBRID_MIN_FPGA_CHUNK);
+        size_t start, end;
+        auto t0 = std::chrono::steady_clock::now();
+        while (ClaimFront(cursor, want, start, end)) {
+            RunChunk(fpga_backend, tiles, start, end, align_fields, thresh, out);
+            done += end - start;
+            if (end > fpga_share) {
+                hybrid_fpga_stolen += end - std::max(start, fpga_share);
+            }
+            std::lock_guard<std::mutex> lk(cursor.lock);
+            want = std::max((size_t) HYBRID_MIN_FPGA_CHUNK, (cursor.back - std::min(cursor.front, cursor.back)) / 2);
+        }
+        std::chrono::duration<double> secs = std::chrono::steady_clock::now() - t0;
+        UpdateRate(hybrid_fpga_rate, done, secs.count());
+        fpga_tiles = done;
+        return out;
+    });
+
+    std::vector<tile_output> filtered_op;
+    size_t done = 0;
+    size_t start, end;
+    auto t0 = std::chrono::steady_clock::now();
+    while (ClaimBack(cursor, HYBRID_CPU_CHUNK, start, end)) {
+        RunChunk(cpu_backend, tiles, start, end, align_fields, thresh, filtered_op);
+        done += end - start;
+        if (start < fpga_share) {
+            hybrid_cpu_stolen += std::min(end, fpga_share) - start;
+        }
+    }
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - t0;
+    UpdateRate(hybrid_cpu_rate, done, secs.count());
+
+    std::vector<tile_output> fpga_op = fpga_part.get();
+    filtered_op.insert(filtered_op.end(), fpga_op.begin(), fpga_op.end());
+
+    hybrid_num_batches += 1;
+
+    return filtered_op;
+}
+
+static std::vector<tile_output> HybridSendBatchRequest (std::vector<filter_tile> tiles, uint8_t align_fields, int thresh) {
+    size_t num_tiles = tiles.size();
+
+    double fpga_rate, cpu_rate;
+    {
+        std::lock_guard<std::mutex> lk(hybrid_rate_lock);
+        fpga_rate = hybrid_fpga_rate;
+        cpu_rate = hybrid_cpu_rate;
+    }
+
+    int queued, in_flight, num_slots;
+    BSWPoolLoad(queued, in_flight, num_slots);
+    fpga_rate /= 1.0 + (double) (queued + in_flight) / std::max(num_slots, 1);
+
+    // the device share is kept a multiple of the 16-tile padding of a batch
+    size_t fpga_share = (size_t) (num_tiles * fpga_rate / (fpga_rate + cpu_rate));
+    fpga_share = std::min(num_tiles, (fpga_share + 15) / 16 * 16);
+
+    size_t fpga_tiles;
+    return HybridSplitBatch(tiles, fpga_share, align_fields, thresh, fpga_tiles);
+}
+
+static extend_output HybridGACTXRequest (extend_tile tile, uint8_t align_fields) {
+    return fpga_backend.gactx_request(tile, align_fields);
+}
+
+static std::future<extend_output> HybridGACTXSubmit (extend_tile tile, uint8_t align_fields) {
+    return fpga_backend.gactx_submit(tile, align_fields);
+}
+
+static void HybridShutdownProcessor () {
+    fprintf(stderr, "#hybrid filter batches: %lu (tiles stolen by fpga: %lu, by cpu: %lu)\n",
+            hybrid_num_batches.load(), hybrid_fpga_stolen.load(), hybrid_cpu_stolen.load());
+    fprintf(stderr, "#hybrid filter rates: fpga %.0f tiles/s, cpu %.0f tiles/s\n", hybrid_fpga_rate, hybrid_cpu_rate);
+    fpga_backend.shutdown();
+    cpu_backend.shutdown();
+}
+
+ProcessorBackend hybrid_backend = {
+    "hybrid",
+    HybridInitializeProcessor,
+    HybridShutdownProcessor,
+    HybridSendRequest,
+    HybridSendBatchRequest,
+    SendHitBatchAsTiles,
+    HybridGACTXRequest,
+    HybridGACTXSubmit,
+    HybridSendRefWriteRequest,
+    HybridSendQueryWriteRequest,
+    HybridSendQueryPrefetchRequest
+};
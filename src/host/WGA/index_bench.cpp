@@ -0,0 +1,163 @@
+// Construction time of the seed position table: the counting sort of
+// SeedPosTable against the previous construction (serial k-mer extraction,
+// tbb::parallel_sort of (k-mer << 32) + position and a serial pass over the
+// sorted entries), which is kept here as the reference. Both tables are
+// hashed and must be identical.
+//
+// Usage: index_bench [ref_mbp] [num_threads]
+// The reference is synthetic: random bases with lowercase repeats and N gaps,
+// 3000 Mbp by default. The seed shape is read from params.cfg.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include "tbb/task_scheduler_init.h"
+#include "tbb/parallel_sort.h"
+#include "ConfigFile.h"
+#include "ntcoding.h"
+#include "seed_pos_table.h"
+
+#define FNV_OFFSET 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+static double Elapsed (struct timeval& start, struct timeval& end) {
+    return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+}
+
+static uint64_t Hash (uint64_t h, uint64_t value) {
+    return (h ^ value) * FNV_PRIME;
+}
+
+// 10% of the bases in lowercase repeats and one N gap every ~10 Mbp
+static void SyntheticReference (size_t len, std::vector<char>& ref) {
+    const char* bases = "ACGT";
+    const char* lower = "acgt";
+    ref.resize(len);
+    srand(1);
+    size_t i = 0;
+    while (i < len) {
+        int r = rand() % 1000;
+        size_t run = 1 + rand() % 2000;
+        for (size_t j = 0; (j < run) && (i < len); j++, i++) {
+            if (r == 0) {
+                ref[i] = 'N';
+            }
+            else if (r < 100) {
+                ref[i] = lower[rand() % 4];
+            }
+            else {
+                ref[i] = bases[rand() % 4];
+            }
+        }
+    }
+}
+
+// previous SeedPosTable construction; returns the hash of its tables
+static uint64_t SortedTables (char* ref_str, uint32_t ref_length, std::string shape, int kmer_size) {
+    GenerateShapePos(shape);
+
+    uint32_t pos_table_size = ref_length - kmer_size;
+    uint32_t index_table_size = ((uint32_t)1 << 2*kmer_size) + 1;
+    uint32_t* index_table = (uint32_t*) calloc(index_table_size, sizeof(uint32_t));
+    uint64_t* pos_table = (uint64_t*) calloc(pos_table_size, sizeof(uint64_t));
+
+    uint32_t num_index = 0;
+    for (uint32_t i = 0; i < pos_table_size; i++) {
+        uint32_t index = GetKmerIndexAtPos(ref_str, i);
+        if (index != (1u << 31)) {
+            pos_table[num_index++] = ((uint64_t)index << 32) + i;
+        }
+    }
+
+    tbb::parallel_sort(pos_table, pos_table+num_index);
+
+    uint32_t curr_index = 0;
+    for (uint32_t i = 0; i < num_index; i++) {
+        uint32_t pos  = ((pos_table[i] << 32) >> 32);
+        uint32_t seed = (pos_table[i] >> 32);
+        pos_table[i] = pos;
+        if (seed > curr_index) {
+            for (uint32_t s = curr_index; s < seed; s++) {
+                index_table[s] = i;
+            }
+            curr_index = seed;
+        }
+    }
+    for (uint32_t i = curr_index; i < index_table_size; i++) {
+        index_table[i] = num_index;
+    }
+
+    uint64_t h = FNV_OFFSET;
+    for (uint32_t s = 0; s < index_table_size; s++) {
+        h = Hash(h, index_table[s]);
+    }
+    for (uint32_t i = 0; i < num_index; i++) {
+        h = Hash(h, pos_table[i]);
+    }
+
+    free(index_table);
+    free(pos_table);
+    return h;
+}
+
+static uint64_t TableHash (SeedPosTable& sa) {
+    uint32_t index_table_size = sa.GetIndexTableSize();
+    ref_coord_t num_index = sa.GetIndex(index_table_size - 1);
+
+    uint64_t h = FNV_OFFSET;
+    for (uint32_t s = 0; s < index_table_size; s++) {
+        h = Hash(h, sa.GetIndex(s));
+    }
+    for (ref_coord_t i = 0; i < num_index; i++) {
+        h = Hash(h, sa.GetPos(i));
+    }
+    return h;
+}
+
+int main (int argc, char** argv) {
+    long ref_mbp = (argc > 1) ? atol(argv[1]) : 3000;
+    int num_threads = (argc > 2) ? atoi(argv[2]) : tbb::task_scheduler_init::default_num_threads();
+
+    if ((ref_mbp <= 0) || (ref_mbp > 4000) || (num_threads <= 0)) {
+        printf("Usage: %s [ref_mbp] [num_threads]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ConfigFile cfg_file("params.cfg");
+    std::string shape = (std::string) cfg_file.Value("DSOFT_params", "seed_shape");
+    int bin_size = cfg_file.Value("DSOFT_params", "bin_size");
+
+    tbb::task_scheduler_init init(num_threads);
+
+    std::vector<char> ref;
+    SyntheticReference(ref_mbp * 1000000, ref);
+    uint32_t ref_length = ref.size();
+
+    struct timeval start_time, end_time;
+
+    // the counting sort first, while the machine has all of its memory
+    gettimeofday(&start_time, NULL);
+    SeedPosTable* sa = new SeedPosTable(ref.data(), ref_length, shape, bin_size);
+    gettimeofday(&end_time, NULL);
+    double count_secs = Elapsed(start_time, end_time);
+    int kmer_size = sa->GetKmerSize();
+    uint64_t num_positions = sa->GetIndex(sa->GetIndexTableSize() - 1);
+    uint64_t count_hash = TableHash(*sa);
+    delete sa;
+
+    gettimeofday(&start_time, NULL);
+    uint64_t sort_hash = SortedTables(ref.data(), ref_length, shape, kmer_size);
+    gettimeofday(&end_time, NULL);
+    double sort_secs = Elapsed(start_time, end_time);
+
+    printf("reference: %u bp, shape: %s (k = %d), positions: %lu, threads: %d\n", ref_length, shape.c_str(), kmer_size,
+            num_positions, num_threads);
+    printf("sort:          %8.2f s\n", sort_secs);
+    printf("counting sort: %8.2f s  (%.2fx)\n", count_secs, sort_secs / count_secs);
+    printf("tables %s\n", (count_hash == sort_hash) ? "match" : "DIFFER");
+
+    return (count_hash == sort_hash) ? 0 : EXIT_FAILURE;
+}
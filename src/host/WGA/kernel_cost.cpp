@@ -0,0 +1,84 @@
+#include "kernel_cost.h"
+#include <algorithm>
+
+#define BSW_TILE_OVERHEAD_CYCLES 16
+#define BSW_BATCH_OVERHEAD_CYCLES 256
+#define GACTX_TILE_OVERHEAD_CYCLES 64
+#define FIT_MIN_RUNS 8
+
+static uint64_t CeilDiv (uint64_t a, uint64_t b) {
+    return (a + b - 1) / b;
+}
+
+uint64_t BSWTileCycles (size_t ref_len, size_t query_len, int band_size) {
+    uint64_t load = CeilDiv(ref_len, 1 << BSW_BLOCK_WIDTH) + CeilDiv(query_len, 1 << BSW_BLOCK_WIDTH);
+    uint64_t window = std::min((uint64_t) ref_len, (uint64_t) (2 * band_size + BSW_NUM_PE));
+    uint64_t stripes = CeilDiv(query_len, BSW_NUM_PE);
+    return load + stripes * (window + 2 * BSW_NUM_PE) + BSW_NUM_PE + BSW_TILE_OVERHEAD_CYCLES;
+}
+
+uint64_t BSWBatchCycles (size_t num_tiles, uint64_t tile_cycles, uint64_t pad_tile_cycles) {
+    uint64_t num_pad = CeilDiv(num_tiles, BSW_TILES_PER_BEAT) * BSW_TILES_PER_BEAT - num_tiles;
+    // the batch parameters are read a beat of 4 tiles at a time on each
+    // of the 4 AXI ports
+    uint64_t param_beats = CeilDiv(num_tiles + num_pad, 4);
+    return CeilDiv(tile_cycles + num_pad * pad_tile_cycles, BSW_NUM_ARRAYS) + param_beats + BSW_BATCH_OVERHEAD_CYCLES;
+}
+
+uint64_t GACTXTileCycles (size_t ref_len, size_t query_len) {
+    uint64_t load = CeilDiv(ref_len, 1 << GACTX_BLOCK_WIDTH) + CeilDiv(query_len, 1 << GACTX_BLOCK_WIDTH);
+    uint64_t stripes = CeilDiv(query_len, GACTX_NUM_PE);
+    // the traceback walks back one cell per cycle from the max cell
+    uint64_t traceback = ref_len + query_len;
+    return load + stripes * (ref_len + 2 * GACTX_NUM_PE) + traceback + GACTX_TILE_OVERHEAD_CYCLES;
+}
+
+kernel_cost_fit::kernel_cost_fit ()
+    : n(0),
+      sum_x(0),
+      sum_y(0),
+      sum_xx(0),
+      sum_xy(0),
+      predicted_cycles(0),
+      measured_secs(0)
+{
+}
+
+void kernel_cost_fit::Add (uint64_t cycles, double secs) {
+    std::lock_guard<std::mutex> lk(lock);
+    double x = cycles;
+    n++;
+    sum_x += x;
+    sum_y += secs;
+    sum_xx += x * x;
+    sum_xy += x * secs;
+    predicted_cycles += cycles;
+    measured_secs += secs;
+}
+
+void kernel_cost_fit::Get (double& overhead, double& secs_per_cycle) {
+    std::lock_guard<std::mutex> lk(lock);
+    overhead = 0;
+    secs_per_cycle = 1e-6 / KERNEL_CLOCK_MHZ;
+    if (n < FIT_MIN_RUNS) {
+        return;
+    }
+
+    double var = n * sum_xx - sum_x * sum_x;
+    if (var > 1e-9 * sum_xx * n) {
+        secs_per_cycle = (n * sum_xy - sum_x * sum_y) / var;
+        overhead = (sum_y - secs_per_cycle * sum_x) / n;
+    }
+    // all runs of about the same size, or a fit that does not make sense:
+    // keep the overhead at zero and scale the cycles to the measured time
+    if ((var <= 1e-9 * sum_xx * n) || (secs_per_cycle <= 0) || (overhead < 0)) {
+        overhead = 0;
+        secs_per_cycle = sum_y / std::max(sum_x, 1.0);
+    }
+}
+
+double kernel_cost_fit::Predict (uint64_t cycles) {
+    double overhead, secs_per_cycle;
+    Get(overhead, secs_per_cycle);
+    return overhead + cycles * secs_per_cycle;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+// Array parameters of the kernels, as instantiated in BSW_KernelControl.sv
+// (BSW_Array) and GACTX_KernelControl.sv (GACTX_ArrayWrapper). They must be
+// kept in step with the HDL for the cycle estimates to hold.
+#define BSW_NUM_PE 32
+#define BSW_BLOCK_WIDTH 3
+#define BSW_MAX_TILE_SIZE 512
+#define BSW_NUM_ARRAYS 7
+#define BSW_TILES_PER_BEAT 16
+
+#define GACTX_NUM_PE 32
+#define GACTX_BLOCK_WIDTH 3
+#define GACTX_MAX_TILE_SIZE 2048
+
+// Kernel clock used until a fit has been calibrated from measured runs
+#define KERNEL_CLOCK_MHZ 250
+
+// Cycles for one BSW array to align a tile: loading both sequences into the
+// array BRAMs 2^BLOCK_WIDTH bases per cycle, then one pass per stripe of
+// NUM_PE query rows over the reference window of the band, each with NUM_PE
+// cycles to set the stripe up and NUM_PE to drain the systolic array.
+uint64_t BSWTileCycles(size_t ref_len, size_t query_len, int band_size);
+
+// Cycles for a BSW batch of num_tiles tiles with the given total tile cycles.
+// The tiles are spread over the BSW_NUM_ARRAYS arrays, and the batch is padded
+// to whole beats of BSW_TILES_PER_BEAT tiles, which are aligned as well.
+uint64_t BSWBatchCycles(size_t num_tiles, uint64_t tile_cycles, uint64_t pad_tile_cycles);
+
+// Cycles for the GACT-X array to extend a tile. Stripes span the whole
+// reference when ydrop does not end them early, so this is an upper bound
+// and the calibrated slope reflects the average fraction that is computed.
+uint64_t GACTXTileCycles(size_t ref_len, size_t query_len);
+
+// Least-squares fit of measured kernel time against estimated cycles:
+// secs = overhead + cycles * secs_per_cycle. Until enough runs have been
+// measured the fit falls back to KERNEL_CLOCK_MHZ and no overhead.
+struct kernel_cost_fit {
+    kernel_cost_fit ();
+    void Add (uint64_t cycles, double secs);
+    double Predict (uint64_t cycles);
+    void Get (double& overhead, double& secs_per_cycle);
+
+    std::mutex lock;
+    uint64_t n;
+    double sum_x;
+    double sum_y;
+    double sum_xx;
+    double sum_xy;
+    uint64_t predicted_cycles;
+    double measured_secs;
+};
@@ -33,19 +33,19 @@ SOFTWARE.
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
-#include <CL/opencl.h>
-#include <CL/cl_ext.h>
 #include <tbb/task_scheduler_init.h>
 
 #include <zlib.h>
 #include <algorithm>
 #include <iterator>
 #include <vector>
+#include <future>
 #include "ConfigFile.h"
 #include "graph.h"
 #include "kseq.h"
 #include "DRAM.h"
 #include "Processor.h"
+#include "ntcoding.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -61,7 +61,7 @@ SeedPosTable *sa;
 std::vector<std::string> r_chr_id;
 std::vector<uint32_t>  r_chr_len;
 std::vector<uint32_t>  r_chr_len_unpadded;
-std::vector<uint32_t>  r_chr_coord;
+std::vector<ref_coord_t>  r_chr_coord;
 
 FILE* mafFile;
 
@@ -118,11 +118,75 @@ char* RevComp(bond::blob read) {
     return rc;
 }
 
+// A query chromosome loaded into one of the two query slots of g_DRAM. A
+// chromosome longer than a slot is deferred: it stays in the kseq buffer
+// until the previous one has been aligned and then takes the whole query
+// area of g_DRAM.
+struct query_chrom {
+    std::string description;
+    size_t addr;
+    size_t len;
+    size_t padded_len;
+    bool deferred;
+};
+
+// Copies the chromosome last read by kseq_rd to g_DRAM at addr, pads it to
+// WORD_SIZE and starts its upload to the processor
+void PlaceQuery (kseq_t* kseq_rd, size_t addr, query_chrom& q) {
+    memcpy(g_DRAM->buffer + addr, kseq_rd->seq.s, q.len);
+    memset(g_DRAM->buffer + addr + q.len, 'N', q.padded_len - q.len);
+    q.addr = addr;
+    q.deferred = false;
+
+    g_SendQueryPrefetchRequest(q.addr, q.padded_len);
+}
+
+// Reads the next query chromosome into the g_DRAM slot at addr, or defers it
+// if it is longer than slot_size but fits area_size. Returns false at the end
+// of the file.
+bool LoadQuery (kseq_t* kseq_rd, size_t addr, size_t slot_size, size_t area_size, query_chrom& q) {
+    if (kseq_read(kseq_rd) < 0) {
+        return false;
+    }
+
+    size_t seq_len = kseq_rd->seq.l;
+    q.description = std::string(kseq_rd->name.s, kseq_rd->name.l);
+    q.len = seq_len;
+
+    // for padding
+    size_t extra = seq_len % WORD_SIZE;
+    if (extra != 0) {
+        extra = WORD_SIZE - extra;
+    }
+    q.padded_len = seq_len + extra;
+
+    if (q.padded_len > area_size) {
+        fprintf(stderr, "%s (%ld) exceeds the DRAM query size %ld \n", q.description.c_str(), q.padded_len, area_size);
+        exit(EXIT_FAILURE);
+    }
+
+    if (q.padded_len > slot_size) {
+        q.addr = 0;
+        q.deferred = true;
+        return true;
+    }
+
+    PlaceQuery(kseq_rd, addr, q);
+
+    return true;
+}
+
+long ElapsedMsec (struct timeval& start, struct timeval& end) {
+    long useconds = end.tv_usec - start.tv_usec;
+    long seconds = end.tv_sec - start.tv_sec;
+    return ((seconds) * 1000 + useconds/1000.0) + 0.5;
+}
+
 int main(int argc, char** argv)
 {
 
-    if (argc != 2) {
-        printf("Usage: %s <XCLBIN>\n", argv[0]);
+    if (argc > 2) {
+        printf("Usage: %s [XCLBIN]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
@@ -148,6 +212,9 @@ int main(int argc, char** argv)
     cfg.ignore_lower            = cfg_file.Value("DSOFT_params", "ignore_lower");
     cfg.use_transition          = cfg_file.Value("DSOFT_params", "use_transition");
     cfg.hash_size               = cfg_file.Value("DSOFT_params", "hash_size");
+    cfg.index_file              = (std::string) cfg_file.Value("DSOFT_params", "index_file", "");
+    cfg.index_populate          = (double) cfg_file.Value("DSOFT_params", "index_populate", 0.0) != 0;
+    cfg.index_hugepages         = (double) cfg_file.Value("DSOFT_params", "index_hugepages", 0.0) != 0;
 
     // GACT scoring
     cfg.gact_sub_mat[0]  = cfg_file.Value("Scoring", "sub_AA");
@@ -174,6 +241,13 @@ int main(int argc, char** argv)
     cfg.extension_threshold = cfg_file.Value("GACTX_params", "extension_threshold");
     cfg.tile_size    = cfg_file.Value("GACTX_params", "tile_size");
     cfg.tile_overlap = cfg_file.Value("GACTX_params", "tile_overlap");
+    cfg.tb_rle       = (double) cfg_file.Value("GACTX_params", "tb_rle", 0.0) != 0;
+
+    // Processor backend
+    cfg.processor    = (std::string) cfg_file.Value("Processor", "backend", "fpga");
+    cfg.packed_seq   = (double) cfg_file.Value("Processor", "packed_seq", 0.0) != 0;
+    cfg.hit_tiles    = (double) cfg_file.Value("Processor", "hit_tiles", 0.0) != 0;
+    cfg.num_devices  = (double) cfg_file.Value("Processor", "num_devices", 0.0);
 
     // Multi-threading
     cfg.num_threads  = cfg_file.Value("Multithreading", "num_threads");
@@ -194,7 +268,46 @@ int main(int argc, char** argv)
     tbb::task_scheduler_init init(nthreads);
     fprintf(stderr, "\nUsing %d threads ...\n", cfg.num_threads);
 
-    g_InitializeProcessor (0, 0, argv[1]);
+    SelectProcessor(cfg.processor);
+
+    // D-SOFT keeps HIT_OFFSET_BITS of query offset within a chunk
+    if ((uint64_t) cfg.chunk_size > ((uint64_t) 1 << HIT_OFFSET_BITS)) {
+        fprintf(stderr, "Error: chunk_size exceeds %lu\n", (uint64_t) 1 << HIT_OFFSET_BITS);
+        return EXIT_FAILURE;
+    }
+    // Packed2Nt is not yet in the sequence fill paths of the BSW and GACT-X
+    // kernels, which would read packed sequences as ASCII
+    if (cfg.packed_seq && (cfg.processor != "cpu")) {
+        fprintf(stderr, "Error: packed_seq is not supported by the kernels of the %s processor backend\n", cfg.processor.c_str());
+        return EXIT_FAILURE;
+    }
+#ifdef WIDE_COORD
+    if (cfg.processor != "cpu") {
+        fprintf(stderr, "Error: wide reference coordinates are only supported by the cpu processor backend\n");
+        return EXIT_FAILURE;
+    }
+#endif
+
+    char* xclbin = (argc == 2) ? argv[1] : NULL;
+    if ((cfg.processor != "cpu") && (xclbin == NULL)) {
+        fprintf(stderr, "Error: the %s processor backend requires an XCLBIN\n", cfg.processor.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // Startup runs as four tasks joined only on their data dependencies:
+    // programming the device overlaps reading the reference, and once both
+    // are done the reference upload to the banks overlaps the construction of
+    // the seed position table
+    struct timeval startup_time;
+    gettimeofday(&startup_time, NULL);
+
+    std::future<void> processor_ready = std::async(std::launch::async, [xclbin]() {
+        struct timeval t_start, t_end;
+        gettimeofday(&t_start, NULL);
+        g_InitializeProcessor (0, 0, xclbin);
+        gettimeofday(&t_end, NULL);
+        fprintf(stderr, "Time elapsed (initializing processor): %ld msec \n", ElapsedMsec(t_start, t_end));
+    });
 
     /////////// USER LOGIC ////////////////////
     g_DRAM = new DRAM;
@@ -216,7 +329,13 @@ int main(int argc, char** argv)
         // for padding
         size_t extra = seq_len % WORD_SIZE;
 
+        // offsets within a chromosome are 32-bit in both coordinate modes
+        if (seq_len > UINT32_MAX) {
+            fprintf(stderr, "%s (%lu) exceeds the maximum chromosome length\n", description.c_str(), seq_len);
+            exit(EXIT_FAILURE);
+        }
         if (g_DRAM->bufferPosition + seq_len + extra > g_DRAM->size) {
+            fprintf(stderr, "Reference exceeds the DRAM size %lu\n", g_DRAM->size);
             exit(EXIT_FAILURE); 
         }
         
@@ -234,9 +353,7 @@ int main(int argc, char** argv)
         
     }
     g_DRAM->referenceSize = g_DRAM->bufferPosition;
-
-    // transfer reference to FPGA DRAM
-    g_SendRefWriteRequest (0, g_DRAM->referenceSize);
+    BuildChrEndTable(r_chr_coord, r_chr_len);
 
     gzclose(f_rd);
         
@@ -248,11 +365,44 @@ int main(int argc, char** argv)
 
     fprintf(stderr, "Time elapsed (loading reference): %ld msec \n", mseconds);
 
-    fprintf(stderr, "\nConstructing seed position table ...\n");
+    // transfer reference to FPGA DRAM once the device is programmed; the
+    // seed position table below only needs the reference in g_DRAM
+    std::future<void> reference_sent = std::async(std::launch::async, [&processor_ready]() {
+        processor_ready.get();
+        struct timeval t_start, t_end;
+        gettimeofday(&t_start, NULL);
+        g_SendRefWriteRequest (0, g_DRAM->referenceSize);
+        gettimeofday(&t_end, NULL);
+        fprintf(stderr, "Time elapsed (sending reference): %ld msec \n", ElapsedMsec(t_start, t_end));
+    });
 
     gettimeofday(&start_time, NULL);
 
-    sa = new SeedPosTable (g_DRAM->buffer, g_DRAM->referenceSize, cfg.seed_shape_str, cfg.bin_size);
+    // with index_file, the table is mapped from the index built by an
+    // earlier run with the same reference, seed shape and bin size, or
+    // built and written there for the next run
+    sa = NULL;
+    uint64_t ref_checksum = 0;
+    if (cfg.index_file != "") {
+        ref_checksum = SeedIndexChecksum(g_DRAM->buffer, g_DRAM->referenceSize);
+        sa = new SeedPosTable();
+        if (sa->MapIndex(cfg.index_file, ref_checksum, g_DRAM->referenceSize, cfg.seed_shape_str, cfg.bin_size,
+                    cfg.seed_occurence_multiple, cfg.index_populate, cfg.index_hugepages)) {
+            fprintf(stderr, "\nMapped seed position table from %s\n", cfg.index_file.c_str());
+        }
+        else {
+            delete sa;
+            sa = NULL;
+        }
+    }
+
+    if (sa == NULL) {
+        fprintf(stderr, "\nConstructing seed position table ...\n");
+        sa = new SeedPosTable (g_DRAM->buffer, g_DRAM->referenceSize, cfg.seed_shape_str, cfg.bin_size, cfg.seed_occurence_multiple);
+        if ((cfg.index_file != "") && sa->WriteIndex(cfg.index_file, ref_checksum, cfg.seed_shape_str)) {
+            fprintf(stderr, "Wrote seed position table to %s\n", cfg.index_file.c_str());
+        }
+    }
 
     gettimeofday(&end_time, NULL);
 
@@ -262,6 +412,23 @@ int main(int argc, char** argv)
 
     fprintf(stderr, "Time elapsed (constructing seed position table): %ld msec \n", mseconds);
 
+    // k-mers dropped by seed_occurence_multiple and the most frequent of them
+    if (sa->GetNumMaskedKmers() > 0) {
+        uint64_t num_masked = sa->GetNumMaskedPositions();
+        uint64_t num_positions = num_masked + sa->GetIndex(sa->GetIndexTableSize() - 1);
+        fprintf(stderr, "Masked %u seed k-mers occurring more than %lu times (%lu of %lu positions, %.2f%%)\n",
+                sa->GetNumMaskedKmers(), (uint64_t) sa->GetMaxOccurrences(), num_masked, num_positions,
+                100.0 * num_masked / num_positions);
+        for (auto m: sa->GetTopMasked()) {
+            fprintf(stderr, "  %s: %lu\n", IndexToKmer(m.first, sa->GetKmerSize()).c_str(), (uint64_t) m.second);
+        }
+    }
+
+    reference_sent.get();
+
+    gettimeofday(&end_time, NULL);
+    fprintf(stderr, "Time elapsed (startup): %ld msec \n", ElapsedMsec(startup_time, end_time));
+
     fprintf(stderr, "\nLoading query ...\n");
     
     gettimeofday(&start_time, NULL);
@@ -269,42 +436,46 @@ int main(int argc, char** argv)
     if (!f_rd) { fprintf(stderr, "cant open file: %s\n", cfg.query_filename.c_str()); exit(EXIT_FAILURE); }
         
     kseq_rd = kseq_init(f_rd);
-    
-    while (kseq_read(kseq_rd) >= 0) {
-        // reset bufferPosition to end of reference
-        g_DRAM->bufferPosition = g_DRAM->referenceSize;
 
-        size_t seq_len = kseq_rd->seq.l;
-        std::string description = std::string(kseq_rd->name.s, kseq_rd->name.l);
+    // The rest of g_DRAM holds two query slots: the next chromosome is read
+    // into one and uploaded while the current one, in the other, is aligned.
+    // A chromosome longer than a slot uses the whole area, without overlap.
+    size_t query_area_size = (g_DRAM->size - g_DRAM->referenceSize) / WORD_SIZE * WORD_SIZE;
+    size_t query_slot_size = query_area_size / 2 / WORD_SIZE * WORD_SIZE;
+    size_t query_slot_addr[2] = {g_DRAM->referenceSize, g_DRAM->referenceSize + query_slot_size};
+    int slot = 0;
+
+    fprintf(stderr, "Query chromosomes up to %lu bp are loaded while the previous one is aligned, up to %lu bp after it\n",
+            query_slot_size, query_area_size);
+
+    query_chrom next_query;
+    bool have_next = LoadQuery(kseq_rd, query_slot_addr[slot], query_slot_size, query_area_size, next_query);
+
+    while (have_next) {
+        query_chrom query = next_query;
+        std::string description = query.description;
+
+        bool deferred = query.deferred;
+        if (deferred) {
+            fprintf(stderr, "%s (%lu) exceeds the DRAM query slot size %lu, loading it without overlap\n",
+                    description.c_str(), query.padded_len, query_slot_size);
+            PlaceQuery(kseq_rd, g_DRAM->referenceSize, query);
+        }
+        size_t seq_len = query.len;
 
         fprintf(stderr, "Starting %s ...\n", description.c_str());
-        
-        // for padding
-        size_t extra = seq_len % WORD_SIZE;
 
-        if (g_DRAM->bufferPosition + seq_len + extra > g_DRAM->size) {
-            fprintf(stderr, "%ld exceeds DRAM size %ld \n", g_DRAM->bufferPosition + seq_len + extra, g_DRAM->size);
-            exit(EXIT_FAILURE); 
-        }
-        
-        memcpy(g_DRAM->buffer + g_DRAM->bufferPosition, kseq_rd->seq.s, seq_len);
-        
-        bond::blob chrom_seq = bond::blob(g_DRAM->buffer + g_DRAM->bufferPosition, seq_len);
+        bond::blob chrom_seq = bond::blob(g_DRAM->buffer + query.addr, seq_len);
         char *rev_read_char = RevComp(chrom_seq);
         bond::blob chrom_rc_seq = bond::blob(rev_read_char, seq_len);
 
-        if (extra != 0)
-        {
-            extra = WORD_SIZE - extra;
-            memset(g_DRAM->buffer + g_DRAM->bufferPosition + seq_len, 'N', extra);
-
-            seq_len += extra;
-        }
-        
-        g_DRAM->bufferPosition += seq_len;
+        // make the query current on the processor; waits for its upload
+        g_SendQueryWriteRequest (query.addr, query.padded_len);
 
-        //send query to FPGA DRAM
-        g_SendQueryWriteRequest (g_DRAM->referenceSize, seq_len);
+        // load the next chromosome while this one is aligned, or after it
+        // if this one spans both slots and is still in the kseq buffer
+        std::future<bool> next_loaded = std::async(deferred ? std::launch::deferred : std::launch::async, LoadQuery, kseq_rd,
+                query_slot_addr[1 - slot], query_slot_size, query_area_size, std::ref(next_query));
         
         std::vector<seed_interval> interval_list;
         interval_list.clear();
@@ -388,6 +559,9 @@ int main(int argc, char** argv)
         delete[] rev_read_char;
 
         fclose(mafFile);
+
+        have_next = next_loaded.get();
+        slot = 1 - slot;
     }
 
 
@@ -403,7 +577,10 @@ int main(int argc, char** argv)
 
     fprintf(stderr, "#seeds: %lu \n", seeder_body::num_seeds.load());
     fprintf(stderr, "#seed hits: %lu \n", seeder_body::num_seed_hits.load());
+    fprintf(stderr, "#masked seed k-mers: %u (%lu positions) \n", sa->GetNumMaskedKmers(), (uint64_t) sa->GetNumMaskedPositions());
     fprintf(stderr, "#filter tiles: %lu \n", filter_body::num_filter_tiles.load());
+    fprintf(stderr, "#filter tiles (fpga): %lu \n", g_fpga_filter_tiles.load());
+    fprintf(stderr, "#filter tiles (cpu): %lu \n", g_cpu_filter_tiles.load());
     fprintf(stderr, "#anchors: %lu \n", filter_body::num_anchors.load());
     fprintf(stderr, "#extend tiles: %lu \n", extender_body::num_extend_tiles.load());
 
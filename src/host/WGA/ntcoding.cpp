@@ -54,6 +54,15 @@ uint32_t KmerToIndex(std::string kmer) {
     return index;
 }
 
+std::string IndexToKmer(uint32_t index, int kmer_size) {
+    std::string kmer(kmer_size, 'N');
+    for (int i = kmer_size - 1; i >= 0; i--) {
+        kmer[i] = "ACGT"[index & 3];
+        index >>= 2;
+    }
+    return kmer;
+}
+
 void GenerateShapePos (std::string shape) {
     shape_size = 0;
     int j = 0;
@@ -71,7 +80,7 @@ void GenerateShapePos (std::string shape) {
     }
 }
 
-uint32_t GetKmerIndexAtPos (char* sequence, uint32_t pos) {
+uint32_t GetKmerIndexAtPos (char* sequence, size_t pos) {
     uint32_t kmer = 0;
     for (int i = 0; i < shape_size; i++) {
             uint32_t nt = NtChar2Int(sequence[pos+shape_pos[i]]);
@@ -17,6 +17,7 @@ uint32_t NtChar2IntCaseInsensitive (char nt);
 uint32_t TransitionNt (uint32_t nt);
 void GenerateShapePos(std::string shape);
 uint32_t KmerToIndex(std::string kmer);
-uint32_t GetKmerIndexAtPos(char* sequence, uint32_t pos);
+std::string IndexToKmer(uint32_t index, int kmer_size);
+uint32_t GetKmerIndexAtPos(char* sequence, size_t pos);
 int IsTransitionAtPos(int t);
 
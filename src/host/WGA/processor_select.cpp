@@ -0,0 +1,96 @@
+#include "Processor.h"
+#include "graph.h"
+#include <stdlib.h>
+
+DRAM *g_DRAM = nullptr;
+
+InitializeProcessor_ptr g_InitializeProcessor = nullptr;
+ShutdownProcessor_ptr g_ShutdownProcessor = nullptr;
+SendRequest_ptr g_SendRequest = nullptr;
+SendBatchRequest_ptr g_SendBatchRequest = nullptr;
+SendHitBatchRequest_ptr g_SendHitBatchRequest = nullptr;
+GACTXRequest_ptr g_GACTXRequest = nullptr;
+GACTXSubmit_ptr g_GACTXSubmit = nullptr;
+SendRefWriteRequest_ptr g_SendRefWriteRequest = nullptr;
+SendQueryWriteRequest_ptr g_SendQueryWriteRequest = nullptr;
+SendQueryPrefetchRequest_ptr g_SendQueryPrefetchRequest = nullptr;
+
+std::atomic<uint64_t> g_fpga_filter_tiles(0);
+std::atomic<uint64_t> g_cpu_filter_tiles(0);
+
+std::vector<ref_coord_t> g_chr_ends;
+
+static ProcessorBackend* backends[] = {
+#ifdef WITH_OPENCL
+    &fpga_backend,
+    &hybrid_backend,
+#endif
+    &cpu_backend
+};
+
+void SelectProcessor (std::string name) {
+    ProcessorBackend* backend = nullptr;
+
+    for (auto b: backends) {
+        if (name == b->name) {
+            backend = b;
+        }
+    }
+
+    if (backend == nullptr) {
+        fprintf(stderr, "Error: unknown processor backend '%s'. Available:", name.c_str());
+        for (auto b: backends) {
+            fprintf(stderr, " %s", b->name);
+        }
+        fprintf(stderr, "\n");
+        exit(1);
+    }
+
+    fprintf(stderr, "Selected processor backend: %s\n", backend->name);
+
+    g_InitializeProcessor = backend->initialize;
+    g_ShutdownProcessor = backend->shutdown;
+    g_SendRequest = backend->send_request;
+    g_SendBatchRequest = backend->send_batch_request;
+    g_SendHitBatchRequest = backend->send_hit_batch_request;
+    g_GACTXRequest = backend->gactx_request;
+    g_GACTXSubmit = backend->gactx_submit;
+    g_SendRefWriteRequest = backend->send_ref_write_request;
+    g_SendQueryWriteRequest = backend->send_query_write_request;
+    g_SendQueryPrefetchRequest = backend->send_query_prefetch_request;
+}
+
+void BuildChrEndTable (const std::vector<ref_coord_t>& chr_coord, const std::vector<uint32_t>& chr_len) {
+    g_chr_ends.clear();
+    for (size_t i = 0; i < chr_len.size(); i++) {
+        g_chr_ends.push_back(chr_coord[i] + chr_len[i]);
+    }
+    g_chr_ends.push_back(~(ref_coord_t) 0);
+}
+
+// Hits lie inside a chromosome, so the chromosome end is the first end
+// above the hit
+filter_tile HitTile (const seed_hit& hit, size_t query_len, size_t tile_size, bool reverse) {
+    ref_coord_t chr_end = *std::upper_bound(g_chr_ends.cbegin(), g_chr_ends.cend(), hit.reference_offset);
+
+    ref_coord_t ref_tile_start = (hit.reference_offset < tile_size/2) ? 0 : hit.reference_offset - tile_size/2;
+    uint32_t query_tile_start = (hit.query_offset < tile_size/2) ? 0 : hit.query_offset - tile_size/2;
+
+    uint32_t ref_tile_size = std::min(ref_coord_t(tile_size), (chr_end - ref_tile_start));
+    uint32_t query_tile_size = std::min(tile_size, (query_len - query_tile_start));
+
+    size_t query_offset = reverse ? query_len - (query_tile_start + query_tile_size) : query_tile_start;
+
+    return filter_tile(ref_tile_start, query_offset, ref_tile_size, query_tile_size, query_tile_start);
+}
+
+std::vector<tile_output> SendHitBatchAsTiles (std::vector<seed_hit> hits, size_t query_len, uint8_t align_fields, int thresh) {
+    bool reverse = (align_fields & reverse_query);
+
+    std::vector<filter_tile> tiles;
+    tiles.reserve(hits.size());
+    for (auto h: hits) {
+        tiles.push_back(HitTile(h, query_len, cfg.first_tile_size, reverse));
+    }
+    return g_SendBatchRequest(tiles, align_fields, thresh);
+}
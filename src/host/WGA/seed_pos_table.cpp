@@ -1,17 +1,70 @@
 #include "ntcoding.h"
 #include "seed_pos_table.h"
 #include "tbb/parallel_scan.h"
-#include "tbb/parallel_sort.h"
 #include "tbb/blocked_range.h"
 #include "tbb/scalable_allocator.h"
+#include "tbb/parallel_for.h"
 #include <algorithm>
 #include <atomic>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FNV_OFFSET 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+#define CHECKSUM_BLOCK (1 << 20)
+
+// reference positions per chunk and k-mer bits of the coarse buckets of the
+// table construction; the remaining fine bits must fit 16 bits
+#define POS_CHUNK (1 << 20)
+#define COARSE_BITS 12
+#define MAX_FINE_BITS 16
+
+// bytes per entry of the high tables, beyond the low 32 bits
+#define COORD_HI_BYTES ((REF_COORD_BITS - 32) / 8)
+
+// FNV-1a of every 1 MB block in parallel, folded in order with the length
+uint64_t SeedIndexChecksum (const char* ref_str, ref_coord_t ref_length) {
+    size_t num_blocks = ((size_t) ref_length + CHECKSUM_BLOCK - 1) / CHECKSUM_BLOCK;
+    std::vector<uint64_t> block_hash(num_blocks);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_blocks), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t b = r.begin(); b < r.end(); b++) {
+            size_t end = std::min((size_t) ref_length, (b + 1) * CHECKSUM_BLOCK);
+            uint64_t h = FNV_OFFSET;
+            for (size_t i = b * CHECKSUM_BLOCK; i < end; i++) {
+                h = (h ^ (uint8_t) ref_str[i]) * FNV_PRIME;
+            }
+            block_hash[b] = h;
+        }
+    });
+
+    uint64_t h = (FNV_OFFSET ^ ref_length) * FNV_PRIME;
+    for (size_t b = 0; b < num_blocks; b++) {
+        h = (h ^ block_hash[b]) * FNV_PRIME;
+    }
+    return h;
+}
 
 SeedPosTable::SeedPosTable() {
     ref_size_ = 0;
     kmer_size_ = 0;
     shape_size_ = 0;
     bin_size_ = 0;
+    index_table_size_ = 0;
+    index_table_ = NULL;
+    index_hi_table_ = NULL;
+    pos_table_ = NULL;
+    pos_hi_table_ = NULL;
+    occurrence_multiple_ = 0;
+    max_occurrences_ = 0;
+    num_masked_kmers_ = 0;
+    num_masked_positions_ = 0;
+    map_addr_ = NULL;
+    map_size_ = 0;
 }
 
 int SeedPosTable::GetKmerSize() {
@@ -22,7 +75,27 @@ int SeedPosTable::GetShapeSize() {
     return shape_size_;
 }
 
-SeedPosTable::SeedPosTable(char* ref_str, uint32_t ref_length, std::string shape, int bin_size) {
+uint32_t SeedPosTable::GetIndexTableSize() {
+    return index_table_size_;
+}
+
+ref_coord_t SeedPosTable::GetMaxOccurrences() {
+    return max_occurrences_;
+}
+
+uint32_t SeedPosTable::GetNumMaskedKmers() {
+    return num_masked_kmers_;
+}
+
+ref_coord_t SeedPosTable::GetNumMaskedPositions() {
+    return num_masked_positions_;
+}
+
+const std::vector<std::pair<uint32_t, ref_coord_t> >& SeedPosTable::GetTopMasked() {
+    return top_masked_;
+}
+
+SeedPosTable::SeedPosTable(char* ref_str, ref_coord_t ref_length, std::string shape, int bin_size, int occurrence_multiple) {
     shape_size_ = shape.length(); 
     int kmer_size = 0;
     for (int i = 0; i < shape_size_; i++) {
@@ -35,52 +108,360 @@ SeedPosTable::SeedPosTable(char* ref_str, uint32_t ref_length, std::string shape
     kmer_size_ = kmer_size;
     ref_size_ = ref_length;
     bin_size_ = bin_size;
+    index_hi_table_ = NULL;
+    pos_hi_table_ = NULL;
+    map_addr_ = NULL;
+    map_size_ = 0;
 
     GenerateShapePos(shape);
 
-    uint32_t pos_table_size = ref_size_ - kmer_size_;
-    assert(pos_table_size < ((uint64_t)1 << 32));
+    ref_coord_t pos_table_size = ref_size_ - kmer_size_;
+    assert((uint64_t) pos_table_size < ((uint64_t)1 << REF_COORD_BITS));
 
     index_table_size_ = ((uint32_t)1 << 2*kmer_size) + 1;
     index_table_ = (uint32_t*) calloc(index_table_size_, sizeof(uint32_t));
-    pos_table_ = (uint64_t*) calloc(pos_table_size, sizeof(uint64_t));
+#ifdef WIDE_COORD
+    index_hi_table_ = (uint8_t*) calloc(index_table_size_, sizeof(uint8_t));
+#endif
 
-    uint32_t num_index = 0;
+    // Counting sort over the dense 4^k k-mer space, in two levels so that
+    // the scatter stays in cache: the positions are first distributed by the
+    // top COARSE_BITS of their k-mer into coarse buckets, and each coarse
+    // bucket is then counting-sorted by the remaining fine bits on its own.
+    //
+    // The reference is cut into chunks. The first pass counts the positions
+    // of every chunk per coarse bucket, a prefix sum over (bucket, chunk)
+    // gives every chunk its own slice of each coarse bucket, and the second
+    // pass writes the positions into those slices of pos_table_ and their
+    // fine k-mer bits into a transient 16-bit array. Both levels are stable,
+    // so the positions of a k-mer stay in ascending order.
+    int coarse_bits = std::min(2*kmer_size, std::max(COARSE_BITS, 2*kmer_size - MAX_FINE_BITS));
+    int fine_bits = 2*kmer_size - coarse_bits;
+    uint32_t num_coarse = (uint32_t)1 << coarse_bits;
+    uint32_t fine_mask = ((uint32_t)1 << fine_bits) - 1;
+    uint32_t num_chunks = (pos_table_size + POS_CHUNK - 1) / POS_CHUNK;
 
-    for (uint32_t i = 0; i < pos_table_size; i++) {
-        uint32_t index = GetKmerIndexAtPos(ref_str, i); 
-        if (index != (1 << 31)) {
-            pos_table_[num_index++] = ((uint64_t)index << 32) + i;
+    std::vector<ref_coord_t> chunk_pos((size_t) num_chunks * num_coarse, 0);
+
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, num_chunks), [&](const tbb::blocked_range<uint32_t>& r) {
+        for (uint32_t c = r.begin(); c < r.end(); c++) {
+            ref_coord_t* hist = &chunk_pos[(size_t) c * num_coarse];
+            ref_coord_t end = std::min((uint64_t) pos_table_size, (uint64_t) (c + 1) * POS_CHUNK);
+            for (ref_coord_t i = (ref_coord_t) c * POS_CHUNK; i < end; i++) {
+                uint32_t index = GetKmerIndexAtPos(ref_str, i);
+                if (index != (1u << 31)) {
+                    hist[index >> fine_bits]++;
+                }
+            }
+        }
+    });
+
+    // coarse_start[b] is the first entry of coarse bucket b
+    std::vector<ref_coord_t> coarse_start(num_coarse + 1);
+    ref_coord_t num_index = 0;
+    for (uint32_t b = 0; b < num_coarse; b++) {
+        coarse_start[b] = num_index;
+        for (uint32_t c = 0; c < num_chunks; c++) {
+            ref_coord_t count = chunk_pos[(size_t) c * num_coarse + b];
+            chunk_pos[(size_t) c * num_coarse + b] = num_index;
+            num_index += count;
         }
     }
+    coarse_start[num_coarse] = num_index;
 
+    size_t num_entries = std::max(num_index, (ref_coord_t) 1);
+    pos_table_ = (uint32_t*) malloc(num_entries * sizeof(uint32_t));
+#ifdef WIDE_COORD
+    pos_hi_table_ = (uint8_t*) malloc(num_entries * sizeof(uint8_t));
+#endif
+    uint16_t* fine_index = (uint16_t*) malloc(num_entries * sizeof(uint16_t));
 
-    tbb::parallel_sort(pos_table_, pos_table_+num_index);
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, num_chunks), [&](const tbb::blocked_range<uint32_t>& r) {
+        for (uint32_t c = r.begin(); c < r.end(); c++) {
+            ref_coord_t* next = &chunk_pos[(size_t) c * num_coarse];
+            ref_coord_t end = std::min((uint64_t) pos_table_size, (uint64_t) (c + 1) * POS_CHUNK);
+            for (ref_coord_t i = (ref_coord_t) c * POS_CHUNK; i < end; i++) {
+                uint32_t index = GetKmerIndexAtPos(ref_str, i);
+                if (index != (1u << 31)) {
+                    ref_coord_t e = next[index >> fine_bits]++;
+                    SetPos(e, i);
+                    fine_index[e] = index & fine_mask;
+                }
+            }
+        }
+    });
 
-    uint32_t curr_index = 0;
-    uint32_t seed, pos; 
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, num_coarse), [&](const tbb::blocked_range<uint32_t>& r) {
+        std::vector<ref_coord_t> fine_pos(fine_mask + 1);
+        std::vector<ref_coord_t> bucket;
+        for (uint32_t b = r.begin(); b < r.end(); b++) {
+            ref_coord_t start = coarse_start[b];
+            ref_coord_t size = coarse_start[b+1] - start;
+            uint16_t* fine = fine_index + start;
 
-    for (uint32_t i = 0; i < num_index; i++) {
-        pos  = ((pos_table_[i] << 32) >> 32);
-        seed = (pos_table_[i] >> 32);
-        pos_table_[i] = pos;
-        if (seed > curr_index) {
-            for (uint32_t s = curr_index; s < seed; s++) {
-                index_table_[s] = i;
+            std::fill(fine_pos.begin(), fine_pos.end(), 0);
+            for (ref_coord_t e = 0; e < size; e++) {
+                fine_pos[fine[e]]++;
+            }
+
+            // entry s of the index table is the end of the bucket of k-mer s
+            uint32_t first_kmer = b << fine_bits;
+            ref_coord_t sum = 0;
+            for (uint32_t f = 0; f <= fine_mask; f++) {
+                ref_coord_t count = fine_pos[f];
+                fine_pos[f] = sum;
+                sum += count;
+                SetIndex(first_kmer + f, start + sum);
+            }
+
+            bucket.resize(size);
+            for (ref_coord_t e = 0; e < size; e++) {
+                bucket[fine_pos[fine[e]]++] = GetPos(start + e);
+            }
+            for (ref_coord_t e = 0; e < size; e++) {
+                SetPos(start + e, bucket[e]);
             }
-            curr_index = seed;
         }
+    });
+
+    free(fine_index);
+    SetIndex(index_table_size_ - 1, num_index);
+
+    MaskFrequentKmers(occurrence_multiple);
+}
+
+// most occurrences first, then by k-mer
+static inline bool CompareMasked (std::pair<uint32_t, ref_coord_t> m1, std::pair<uint32_t, ref_coord_t> m2) {
+    return ((m1.second > m2.second) || ((m1.second == m2.second) && (m1.first < m2.first)));
+}
+
+// Satellites and transposons give a few k-mers far more positions than the
+// rest, and every query seed matching one of them floods the filter with
+// hits. Their buckets are dropped and the position table is compacted in
+// place, keeping the positions of the other k-mers in order.
+void SeedPosTable::MaskFrequentKmers(int occurrence_multiple) {
+    occurrence_multiple_ = occurrence_multiple;
+    max_occurrences_ = 0;
+    num_masked_kmers_ = 0;
+    num_masked_positions_ = 0;
+    top_masked_.clear();
+
+    if (occurrence_multiple <= 0) {
+        return;
     }
-    
-    for (uint32_t i = curr_index; i < index_table_size_; i++) {
-        index_table_[i] = num_index;
+
+    uint32_t num_kmers = index_table_size_ - 1;
+    double mean = std::max(1.0, (double) GetIndex(num_kmers) / num_kmers);
+    max_occurrences_ = (ref_coord_t) (occurrence_multiple * mean);
+
+    std::vector<std::pair<uint32_t, ref_coord_t> > masked;
+    ref_coord_t start = 0;
+    ref_coord_t num_index = 0;
+    for (uint32_t s = 0; s < num_kmers; s++) {
+        ref_coord_t end = GetIndex(s);
+        ref_coord_t count = end - start;
+        if (count > max_occurrences_) {
+            masked.push_back(std::make_pair(s, count));
+            num_masked_positions_ += count;
+        }
+        else {
+            if (num_index != start) {
+                memmove(pos_table_ + num_index, pos_table_ + start, count * sizeof(uint32_t));
+#ifdef WIDE_COORD
+                memmove(pos_hi_table_ + num_index, pos_hi_table_ + start, count * sizeof(uint8_t));
+#endif
+            }
+            num_index += count;
+        }
+        SetIndex(s, num_index);
+        start = end;
+    }
+    SetIndex(num_kmers, num_index);
+    num_masked_kmers_ = masked.size();
+
+    if (num_masked_kmers_ > 0) {
+        size_t num_entries = std::max(num_index, (ref_coord_t) 1);
+        pos_table_ = (uint32_t*) realloc(pos_table_, num_entries * sizeof(uint32_t));
+#ifdef WIDE_COORD
+        pos_hi_table_ = (uint8_t*) realloc(pos_hi_table_, num_entries * sizeof(uint8_t));
+#endif
     }
 
+    size_t num_top = std::min(masked.size(), (size_t) MAX_TOP_MASKED);
+    std::partial_sort(masked.begin(), masked.begin() + num_top, masked.end(), CompareMasked);
+    top_masked_.assign(masked.begin(), masked.begin() + num_top);
 }
 
 SeedPosTable::~SeedPosTable() {
-    free(index_table_);
-    free(pos_table_);
+    if (map_addr_ != NULL) {
+        munmap(map_addr_, map_size_);
+    }
+    else {
+        free(index_table_);
+        free(index_hi_table_);
+        free(pos_table_);
+        free(pos_hi_table_);
+    }
+}
+
+bool SeedPosTable::MapIndex(std::string filename, uint64_t ref_checksum, ref_coord_t ref_length, std::string shape, int bin_size,
+        int occurrence_multiple, bool populate, bool hugepages) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    seed_index_header hdr;
+    if ((fstat(fd, &st) != 0) || (pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr))) {
+        fprintf(stderr, "Seed index %s is truncated\n", filename.c_str());
+        close(fd);
+        return false;
+    }
+
+    const char* mismatch = NULL;
+    if ((memcmp(hdr.magic, SEED_INDEX_MAGIC, sizeof(hdr.magic)) != 0) || (hdr.header_size != sizeof(hdr))) {
+        mismatch = "not a seed index";
+    }
+    else if (hdr.version != SEED_INDEX_VERSION) {
+        mismatch = "index version";
+    }
+    else if (hdr.coord_bits != REF_COORD_BITS) {
+        mismatch = "coordinate width";
+    }
+    else if ((hdr.ref_checksum != ref_checksum) || (hdr.ref_size != ref_length)) {
+        mismatch = "reference";
+    }
+    else if ((strncmp(hdr.shape, shape.c_str(), SEED_INDEX_MAX_SHAPE) != 0) || (shape.length() >= SEED_INDEX_MAX_SHAPE)) {
+        mismatch = "seed shape";
+    }
+    else if (hdr.bin_size != bin_size) {
+        mismatch = "bin size";
+    }
+    else if (hdr.occurrence_multiple != std::max(occurrence_multiple, 0)) {
+        mismatch = "seed occurrence multiple";
+    }
+    else if ((hdr.file_size != (uint64_t) st.st_size) ||
+            (hdr.index_table_offset + (uint64_t) hdr.index_table_size * sizeof(uint32_t) > hdr.file_size) ||
+            (hdr.index_hi_table_offset + (uint64_t) hdr.index_table_size * COORD_HI_BYTES > hdr.file_size) ||
+            (hdr.pos_table_offset + hdr.num_positions * sizeof(uint32_t) > hdr.file_size) ||
+            (hdr.pos_hi_table_offset + hdr.num_positions * COORD_HI_BYTES > hdr.file_size)) {
+        mismatch = "file size";
+    }
+    if (mismatch != NULL) {
+        fprintf(stderr, "Seed index %s does not match (%s)\n", filename.c_str(), mismatch);
+        close(fd);
+        return false;
+    }
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (populate) {
+        flags |= MAP_POPULATE;
+    }
+#endif
+    void* addr = mmap(NULL, hdr.file_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "Seed index %s could not be mapped\n", filename.c_str());
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    if (hugepages) {
+        madvise(addr, hdr.file_size, MADV_HUGEPAGE);
+    }
+#endif
+
+    shape_size_ = shape.length();
+    kmer_size_ = hdr.kmer_size;
+    ref_size_ = hdr.ref_size;
+    bin_size_ = hdr.bin_size;
+    index_table_size_ = hdr.index_table_size;
+    index_table_ = (uint32_t*) ((char*) addr + hdr.index_table_offset);
+    pos_table_ = (uint32_t*) ((char*) addr + hdr.pos_table_offset);
+#ifdef WIDE_COORD
+    index_hi_table_ = (uint8_t*) addr + hdr.index_hi_table_offset;
+    pos_hi_table_ = (uint8_t*) addr + hdr.pos_hi_table_offset;
+#endif
+    map_addr_ = addr;
+    map_size_ = hdr.file_size;
+
+    occurrence_multiple_ = hdr.occurrence_multiple;
+    max_occurrences_ = hdr.max_occurrences;
+    num_masked_kmers_ = hdr.num_masked_kmers;
+    num_masked_positions_ = hdr.num_masked_positions;
+    top_masked_.clear();
+    for (uint32_t i = 0; i < std::min(hdr.num_top_masked, (uint32_t) MAX_TOP_MASKED); i++) {
+        top_masked_.push_back(std::make_pair(hdr.top_masked_kmer[i], (ref_coord_t) hdr.top_masked_count[i]));
+    }
+
+    GenerateShapePos(shape);
+
+    return true;
+}
+
+bool SeedPosTable::WriteIndex(std::string filename, uint64_t ref_checksum, std::string shape) {
+    if (shape.length() >= SEED_INDEX_MAX_SHAPE) {
+        fprintf(stderr, "Seed shape too long for the seed index, not writing %s\n", filename.c_str());
+        return false;
+    }
+
+    seed_index_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SEED_INDEX_MAGIC, sizeof(hdr.magic));
+    hdr.version = SEED_INDEX_VERSION;
+    hdr.header_size = sizeof(hdr);
+    hdr.ref_checksum = ref_checksum;
+    hdr.ref_size = ref_size_;
+    hdr.coord_bits = REF_COORD_BITS;
+    hdr.bin_size = bin_size_;
+    hdr.occurrence_multiple = std::max(occurrence_multiple_, 0);
+    hdr.max_occurrences = max_occurrences_;
+    hdr.num_masked_kmers = num_masked_kmers_;
+    hdr.num_masked_positions = num_masked_positions_;
+    hdr.num_top_masked = top_masked_.size();
+    for (size_t i = 0; i < top_masked_.size(); i++) {
+        hdr.top_masked_kmer[i] = top_masked_[i].first;
+        hdr.top_masked_count[i] = top_masked_[i].second;
+    }
+    strncpy(hdr.shape, shape.c_str(), SEED_INDEX_MAX_SHAPE - 1);
+    hdr.kmer_size = kmer_size_;
+    hdr.index_table_size = index_table_size_;
+    hdr.num_positions = GetIndex(index_table_size_ - 1);
+    // tables start on page boundaries
+    hdr.index_table_offset = 4096;
+    hdr.index_hi_table_offset = (hdr.index_table_offset + (uint64_t) index_table_size_ * sizeof(uint32_t) + 4095) & ~4095ull;
+    hdr.pos_table_offset = (hdr.index_hi_table_offset + (uint64_t) index_table_size_ * COORD_HI_BYTES + 4095) & ~4095ull;
+    hdr.pos_hi_table_offset = (hdr.pos_table_offset + hdr.num_positions * sizeof(uint32_t) + 4095) & ~4095ull;
+    hdr.file_size = hdr.pos_hi_table_offset + hdr.num_positions * COORD_HI_BYTES;
+
+    std::string tmp_name = filename + ".tmp." + std::to_string(getpid());
+    FILE* fp = fopen(tmp_name.c_str(), "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not write seed index %s\n", tmp_name.c_str());
+        return false;
+    }
+
+    bool ok = (fwrite(&hdr, sizeof(hdr), 1, fp) == 1);
+    ok = ok && (fseek(fp, hdr.index_table_offset, SEEK_SET) == 0);
+    ok = ok && (fwrite(index_table_, sizeof(uint32_t), index_table_size_, fp) == index_table_size_);
+    ok = ok && (fseek(fp, hdr.pos_table_offset, SEEK_SET) == 0);
+    ok = ok && (fwrite(pos_table_, sizeof(uint32_t), hdr.num_positions, fp) == hdr.num_positions);
+#ifdef WIDE_COORD
+    ok = ok && (fseek(fp, hdr.index_hi_table_offset, SEEK_SET) == 0);
+    ok = ok && (fwrite(index_hi_table_, COORD_HI_BYTES, index_table_size_, fp) == index_table_size_);
+    ok = ok && (fseek(fp, hdr.pos_hi_table_offset, SEEK_SET) == 0);
+    ok = ok && (fwrite(pos_hi_table_, COORD_HI_BYTES, hdr.num_positions, fp) == hdr.num_positions);
+#endif
+    ok = ok && (fflush(fp) == 0) && (ftruncate(fileno(fp), hdr.file_size) == 0);
+    ok = (fclose(fp) == 0) && ok;
+
+    if (!ok || (rename(tmp_name.c_str(), filename.c_str()) != 0)) {
+        fprintf(stderr, "Could not write seed index %s\n", filename.c_str());
+        unlink(tmp_name.c_str());
+        return false;
+    }
+    return true;
 }
 
 
@@ -97,14 +478,14 @@ std::vector<seed_hit> SeedPosTable::DSOFT(std::vector<uint64_t> seed_offset_vect
 		uint32_t index  = (seed_offset_vector[i] >> 32);
 		uint32_t offset = ((seed_offset_vector[i] << 32) >> 32);
 
-		uint32_t start_index = (index == 0) ?  0 : index_table_[index-1];
-		uint32_t end_index = index_table_[index];
+		ref_coord_t start_index = (index == 0) ?  0 : GetIndex(index-1);
+		ref_coord_t end_index = GetIndex(index);
         
-        for (uint32_t j = start_index; j < end_index; j++) {
-            uint32_t hit = pos_table_[j];
+        for (ref_coord_t j = start_index; j < end_index; j++) {
+            ref_coord_t hit = GetPos(j);
             if (hit >= offset) {
-                uint32_t bin = ((hit - offset) / bin_size_);
-                uint64_t bin_offset = ((uint64_t)bin << 32) + offset;
+                ref_coord_t bin = ((hit - offset) / bin_size_);
+                uint64_t bin_offset = ((uint64_t)bin << HIT_OFFSET_BITS) + offset;
                 hits_array.push_back(Hits(bin_offset, hit));
             }
         }
@@ -114,19 +495,21 @@ std::vector<seed_hit> SeedPosTable::DSOFT(std::vector<uint64_t> seed_offset_vect
 	
     uint32_t num_hits = hits_array.size();
 	
-    uint32_t last_bin = (1 << 31);
+    ref_coord_t last_bin = ~(ref_coord_t) 0;
 	uint32_t last_offset = 0;
 	uint32_t curr_count = 0;
+    uint32_t min_count = (uint32_t) threshold;
+    uint32_t kmer_size = (uint32_t) kmer_size_;
 
-	for (int i = 0; i < num_hits; i++) {
+	for (uint32_t i = 0; i < num_hits; i++) {
 		Hits next_hit = hits_array[i];
-		uint32_t offset = ((next_hit.bin_offset << 32) >> 32);
-		uint32_t bin = (next_hit.bin_offset >> 32);
-		uint32_t hit = next_hit.hit;
+		uint32_t offset = ((next_hit.bin_offset << REF_COORD_BITS) >> REF_COORD_BITS);
+		ref_coord_t bin = (next_hit.bin_offset >> HIT_OFFSET_BITS);
+		ref_coord_t hit = next_hit.hit;
 		if (bin == last_bin) {
-            if (curr_count < threshold) {
-                curr_count = ((offset - last_offset > kmer_size_) || (curr_count == 0)) ? curr_count + kmer_size_ : curr_count + (offset - last_offset);
-                if (curr_count >= threshold) {
+            if (curr_count < min_count) {
+                curr_count = ((offset - last_offset > kmer_size) || (curr_count == 0)) ? curr_count + kmer_size : curr_count + (offset - last_offset);
+                if (curr_count >= min_count) {
                     seed_hit sh;
                     sh.reference_offset = hit;
                     sh.query_offset = offset + chunk_offset;
@@ -136,8 +519,8 @@ std::vector<seed_hit> SeedPosTable::DSOFT(std::vector<uint64_t> seed_offset_vect
         }
         else {
             last_bin = bin;
-            curr_count = kmer_size_;
-            if (curr_count >= threshold) {
+            curr_count = kmer_size;
+            if (curr_count >= min_count) {
                 seed_hit sh;
                 sh.reference_offset = hit;
                 sh.query_offset = offset + chunk_offset;
@@ -1,3 +1,4 @@
+#pragma once
 #include <vector>
 #include <cstdlib>
 #include <stdint.h>
@@ -5,42 +6,173 @@
 #include <string>
 #include <assert.h>
 
+// Reference coordinates index the concatenated reference in g_DRAM and are
+// 32-bit by default. Building with WIDE_COORD (WITH_WIDE_COORD in CMake)
+// widens them to REF_COORD_BITS = 40 for references beyond 4 Gbp; positions
+// within a chromosome stay 32-bit in both modes. D-SOFT packs the diagonal
+// bin of a hit above HIT_OFFSET_BITS of query offset within the chunk.
+#ifdef WIDE_COORD
+typedef uint64_t ref_coord_t;
+#define REF_COORD_BITS 40
+#else
+typedef uint32_t ref_coord_t;
+#define REF_COORD_BITS 32
+#endif
+#define HIT_OFFSET_BITS (64 - REF_COORD_BITS)
+
 struct seed_hit {
-    uint32_t reference_offset;
+    ref_coord_t reference_offset;
     uint32_t query_offset;
 };
 
 struct Hits {
-    Hits(uint64_t a, uint32_t b)
+    Hits(uint64_t a, ref_coord_t b)
         : bin_offset(a),
         hit(b)
     {};
 
     uint64_t bin_offset;
-    uint32_t hit;
+    ref_coord_t hit;
 };
 
 static inline bool CompareHits (Hits h1, Hits h2) {
 	return ((h1.bin_offset < h2.bin_offset));
 }
 
+// On-disk seed position table (index_file in [DSOFT_params]): this header,
+// then the index table and the position table at the offsets it gives, in
+// host byte order. An index is only used for the reference checksum, seed
+// shape, bin size and occurrence cap it was built for; SEED_INDEX_VERSION
+// changes with the layout of the tables. Both tables hold the low 32 bits of
+// their entries; with WIDE_COORD the high bytes of each follow in a table of
+// their own, so a 40-bit entry takes 5 bytes rather than 8.
+#define SEED_INDEX_MAGIC "DWGAIDX"
+#define SEED_INDEX_VERSION 5
+#define SEED_INDEX_MAX_SHAPE 64
+
+// most frequent masked k-mers kept for the report
+#define MAX_TOP_MASKED 8
+
+struct seed_index_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t ref_checksum;
+    uint64_t ref_size;
+    uint32_t coord_bits;
+    int32_t bin_size;
+    int32_t occurrence_multiple;
+    char shape[SEED_INDEX_MAX_SHAPE];
+    uint32_t kmer_size;
+    uint32_t index_table_size;
+    uint64_t num_positions;
+    uint64_t max_occurrences;
+    uint64_t num_masked_kmers;
+    uint64_t num_masked_positions;
+    uint32_t num_top_masked;
+    uint32_t top_masked_kmer[MAX_TOP_MASKED];
+    uint64_t top_masked_count[MAX_TOP_MASKED];
+    uint64_t index_table_offset;
+    uint64_t index_hi_table_offset;
+    uint64_t pos_table_offset;
+    uint64_t pos_hi_table_offset;
+    uint64_t file_size;
+};
+
+// Checksum of the reference sequence that keys the index file
+uint64_t SeedIndexChecksum (const char* ref_str, ref_coord_t ref_length);
+
 class SeedPosTable {
     private:
         uint32_t index_table_size_;
-        uint32_t ref_size_;
+        ref_coord_t ref_size_;
         int kmer_size_;
         int shape_size_;
         int bin_size_;
+        // low 32 bits of the bucket ends and of the positions, and bits 32-39
+        // with WIDE_COORD
         uint32_t *index_table_;
-        uint64_t *pos_table_;
+        uint8_t *index_hi_table_;
+        uint32_t *pos_table_;
+        uint8_t *pos_hi_table_;
+
+        // k-mers occurring more than max_occurrences_ times are dropped from
+        // the table; 0 keeps every k-mer
+        int occurrence_multiple_;
+        ref_coord_t max_occurrences_;
+        uint32_t num_masked_kmers_;
+        ref_coord_t num_masked_positions_;
+        std::vector<std::pair<uint32_t, ref_coord_t> > top_masked_;
+
+        // tables mapped from an index file rather than allocated
+        void* map_addr_;
+        size_t map_size_;
+
+        inline void SetIndex(uint32_t s, ref_coord_t end) {
+            index_table_[s] = (uint32_t) end;
+#ifdef WIDE_COORD
+            index_hi_table_[s] = (uint8_t) (end >> 32);
+#endif
+        }
+
+        inline void SetPos(ref_coord_t e, ref_coord_t pos) {
+            pos_table_[e] = (uint32_t) pos;
+#ifdef WIDE_COORD
+            pos_hi_table_[e] = (uint8_t) (pos >> 32);
+#endif
+        }
+
+        void MaskFrequentKmers(int occurrence_multiple);
 
     public:
         SeedPosTable();
-        SeedPosTable(char* ref_str, uint32_t ref_length, std::string shape, int bin_size);
+        // occurrence_multiple > 0 drops the k-mers occurring more than
+        // occurrence_multiple times as often as the mean k-mer (taken as at
+        // least once), as seed_occurence_multiple in [DSOFT_params]
+        SeedPosTable(char* ref_str, ref_coord_t ref_length, std::string shape, int bin_size, int occurrence_multiple = 0);
         ~SeedPosTable();
 
+        // Maps the tables from an index file written by WriteIndex(). Returns
+        // false, leaving the table empty, if the file is missing or was built
+        // for another reference, shape, bin size or occurrence multiple.
+        // populate prefaults the mapping and hugepages asks for transparent
+        // huge pages.
+        bool MapIndex(std::string filename, uint64_t ref_checksum, ref_coord_t ref_length, std::string shape, int bin_size,
+                int occurrence_multiple, bool populate, bool hugepages);
+        // Writes the tables to filename through a temporary file that is
+        // renamed into place, so that concurrent jobs never map a partial index
+        bool WriteIndex(std::string filename, uint64_t ref_checksum, std::string shape);
+
         int GetKmerSize();
         int GetShapeSize();
+        uint32_t GetIndexTableSize();
+
+        // occurrence cap and the k-mers it masked, most frequent first in
+        // GetTopMasked() as (k-mer index, occurrences)
+        ref_coord_t GetMaxOccurrences();
+        uint32_t GetNumMaskedKmers();
+        ref_coord_t GetNumMaskedPositions();
+        const std::vector<std::pair<uint32_t, ref_coord_t> >& GetTopMasked();
+
+        // end of the bucket of k-mer s in the position table; the last entry
+        // of the index table is the number of positions
+        inline ref_coord_t GetIndex(uint32_t s) {
+#ifdef WIDE_COORD
+            return ((ref_coord_t) index_hi_table_[s] << 32) | index_table_[s];
+#else
+            return index_table_[s];
+#endif
+        }
+
+        // reference position of entry e of the position table
+        inline ref_coord_t GetPos(ref_coord_t e) {
+#ifdef WIDE_COORD
+            return ((ref_coord_t) pos_hi_table_[e] << 32) | pos_table_[e];
+#else
+            return pos_table_[e];
+#endif
+        }
+
         std::vector<seed_hit> DSOFT(std::vector<uint64_t> seed_offset_vector, int threshold, uint32_t chunk_offset);
         int TouchKmerPos(std::string kmer); 
 };
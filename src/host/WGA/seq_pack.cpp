@@ -0,0 +1,108 @@
+#include "seq_pack.h"
+#include "cpu_align.h"
+#include <immintrin.h>
+#include <string.h>
+
+size_t PackedCodesBytes (size_t len) {
+    size_t bytes = (len + 3) / 4;
+    return (bytes + PACKED_SEQ_BEAT_BYTES - 1) / PACKED_SEQ_BEAT_BYTES * PACKED_SEQ_BEAT_BYTES;
+}
+
+size_t PackedMaskBytes (size_t len) {
+    size_t bytes = (len + 7) / 8;
+    return (bytes + PACKED_SEQ_BEAT_BYTES - 1) / PACKED_SEQ_BEAT_BYTES * PACKED_SEQ_BEAT_BYTES;
+}
+
+size_t PackedSeqBytes (size_t len) {
+    return PackedCodesBytes(len) + PackedMaskBytes(len);
+}
+
+// For the ASCII codes of ACGT and acgt, bits [1:0] of (c >> 1) ^ (c >> 2)
+// are 0, 1, 2 and 3 respectively
+static inline uint8_t BaseCode (char c) {
+    return ((c >> 1) ^ (c >> 2)) & 3;
+}
+
+static inline bool IsACGT (char c) {
+    char u = c & 0xDF;
+    return (u == 'A') || (u == 'C') || (u == 'G') || (u == 'T');
+}
+
+// Packs bases [start, end) where start is a multiple of 8
+static void PackSeqScalar (const char* seq, size_t start, size_t end, uint8_t* codes, uint8_t* mask) {
+    for (size_t i = start; i < end; i++) {
+        char c = seq[i];
+        if (IsACGT(c)) {
+            codes[i/4] |= BaseCode(c) << (2*(i%4));
+        }
+        else {
+            mask[i/8] |= 1 << (i%8);
+        }
+    }
+}
+
+// 32 bases per iteration: the mask is a byte compare + movemask, and the
+// codes of 4 consecutive bases are combined into one byte with two
+// multiply-adds before the low byte of every dword is gathered
+__attribute__((target("avx2")))
+static size_t PackSeqAVX2 (const char* seq, size_t len, uint8_t* codes, uint8_t* mask) {
+    const __m256i case_mask = _mm256_set1_epi8((char) 0xDF);
+    const __m256i base_a = _mm256_set1_epi8('A');
+    const __m256i base_c = _mm256_set1_epi8('C');
+    const __m256i base_g = _mm256_set1_epi8('G');
+    const __m256i base_t = _mm256_set1_epi8('T');
+    const __m256i three = _mm256_set1_epi8(3);
+    const __m256i mul_pairs = _mm256_set1_epi16(0x0401);
+    const __m256i mul_quads = _mm256_set1_epi32(0x00100001);
+    const __m256i gather_bytes = _mm256_setr_epi8(
+            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i gather_lanes = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i*) (seq + i));
+        __m256i u = _mm256_and_si256(c, case_mask);
+        __m256i is_base = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(u, base_a), _mm256_cmpeq_epi8(u, base_c)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(u, base_g), _mm256_cmpeq_epi8(u, base_t)));
+        uint32_t n_bits = ~(uint32_t) _mm256_movemask_epi8(is_base);
+        memcpy(mask + i/8, &n_bits, 4);
+
+        // (c >> 1) ^ (c >> 2) on bytes, using 16-bit shifts and keeping the
+        // low two bits, which are not affected by the neighbouring byte
+        __m256i code = _mm256_xor_si256(_mm256_srli_epi16(c, 1), _mm256_srli_epi16(c, 2));
+        code = _mm256_and_si256(_mm256_and_si256(code, three), is_base);
+        __m256i pairs = _mm256_maddubs_epi16(code, mul_pairs);
+        __m256i quads = _mm256_madd_epi16(pairs, mul_quads);
+        __m256i packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(quads, gather_bytes), gather_lanes);
+        _mm_storel_epi64((__m128i*) (codes + i/4), _mm256_castsi256_si128(packed));
+    }
+    return i;
+}
+
+void PackSeq (int isa, const char* seq, size_t len, uint8_t* out) {
+    uint8_t* codes = out;
+    uint8_t* mask = out + PackedCodesBytes(len);
+    memset(out, 0, PackedSeqBytes(len));
+
+    size_t done = 0;
+    if (isa >= ISA_AVX2) {
+        done = PackSeqAVX2(seq, len, codes, mask);
+    }
+    PackSeqScalar(seq, done, len, codes, mask);
+}
+
+void UnpackSeq (const uint8_t* packed, size_t len, char* seq) {
+    const char bases[4] = {'A', 'C', 'G', 'T'};
+    const uint8_t* codes = packed;
+    const uint8_t* mask = packed + PackedCodesBytes(len);
+    for (size_t i = 0; i < len; i++) {
+        if ((mask[i/8] >> (i%8)) & 1) {
+            seq[i] = 'N';
+        }
+        else {
+            seq[i] = bases[(codes[i/4] >> (2*(i%4))) & 3];
+        }
+    }
+}
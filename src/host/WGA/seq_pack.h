@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Packed sequence format for transfers to device memory. A sequence of len
+// bases is stored as two planes, each padded to a whole 64-byte beat:
+//   codes: 2 bits per base, base i in bits [2*(i%4)+1 : 2*(i%4)] of byte i/4,
+//          with A=0, C=1, G=2, T=3 (lower and upper case alike)
+//   mask:  1 bit per base, bit i%8 of byte i/8 is set when the base is not
+//          one of ACGT; its code is 0
+// The codes plane comes first. Packed2Nt in src/hdl/common decodes a
+// (code, mask) pair to the nucleotide encoding used by Ascii2Nt.
+
+#define PACKED_SEQ_BEAT_BYTES 64
+
+size_t PackedCodesBytes(size_t len);
+size_t PackedMaskBytes(size_t len);
+size_t PackedSeqBytes(size_t len);
+
+// Packs seq[0, len) into out, which must hold PackedSeqBytes(len) bytes.
+// Uses the widest vector unit up to isa (cpu_isa in cpu_align.h).
+void PackSeq(int isa, const char* seq, size_t len, uint8_t* out);
+
+// Expands a packed sequence back to upper-case ASCII, with N for masked bases
+void UnpackSeq(const uint8_t* packed, size_t len, char* seq);
@@ -0,0 +1,18 @@
+#pragma once
+
+// Xilinx DDR bank extension for clCreateBuffer, as implemented by the
+// software device in sim_device.cpp
+
+#include <CL/opencl.h>
+
+#define XCL_MEM_DDR_BANK0       (1 << 0)
+#define XCL_MEM_DDR_BANK1       (1 << 1)
+#define XCL_MEM_DDR_BANK2       (1 << 2)
+#define XCL_MEM_DDR_BANK3       (1 << 3)
+#define CL_MEM_EXT_PTR_XILINX   (1 << 31)
+
+typedef struct {
+    unsigned flags;
+    void* obj;
+    void* param;
+} cl_mem_ext_ptr_t;
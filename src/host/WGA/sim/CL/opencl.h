@@ -0,0 +1,109 @@
+#pragma once
+
+// The part of the OpenCL 1.2 API used by Processor.cpp, as implemented by the
+// software device in sim_device.cpp. Used in place of the SDx runtime headers
+// when wga is built with WITH_SIM_DEVICE.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int32_t cl_int;
+typedef uint32_t cl_uint;
+typedef uint64_t cl_ulong;
+typedef cl_ulong cl_bitfield;
+typedef cl_uint cl_bool;
+
+typedef cl_bitfield cl_mem_flags;
+typedef cl_bitfield cl_device_type;
+typedef cl_bitfield cl_command_queue_properties;
+typedef intptr_t cl_context_properties;
+typedef cl_uint cl_platform_info;
+typedef cl_uint cl_device_info;
+typedef cl_uint cl_program_info;
+typedef cl_uint cl_program_build_info;
+typedef cl_uint cl_profiling_info;
+
+typedef struct _cl_platform_id* cl_platform_id;
+typedef struct _cl_device_id* cl_device_id;
+typedef struct _cl_context* cl_context;
+typedef struct _cl_command_queue* cl_command_queue;
+typedef struct _cl_program* cl_program;
+typedef struct _cl_kernel* cl_kernel;
+typedef struct _cl_mem* cl_mem;
+typedef struct _cl_event* cl_event;
+
+#define CL_SUCCESS                                  0
+#define CL_DEVICE_NOT_FOUND                         -1
+#define CL_MEM_OBJECT_ALLOCATION_FAILURE            -4
+#define CL_PROFILING_INFO_NOT_AVAILABLE             -7
+#define CL_INVALID_VALUE                            -30
+#define CL_INVALID_PROGRAM                          -44
+#define CL_INVALID_KERNEL_NAME                      -46
+#define CL_INVALID_KERNEL                           -48
+#define CL_INVALID_ARG_INDEX                        -49
+#define CL_INVALID_KERNEL_ARGS                      -52
+
+#define CL_FALSE                                    0
+#define CL_TRUE                                     1
+
+#define CL_PLATFORM_VENDOR                          0x0903
+#define CL_DEVICE_TYPE_ACCELERATOR                  (1 << 3)
+#define CL_DEVICE_NAME                              0x102B
+#define CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE      (1 << 0)
+#define CL_QUEUE_PROFILING_ENABLE                   (1 << 1)
+#define CL_PROFILING_COMMAND_START                  0x1282
+#define CL_PROFILING_COMMAND_END                    0x1283
+#define CL_MEM_READ_WRITE                           (1 << 0)
+#define CL_MEM_WRITE_ONLY                           (1 << 1)
+#define CL_MEM_READ_ONLY                            (1 << 2)
+#define CL_PROGRAM_KERNEL_NAMES                     0x1168
+#define CL_PROGRAM_BUILD_LOG                        0x1183
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cl_int clGetPlatformIDs(cl_uint num_entries, cl_platform_id* platforms, cl_uint* num_platforms);
+cl_int clGetPlatformInfo(cl_platform_id platform, cl_platform_info param_name, size_t param_value_size, void* param_value, size_t* param_value_size_ret);
+cl_int clGetDeviceIDs(cl_platform_id platform, cl_device_type device_type, cl_uint num_entries, cl_device_id* devices, cl_uint* num_devices);
+cl_int clGetDeviceInfo(cl_device_id device, cl_device_info param_name, size_t param_value_size, void* param_value, size_t* param_value_size_ret);
+
+cl_context clCreateContext(const cl_context_properties* properties, cl_uint num_devices, const cl_device_id* devices,
+        void (*pfn_notify)(const char*, const void*, size_t, void*), void* user_data, cl_int* errcode_ret);
+cl_int clReleaseContext(cl_context context);
+
+cl_command_queue clCreateCommandQueue(cl_context context, cl_device_id device, cl_command_queue_properties properties, cl_int* errcode_ret);
+cl_int clReleaseCommandQueue(cl_command_queue command_queue);
+cl_int clFlush(cl_command_queue command_queue);
+
+cl_program clCreateProgramWithBinary(cl_context context, cl_uint num_devices, const cl_device_id* device_list, const size_t* lengths,
+        const unsigned char** binaries, cl_int* binary_status, cl_int* errcode_ret);
+cl_int clBuildProgram(cl_program program, cl_uint num_devices, const cl_device_id* device_list, const char* options,
+        void (*pfn_notify)(cl_program, void*), void* user_data);
+cl_int clGetProgramInfo(cl_program program, cl_program_info param_name, size_t param_value_size, void* param_value, size_t* param_value_size_ret);
+cl_int clGetProgramBuildInfo(cl_program program, cl_device_id device, cl_program_build_info param_name, size_t param_value_size,
+        void* param_value, size_t* param_value_size_ret);
+cl_int clReleaseProgram(cl_program program);
+
+cl_kernel clCreateKernel(cl_program program, const char* kernel_name, cl_int* errcode_ret);
+cl_int clSetKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void* arg_value);
+cl_int clReleaseKernel(cl_kernel kernel);
+
+cl_mem clCreateBuffer(cl_context context, cl_mem_flags flags, size_t size, void* host_ptr, cl_int* errcode_ret);
+cl_int clReleaseMemObject(cl_mem memobj);
+
+cl_int clEnqueueWriteBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_write, size_t offset, size_t size,
+        const void* ptr, cl_uint num_events_in_wait_list, const cl_event* event_wait_list, cl_event* event);
+cl_int clEnqueueReadBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_read, size_t offset, size_t size,
+        void* ptr, cl_uint num_events_in_wait_list, const cl_event* event_wait_list, cl_event* event);
+cl_int clEnqueueTask(cl_command_queue command_queue, cl_kernel kernel, cl_uint num_events_in_wait_list,
+        const cl_event* event_wait_list, cl_event* event);
+
+cl_int clWaitForEvents(cl_uint num_events, const cl_event* event_list);
+cl_int clGetEventProfilingInfo(cl_event event, cl_profiling_info param_name, size_t param_value_size, void* param_value,
+        size_t* param_value_size_ret);
+cl_int clReleaseEvent(cl_event event);
+
+#ifdef __cplusplus
+}
+#endif
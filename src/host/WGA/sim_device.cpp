@@ -0,0 +1,890 @@
+// Software stand-in for the F1 device, implementing the OpenCL calls made by
+// Processor.cpp (see sim/CL/opencl.h). The BSW and GACT-X kernel contracts are
+// executed with the CPU alignment engines, and every command is held until a
+// latency and bandwidth model says it would have completed on the device, so
+// that the fpga and hybrid backends, their kernel pool and their dispatchers
+// can be run and timed on any Linux machine.
+//
+// The platform has num_devices identical cards. Each card (context) has one
+// host-to-device and one device-to-host link, shared by all its queues, and
+// one compute engine per kernel. Each engine runs its commands one at a time,
+// in enqueue order among those whose wait lists have completed:
+//   transfer: pcie_latency_us + bytes / pcie_gbytes_per_sec
+//   task:     launch_latency_us + cells / (bsw_gcups or gactx_gcups)
+// where cells is the sum of ref_length * query_length over the tiles of the
+// task. The parameters are read from the [Simulator] section of params.cfg.
+// A command whose software execution takes longer than its modelled time is
+// counted as an overrun; the reported times are then a lower bound.
+//
+// Built with WITH_VERILATOR, the kernels run their tiles on the verilated
+// BSW_Array and GACTX_Array models of array_model.h instead, and a task takes
+// launch_latency_us + cycles / clock_mhz, where cycles is what the models
+// took: BSW tiles are spread over the banded arrays of a kernel, each tile
+// going to the first array to become free, and GACT-X tiles include their
+// traceback read-out. The tiles are also run on the CPU engines and every
+// tile where the array result differs is counted and reported at the end;
+// the kernels return the array results. With tile_trace set, the sequences
+// of every tile are appended to that file for array_bench.
+//
+// The "xclbin" is a text file listing one kernel name per line, e.g.
+// BSW_bank0 ... BSW_bank3 and GACTX_bank3; lines starting with '#' are
+// ignored. Device buffers are host memory. Sequences are read as ASCII, so
+// packed_seq must be 0.
+
+#include "Processor.h"
+#include "graph.h"
+#include <CL/opencl.h>
+#include <CL/cl_ext.h>
+#include "ConfigFile.h"
+#include "cpu_align.h"
+#ifdef WITH_VERILATOR
+#include "array_model.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <sstream>
+
+#define SIM_MAX_DEVICES 16
+#define SIM_MAX_KERNEL_ARGS 32
+#define SIM_BSW_TILE_SIZE 512
+#define SIM_GACTX_TILE_SIZE 2048
+#define SIM_BSW_OUT_HEADER_INTS 16
+#define SIM_BSW_NUM_ARRAYS 7
+
+enum sim_kernel_type { SIM_BSW, SIM_GACTX };
+enum sim_command_type { SIM_WRITE, SIM_READ, SIM_TASK };
+
+struct _cl_platform_id {
+    int unused;
+};
+
+struct _cl_device_id {
+    int unused;
+};
+
+struct _cl_mem {
+    char* data;
+    size_t size;
+    bool written;
+};
+
+struct sim_engine;
+
+// engines[0] is the host-to-device link, engines[1] the device-to-host link
+// and the others are the kernels, in clCreateKernel order
+struct _cl_context {
+    int device;
+    std::vector<sim_engine*> engines;
+    bool shutdown;
+};
+
+struct _cl_kernel {
+    std::string name;
+    sim_kernel_type type;
+    sim_engine* engine;
+    uint64_t args[SIM_MAX_KERNEL_ARGS];
+};
+
+struct _cl_program {
+    cl_context context;
+    std::vector<std::string> kernel_names;
+    std::string build_log;
+};
+
+struct _cl_command_queue {
+    cl_context context;
+};
+
+// Profiling times are those of the model, not of the simulation
+struct _cl_event {
+    int refcount;
+    bool complete;
+    cl_ulong start_ns;
+    cl_ulong end_ns;
+};
+
+struct sim_command {
+    sim_command_type type;
+    std::vector<cl_event> deps;
+    cl_event event;
+    cl_mem mem;
+    size_t offset;
+    size_t size;
+    bool copy;
+    char* ptr;
+    cl_kernel kernel;
+    uint64_t args[SIM_MAX_KERNEL_ARGS];
+};
+
+struct sim_engine {
+    std::string name;
+    cl_context context;
+    std::deque<sim_command*> pending;
+    std::thread worker;
+    uint64_t num_commands;
+    uint64_t num_overruns;
+    uint64_t bytes;
+    uint64_t cells;
+    uint64_t cycles;
+    // tiles where the verilated arrays and the CPU engines disagree
+    uint64_t array_mismatches;
+    double busy_us;
+};
+
+// Model parameters
+static int sim_num_devices = 1;
+static double sim_pcie_gbytes_per_sec = 10.0;
+static double sim_pcie_latency_us = 5.0;
+static double sim_launch_latency_us = 20.0;
+static double sim_bsw_gcups = 40.0;
+static double sim_gactx_gcups = 5.0;
+static double sim_clock_mhz = 250.0;
+static std::string sim_tile_trace;
+static FILE* sim_trace = NULL;
+static std::mutex sim_trace_lock;
+
+static _cl_platform_id sim_platform;
+static _cl_device_id sim_devices[SIM_MAX_DEVICES];
+static bool sim_config_loaded = false;
+
+static std::mutex sim_lock;
+static std::condition_variable sim_cv;
+static int sim_isa = ISA_SCALAR;
+
+// Called with sim_lock held
+static void ReleaseEventLocked (cl_event e) {
+    if (--e->refcount == 0) {
+        delete e;
+    }
+}
+
+static bool CommandReady (sim_command* c) {
+    for (auto d: c->deps) {
+        if (!d->complete) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef WITH_VERILATOR
+// Compares the result of a tile on a verilated array with the CPU engine;
+// the first differing tile of a run is printed
+static void CheckArrayTile (const char* kernel, const array_tile_result& r, int score, int rmax, int qmax,
+        const std::vector<uint32_t>& tb, uint64_t& mismatches) {
+    static std::atomic<bool> reported(false);
+    if ((r.score == score) && (r.ref_max_pos == rmax) && (r.query_max_pos == qmax) && (r.tb == tb)) {
+        return;
+    }
+    if (!reported.exchange(true)) {
+        fprintf(stderr, "Warning: %s array (%d, %d, %d, %lu tb words) != CPU engine (%d, %d, %d, %lu tb words)\n", kernel,
+                r.score, r.ref_max_pos, r.query_max_pos, r.tb.size(), score, rmax, qmax, tb.size());
+    }
+    mismatches++;
+}
+#endif
+
+static void ReadScoring (const uint64_t* args, cpu_scoring& sc, bool gactx) {
+    int sub_mat[11];
+    for (int i = 0; i < 11; i++) {
+        sub_mat[i] = (int) args[i];
+    }
+    int arg13 = (int) args[13];
+    InitCPUScoring(sc, sub_mat, (int) args[11], (int) args[12], gactx ? 0 : arg13, gactx ? arg13 : 0);
+}
+
+// One line per tile: kernel, align_fields, reference and query, as read by
+// array_bench
+static void TraceTile (const char* kernel, uint8_t align_fields, const char* ref, uint32_t ref_len,
+        const char* query, uint32_t query_len) {
+    if ((sim_trace == NULL) || (ref_len == 0) || (query_len == 0)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lk(sim_trace_lock);
+    fprintf(sim_trace, "%s %u %.*s %.*s\n", kernel, align_fields, (int) ref_len, ref, (int) query_len, query);
+}
+
+#ifdef WITH_VERILATOR
+static void ReadArrayParams (const uint64_t* args, array_params& params) {
+    for (int i = 0; i < 11; i++) {
+        params.sub_mat[i] = (int) args[i];
+    }
+    params.gap_open = (int) args[11];
+    params.gap_extend = (int) args[12];
+    params.band_or_ydrop = (int) args[13];
+}
+#endif
+
+static const char* SeqPtr (cl_mem mem, size_t offset, size_t len, const char* what) {
+    if ((mem == NULL) || (offset + len > mem->size)) {
+        fprintf(stderr, "Error: simulated kernel reads %s [%lu, %lu) outside its buffer!\n", what, offset, offset + len);
+        fprintf(stderr, "Test failed\n");
+        exit(1);
+    }
+    return mem->data + offset;
+}
+
+// BSW kernel: arguments as set by RunBSWBatch in Processor.cpp. Returns the
+// number of cells aligned, and the cycles the kernel took on the array models
+// and the tiles where they differ from the CPU engine.
+static uint64_t RunBSW (const uint64_t* args, uint64_t& cycles, uint64_t& mismatches) {
+    cpu_scoring sc;
+    ReadScoring(args, sc, false);
+#ifdef WITH_VERILATOR
+    array_params params;
+    ReadArrayParams(args, params);
+    uint64_t array_busy[SIM_BSW_NUM_ARRAYS] = {0};
+    array_tile_result array_r[ISA_AVX512];
+#endif
+
+    uint32_t batch_size = args[14];
+    uint8_t align_fields = args[15];
+    cl_mem ref = (cl_mem) args[16];
+    cl_mem query = (cl_mem) args[17];
+    const uint32_t* batch_id = (const uint32_t*) ((cl_mem) args[18])->data;
+    const uint32_t* batch_params = (const uint32_t*) ((cl_mem) args[19])->data;
+    int* out = (int*) ((cl_mem) args[20])->data;
+    int thresh = (int) args[21];
+    uint32_t tile_window = args[22];
+    uint32_t query_length = args[23];
+    uint32_t num_chrs = args[24];
+    const uint32_t* chr_ends = (const uint32_t*) ((cl_mem) args[25])->data;
+
+    bool rev_ref = (align_fields & reverse_ref);
+    bool comp_ref = (align_fields & complement_ref);
+    bool rev_query = (align_fields & reverse_query);
+    bool comp_query = (align_fields & complement_query);
+
+    int8_t ref_tile[ISA_AVX512][SIM_BSW_TILE_SIZE];
+    int8_t query_tile[ISA_AVX512][SIM_BSW_TILE_SIZE];
+    bsw_tile_seq seqs[ISA_AVX512];
+    uint32_t ids[ISA_AVX512];
+    int score[ISA_AVX512], rmax[ISA_AVX512], qmax[ISA_AVX512];
+
+    uint64_t cells = 0;
+    int num_passed = 0;
+
+    for (uint32_t t0 = 0; t0 < batch_size; t0 += sim_isa) {
+        int n = std::min((uint32_t) sim_isa, batch_size - t0);
+        for (int l = 0; l < n; l++) {
+            uint32_t b = t0 + l;
+            uint32_t ro, qo, rl, ql;
+            if (tile_window != 0) {
+                // hit mode: same window as HitTile(), with the chromosome end
+                // looked up in the chr_ends table
+                uint32_t ref_hit = batch_params[4*b];
+                uint32_t query_hit = batch_params[4*b+1];
+                uint32_t chr_end = UINT32_MAX;
+                for (uint32_t c = 0; c < num_chrs; c++) {
+                    if (chr_ends[c] > ref_hit) {
+                        chr_end = chr_ends[c];
+                        break;
+                    }
+                }
+                uint32_t ref_start = (ref_hit < tile_window/2) ? 0 : ref_hit - tile_window/2;
+                uint32_t query_start = (query_hit < tile_window/2) ? 0 : query_hit - tile_window/2;
+                ids[l] = b;
+                ro = ref_start;
+                rl = std::min(tile_window, chr_end - ref_start);
+                ql = std::min(tile_window, query_length - query_start);
+                qo = rev_query ? query_length - (query_start + ql) : query_start;
+            }
+            else {
+                ids[l] = batch_id[4*b];
+                ro = batch_params[4*b];
+                qo = batch_params[4*b+1];
+                rl = batch_params[4*b+2];
+                ql = batch_params[4*b+3];
+            }
+            rl = std::min(rl, (uint32_t) SIM_BSW_TILE_SIZE);
+            ql = std::min(ql, (uint32_t) SIM_BSW_TILE_SIZE);
+
+            const char* ref_seq = SeqPtr(ref, ro, rl, "reference");
+            const char* query_seq = SeqPtr(query, qo, ql, "query");
+            TraceTile("bsw", align_fields, ref_seq, rl, query_seq, ql);
+            cells += (uint64_t) rl * ql;
+#ifdef WITH_VERILATOR
+            BSWArrayTile(params, align_fields, ref_seq, rl, query_seq, ql, array_r[l]);
+            *std::min_element(array_busy, array_busy + SIM_BSW_NUM_ARRAYS) += array_r[l].load_cycles + array_r[l].compute_cycles;
+#endif
+            EncodeTileSeq(ref_seq, rl, rev_ref, comp_ref, ref_tile[l]);
+            EncodeTileSeq(query_seq, ql, rev_query, comp_query, query_tile[l]);
+            seqs[l].ref = ref_tile[l];
+            seqs[l].ref_len = rl;
+            seqs[l].query = query_tile[l];
+            seqs[l].query_len = ql;
+        }
+
+        BSWTiles(sim_isa, seqs, n, sc, score, rmax, qmax);
+#ifdef WITH_VERILATOR
+        for (int l = 0; l < n; l++) {
+            CheckArrayTile("bsw", array_r[l], score[l], rmax[l], qmax[l], std::vector<uint32_t>(), mismatches);
+            score[l] = array_r[l].score;
+            rmax[l] = array_r[l].ref_max_pos;
+            qmax[l] = array_r[l].query_max_pos;
+        }
+#endif
+
+        for (int l = 0; l < n; l++) {
+            if (score[l] >= thresh) {
+                int* r = out + SIM_BSW_OUT_HEADER_INTS + 4*num_passed;
+                r[0] = ids[l];
+                r[1] = score[l];
+                r[2] = rmax[l];
+                r[3] = qmax[l];
+                num_passed++;
+            }
+        }
+    }
+
+    memset(out, 0, sizeof(int) * SIM_BSW_OUT_HEADER_INTS);
+    out[0] = num_passed;
+    ((cl_mem) args[20])->written = true;
+
+#ifdef WITH_VERILATOR
+    cycles = *std::max_element(array_busy, array_busy + SIM_BSW_NUM_ARRAYS);
+#else
+    cycles = 0;
+#endif
+    return cells;
+}
+
+// GACT-X kernel: arguments as set by GACTXDispatcher in Processor.cpp
+static uint64_t RunGACTX (const uint64_t* args, uint64_t& cycles, uint64_t& mismatches) {
+    cpu_scoring sc;
+    ReadScoring(args, sc, true);
+
+    uint8_t align_fields = args[14];
+    uint32_t rl = std::min((uint32_t) args[15], (uint32_t) SIM_GACTX_TILE_SIZE);
+    uint32_t ql = std::min((uint32_t) args[16], (uint32_t) SIM_GACTX_TILE_SIZE);
+    cl_mem tile_out = (cl_mem) args[21];
+    cl_mem tb_out = (cl_mem) args[22];
+
+    const char* ref_seq = SeqPtr((cl_mem) args[19], args[17], rl, "reference");
+    const char* query_seq = SeqPtr((cl_mem) args[20], args[18], ql, "query");
+    TraceTile("gactx", align_fields, ref_seq, rl, query_seq, ql);
+
+    int score, rmax, qmax;
+    std::vector<uint32_t> tb;
+    int8_t ref_tile[SIM_GACTX_TILE_SIZE];
+    int8_t query_tile[SIM_GACTX_TILE_SIZE];
+
+    EncodeTileSeq(ref_seq, rl, (align_fields & reverse_ref), (align_fields & complement_ref), ref_tile);
+    EncodeTileSeq(query_seq, ql, (align_fields & reverse_query), (align_fields & complement_query), query_tile);
+    GACTXTile(sim_isa, ref_tile, rl, query_tile, ql, sc, score, rmax, qmax, tb);
+    if (align_fields & tb_run_length) {
+        RunLengthTraceback(tb);
+    }
+#ifdef WITH_VERILATOR
+    array_params params;
+    ReadArrayParams(args, params);
+    array_tile_result r;
+    GACTXArrayTile(params, align_fields, ref_seq, rl, query_seq, ql, r);
+    CheckArrayTile("gactx", r, score, rmax, qmax, tb, mismatches);
+    score = r.score;
+    rmax = r.ref_max_pos;
+    qmax = r.query_max_pos;
+    tb.swap(r.tb);
+    cycles = r.load_cycles + r.compute_cycles + r.readout_cycles;
+#else
+    cycles = 0;
+#endif
+
+    size_t tb_words = std::min(tb.size(), tb_out->size / sizeof(uint32_t));
+    tb_words -= tb_words % 16;
+    memcpy(tb_out->data, tb.data(), tb_words * sizeof(uint32_t));
+
+    int* op = (int*) tile_out->data;
+    memset(op, 0, sizeof(int) * 16);
+    op[0] = score;
+    op[1] = rmax;
+    op[2] = qmax;
+    op[5] = tb_words / 16;
+    tile_out->written = true;
+    tb_out->written = true;
+
+    return (uint64_t) rl * ql;
+}
+
+static void EngineWorker (sim_engine* engine) {
+    std::unique_lock<std::mutex> lk(sim_lock);
+    while (true) {
+        sim_command* c = NULL;
+        for (auto it = engine->pending.begin(); it != engine->pending.end(); it++) {
+            if (CommandReady(*it)) {
+                c = *it;
+                engine->pending.erase(it);
+                break;
+            }
+        }
+        if (c == NULL) {
+            if (engine->context->shutdown) {
+                break;
+            }
+            sim_cv.wait(lk);
+            continue;
+        }
+        lk.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        double model_us = 0;
+        if (c->type == SIM_TASK) {
+            uint64_t cells, cycles;
+            if (c->kernel->type == SIM_BSW) {
+                cells = RunBSW(c->args, cycles, engine->array_mismatches);
+                model_us = sim_launch_latency_us + cells / (sim_bsw_gcups * 1e3);
+            }
+            else {
+                cells = RunGACTX(c->args, cycles, engine->array_mismatches);
+                model_us = sim_launch_latency_us + cells / (sim_gactx_gcups * 1e3);
+            }
+#ifdef WITH_VERILATOR
+            model_us = sim_launch_latency_us + cycles / sim_clock_mhz;
+#endif
+            engine->cells += cells;
+            engine->cycles += cycles;
+        }
+        else {
+            if (c->type == SIM_WRITE) {
+                if (c->copy) {
+                    memcpy(c->mem->data + c->offset, c->ptr, c->size);
+                    c->mem->written = true;
+                }
+            }
+            else {
+                memcpy(c->ptr, c->mem->data + c->offset, c->size);
+            }
+            model_us = sim_pcie_latency_us + c->size / (sim_pcie_gbytes_per_sec * 1e3);
+            engine->bytes += c->size;
+        }
+
+        auto model_end = start + std::chrono::nanoseconds((int64_t) (model_us * 1e3));
+        if (std::chrono::steady_clock::now() > model_end) {
+            engine->num_overruns++;
+        }
+        else {
+            std::this_thread::sleep_until(model_end);
+        }
+        engine->num_commands++;
+        engine->busy_us += model_us;
+
+        lk.lock();
+        c->event->start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+        c->event->end_ns = c->event->start_ns + (cl_ulong) (model_us * 1e3);
+        c->event->complete = true;
+        ReleaseEventLocked(c->event);
+        for (auto d: c->deps) {
+            ReleaseEventLocked(d);
+        }
+        delete c;
+        sim_cv.notify_all();
+    }
+}
+
+static sim_engine* AddEngine (cl_context context, std::string name) {
+    sim_engine* engine = new sim_engine;
+    engine->name = name;
+    engine->context = context;
+    engine->num_commands = 0;
+    engine->num_overruns = 0;
+    engine->bytes = 0;
+    engine->cells = 0;
+    engine->cycles = 0;
+    engine->array_mismatches = 0;
+    engine->busy_us = 0;
+    engine->worker = std::thread(EngineWorker, engine);
+    std::lock_guard<std::mutex> lk(sim_lock);
+    context->engines.push_back(engine);
+    return engine;
+}
+
+static cl_int Submit (sim_engine* engine, sim_command* c, cl_uint num_events, const cl_event* wait_list, cl_event* event, bool blocking) {
+    std::unique_lock<std::mutex> lk(sim_lock);
+    for (cl_uint i = 0; i < num_events; i++) {
+        wait_list[i]->refcount++;
+        c->deps.push_back(wait_list[i]);
+    }
+    c->event = new _cl_event;
+    c->event->complete = false;
+    c->event->start_ns = 0;
+    c->event->end_ns = 0;
+    c->event->refcount = 1 + (event != NULL) + blocking;
+    cl_event e = c->event;
+    if (event != NULL) {
+        *event = e;
+    }
+    engine->pending.push_back(c);
+    sim_cv.notify_all();
+
+    if (blocking) {
+        while (!e->complete) {
+            sim_cv.wait(lk);
+        }
+        ReleaseEventLocked(e);
+    }
+    return CL_SUCCESS;
+}
+
+static void CopyInfo (const char* value, size_t param_value_size, void* param_value, size_t* param_value_size_ret) {
+    size_t len = strlen(value) + 1;
+    if (param_value != NULL) {
+        strncpy((char*) param_value, value, param_value_size);
+        if (param_value_size > 0) {
+            ((char*) param_value)[param_value_size - 1] = 0;
+        }
+    }
+    if (param_value_size_ret != NULL) {
+        *param_value_size_ret = len;
+    }
+}
+
+static void LoadSimConfig () {
+    if (sim_config_loaded) {
+        return;
+    }
+    sim_config_loaded = true;
+
+    ConfigFile cfg_file("params.cfg");
+    sim_num_devices = (int) (double) cfg_file.Value("Simulator", "num_devices", (double) sim_num_devices);
+    sim_pcie_gbytes_per_sec = (double) cfg_file.Value("Simulator", "pcie_gbytes_per_sec", sim_pcie_gbytes_per_sec);
+    sim_pcie_latency_us = (double) cfg_file.Value("Simulator", "pcie_latency_us", sim_pcie_latency_us);
+    sim_launch_latency_us = (double) cfg_file.Value("Simulator", "launch_latency_us", sim_launch_latency_us);
+    sim_bsw_gcups = (double) cfg_file.Value("Simulator", "bsw_gcups", sim_bsw_gcups);
+    sim_gactx_gcups = (double) cfg_file.Value("Simulator", "gactx_gcups", sim_gactx_gcups);
+    sim_clock_mhz = (double) cfg_file.Value("Simulator", "clock_mhz", sim_clock_mhz);
+    sim_tile_trace = (std::string) cfg_file.Value("Simulator", "tile_trace", "");
+    sim_num_devices = std::max(1, std::min(sim_num_devices, SIM_MAX_DEVICES));
+
+    if (sim_tile_trace != "") {
+        sim_trace = fopen(sim_tile_trace.c_str(), "w");
+        if (sim_trace == NULL) {
+            fprintf(stderr, "Error: cannot open tile trace %s!\n", sim_tile_trace.c_str());
+            fprintf(stderr, "Test failed\n");
+            exit(1);
+        }
+    }
+
+    sim_isa = DetectCPUISA();
+    fprintf(stderr, "Simulated devices: %d, PCIe %.1f GB/s + %.1f usec, launch %.1f usec, BSW %.1f GCUPS, GACT-X %.1f GCUPS (engines: %s)\n",
+            sim_num_devices, sim_pcie_gbytes_per_sec, sim_pcie_latency_us, sim_launch_latency_us, sim_bsw_gcups, sim_gactx_gcups,
+            CPUISAName(sim_isa));
+#ifdef WITH_VERILATOR
+    fprintf(stderr, "Simulated kernels run on the verilated arrays (NUM_PE %d, BLOCK_WIDTH %d) at %.0f MHz\n",
+            ARRAY_NUM_PE, ARRAY_BLOCK_WIDTH, sim_clock_mhz);
+#endif
+}
+
+cl_int clGetPlatformIDs (cl_uint num_entries, cl_platform_id* platforms, cl_uint* num_platforms) {
+    LoadSimConfig();
+    if ((num_entries > 0) && (platforms != NULL)) {
+        platforms[0] = &sim_platform;
+    }
+    if (num_platforms != NULL) {
+        *num_platforms = 1;
+    }
+    return CL_SUCCESS;
+}
+
+cl_int clGetPlatformInfo (cl_platform_id platform, cl_platform_info param_name, size_t param_value_size, void* param_value, size_t* param_value_size_ret) {
+    if (param_name != CL_PLATFORM_VENDOR) {
+        return CL_INVALID_VALUE;
+    }
+    CopyInfo("Xilinx", param_value_size, param_value, param_value_size_ret);
+    return CL_SUCCESS;
+}
+
+cl_int clGetDeviceIDs (cl_platform_id platform, cl_device_type device_type, cl_uint num_entries, cl_device_id* devices, cl_uint* num_devices) {
+    LoadSimConfig();
+    cl_uint n = std::min((cl_uint) sim_num_devices, num_entries);
+    for (cl_uint i = 0; (devices != NULL) && (i < n); i++) {
+        devices[i] = &sim_devices[i];
+    }
+    if (num_devices != NULL) {
+        *num_devices = (devices != NULL) ? n : sim_num_devices;
+    }
+    return CL_SUCCESS;
+}
+
+cl_int clGetDeviceInfo (cl_device_id device, cl_device_info param_name, size_t param_value_size, void* param_value, size_t* param_value_size_ret) {
+    if (param_name != CL_DEVICE_NAME) {
+        return CL_INVALID_VALUE;
+    }
+    CopyInfo(TARGET_DEVICE, param_value_size, param_value, param_value_size_ret);
+    return CL_SUCCESS;
+}
+
+cl_context clCreateContext (const cl_context_properties* properties, cl_uint num_devices, const cl_device_id* devices,
+        void (*pfn_notify)(const char*, const void*, size_t, void*), void* user_data, cl_int* errcode_ret) {
+    LoadSimConfig();
+
+    cl_context context = new _cl_context;
+    context->device = devices[0] - sim_devices;
+    context->shutdown = false;
+    AddEngine(context, "host-to-device");
+    AddEngine(context, "device-to-host");
+
+    if (errcode_ret != NULL) {
+        *errcode_ret = CL_SUCCESS;
+    }
+    return context;
+}
+
+cl_int clReleaseContext (cl_context context) {
+    {
+        std::lock_guard<std::mutex> lk(sim_lock);
+        context->shutdown = true;
+    }
+    sim_cv.notify_all();
+
+    for (auto engine: context->engines) {
+        engine->worker.join();
+        fprintf(stderr, "#sim device %d %s: commands: %lu, busy: %.1f msec, bytes: %lu, cells: %lu, overruns: %lu\n", context->device,
+                engine->name.c_str(), engine->num_commands, engine->busy_us / 1e3, engine->bytes, engine->cells, engine->num_overruns);
+#ifdef WITH_VERILATOR
+        fprintf(stderr, "#sim device %d %s: array cycles: %lu, mismatches against the CPU engine: %lu\n", context->device,
+                engine->name.c_str(), engine->cycles, engine->array_mismatches);
+#endif
+        delete engine;
+    }
+    if (sim_trace != NULL) {
+        std::lock_guard<std::mutex> lk(sim_trace_lock);
+        fflush(sim_trace);
+    }
+    delete context;
+    return CL_SUCCESS;
+}
+
+cl_command_queue clCreateCommandQueue (cl_context context, cl_device_id device, cl_command_queue_properties properties, cl_int* errcode_ret) {
+    cl_command_queue queue = new _cl_command_queue;
+    queue->context = context;
+    if (errcode_ret != NULL) {
+        *errcode_ret = CL_SUCCESS;
+    }
+    return queue;
+}
+
+cl_int clReleaseCommandQueue (cl_command_queue command_queue) {
+    delete command_queue;
+    return CL_SUCCESS;
+}
+
+cl_int clFlush (cl_command_queue command_queue) {
+    return CL_SUCCESS;
+}
+
+cl_program clCreateProgramWithBinary (cl_context context, cl_uint num_devices, const cl_device_id* device_list, const size_t* lengths,
+        const unsigned char** binaries, cl_int* binary_status, cl_int* errcode_ret) {
+    cl_program program = new _cl_program;
+    program->context = context;
+    std::string text((const char*) binaries[0], lengths[0]);
+    std::stringstream lines(text);
+    std::string s;
+    cl_int ret = CL_SUCCESS;
+
+    while (std::getline(lines, s)) {
+        s.erase(0, s.find_first_not_of(" \t\r"));
+        s.erase(s.find_last_not_of(" \t\r") + 1);
+        if (s.empty() || (s[0] == '#')) {
+            continue;
+        }
+        if (s.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_") != std::string::npos) {
+            program->build_log = "not a simulator kernel list (one kernel name per line)";
+            ret = CL_INVALID_PROGRAM;
+            break;
+        }
+        program->kernel_names.push_back(s);
+    }
+
+    if (binary_status != NULL) {
+        *binary_status = ret;
+    }
+    if (errcode_ret != NULL) {
+        *errcode_ret = ret;
+    }
+    return program;
+}
+
+cl_int clBuildProgram (cl_program program, cl_uint num_devices, const cl_device_id* device_list, const char* options,
+        void (*pfn_notify)(cl_program, void*), void* user_data) {
+    return program->build_log.empty() ? CL_SUCCESS : CL_INVALID_PROGRAM;
+}
+
+cl_int clGetProgramInfo (cl_program program, cl_program_info param_name, size_t param_value_size, void* param_value, size_t* param_value_size_ret) {
+    if (param_name != CL_PROGRAM_KERNEL_NAMES) {
+        return CL_INVALID_VALUE;
+    }
+    std::string names;
+    for (auto& n: program->kernel_names) {
+        names += (names.empty() ? "" : ";") + n;
+    }
+    CopyInfo(names.c_str(), param_value_size, param_value, param_value_size_ret);
+    return CL_SUCCESS;
+}
+
+cl_int clGetProgramBuildInfo (cl_program program, cl_device_id device, cl_program_build_info param_name, size_t param_value_size,
+        void* param_value, size_t* param_value_size_ret) {
+    CopyInfo(program->build_log.c_str(), param_value_size, param_value, param_value_size_ret);
+    return CL_SUCCESS;
+}
+
+cl_int clReleaseProgram (cl_program program) {
+    delete program;
+    return CL_SUCCESS;
+}
+
+cl_kernel clCreateKernel (cl_program program, const char* kernel_name, cl_int* errcode_ret) {
+    sim_kernel_type type;
+    if (strncmp(kernel_name, "BSW_", 4) == 0) {
+        type = SIM_BSW;
+    }
+    else if (strncmp(kernel_name, "GACTX_", 6) == 0) {
+        type = SIM_GACTX;
+    }
+    else {
+        if (errcode_ret != NULL) {
+            *errcode_ret = CL_INVALID_KERNEL_NAME;
+        }
+        return NULL;
+    }
+
+    cl_kernel kernel = new _cl_kernel;
+    kernel->name = kernel_name;
+    kernel->type = type;
+    memset(kernel->args, 0, sizeof(kernel->args));
+    kernel->engine = AddEngine(program->context, kernel_name);
+
+    if (errcode_ret != NULL) {
+        *errcode_ret = CL_SUCCESS;
+    }
+    return kernel;
+}
+
+cl_int clSetKernelArg (cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void* arg_value) {
+    if (arg_index >= SIM_MAX_KERNEL_ARGS) {
+        return CL_INVALID_ARG_INDEX;
+    }
+    if (arg_size > sizeof(uint64_t)) {
+        return CL_INVALID_VALUE;
+    }
+    uint64_t v = 0;
+    memcpy(&v, arg_value, arg_size);
+    kernel->args[arg_index] = v;
+    return CL_SUCCESS;
+}
+
+cl_int clReleaseKernel (cl_kernel kernel) {
+    delete kernel;
+    return CL_SUCCESS;
+}
+
+cl_mem clCreateBuffer (cl_context context, cl_mem_flags flags, size_t size, void* host_ptr, cl_int* errcode_ret) {
+    cl_mem mem = new _cl_mem;
+    mem->data = (char*) calloc(size, 1);
+    mem->size = size;
+    mem->written = false;
+    if (mem->data == NULL) {
+        delete mem;
+        if (errcode_ret != NULL) {
+            *errcode_ret = CL_MEM_OBJECT_ALLOCATION_FAILURE;
+        }
+        return NULL;
+    }
+    if (errcode_ret != NULL) {
+        *errcode_ret = CL_SUCCESS;
+    }
+    return mem;
+}
+
+cl_int clReleaseMemObject (cl_mem memobj) {
+    free(memobj->data);
+    delete memobj;
+    return CL_SUCCESS;
+}
+
+static bool AllZero (const void* ptr, size_t size) {
+    const char* p = (const char*) ptr;
+    return (size == 0) || ((p[0] == 0) && (memcmp(p, p + 1, size - 1) == 0));
+}
+
+cl_int clEnqueueWriteBuffer (cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_write, size_t offset, size_t size,
+        const void* ptr, cl_uint num_events_in_wait_list, const cl_event* event_wait_list, cl_event* event) {
+    if (offset + size > buffer->size) {
+        return CL_INVALID_VALUE;
+    }
+    sim_command* c = new sim_command;
+    c->type = SIM_WRITE;
+    c->mem = buffer;
+    c->offset = offset;
+    c->size = size;
+    c->ptr = (char*) ptr;
+    // the buffers are cleared at startup; copying zeros into fresh memory
+    // would commit all of it, so only the transfer time is modelled
+    c->copy = buffer->written || !AllZero(ptr, size);
+    return Submit(command_queue->context->engines[0], c, num_events_in_wait_list, event_wait_list, event, blocking_write);
+}
+
+cl_int clEnqueueReadBuffer (cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_read, size_t offset, size_t size,
+        void* ptr, cl_uint num_events_in_wait_list, const cl_event* event_wait_list, cl_event* event) {
+    if (offset + size > buffer->size) {
+        return CL_INVALID_VALUE;
+    }
+    sim_command* c = new sim_command;
+    c->type = SIM_READ;
+    c->mem = buffer;
+    c->offset = offset;
+    c->size = size;
+    c->ptr = (char*) ptr;
+    return Submit(command_queue->context->engines[1], c, num_events_in_wait_list, event_wait_list, event, blocking_read);
+}
+
+// The arguments are captured at enqueue time, as on the device
+cl_int clEnqueueTask (cl_command_queue command_queue, cl_kernel kernel, cl_uint num_events_in_wait_list,
+        const cl_event* event_wait_list, cl_event* event) {
+    sim_command* c = new sim_command;
+    c->type = SIM_TASK;
+    c->kernel = kernel;
+    memcpy(c->args, kernel->args, sizeof(c->args));
+    return Submit(kernel->engine, c, num_events_in_wait_list, event_wait_list, event, false);
+}
+
+cl_int clWaitForEvents (cl_uint num_events, const cl_event* event_list) {
+    std::unique_lock<std::mutex> lk(sim_lock);
+    for (cl_uint i = 0; i < num_events; i++) {
+        while (!event_list[i]->complete) {
+            sim_cv.wait(lk);
+        }
+    }
+    return CL_SUCCESS;
+}
+
+cl_int clGetEventProfilingInfo (cl_event event, cl_profiling_info param_name, size_t param_value_size, void* param_value,
+        size_t* param_value_size_ret) {
+    std::lock_guard<std::mutex> lk(sim_lock);
+    if (!event->complete) {
+        return CL_PROFILING_INFO_NOT_AVAILABLE;
+    }
+    if (param_value_size < sizeof(cl_ulong)) {
+        return CL_INVALID_VALUE;
+    }
+    *((cl_ulong*) param_value) = (param_name == CL_PROFILING_COMMAND_START) ? event->start_ns : event->end_ns;
+    if (param_value_size_ret != NULL) {
+        *param_value_size_ret = sizeof(cl_ulong);
+    }
+    return CL_SUCCESS;
+}
+
+cl_int clReleaseEvent (cl_event event) {
+    std::lock_guard<std::mutex> lk(sim_lock);
+    ReleaseEventLocked(event);
+    return CL_SUCCESS;
+}